@@ -0,0 +1,289 @@
+// Cache.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Buffer cache. See Cache.h.
+
+#include "Cache.h"
+#include "ContextSwitch.h"
+#include "Disk.h"
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Hash table and LRU list.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+buf_t* CacheLookup(int sector) {
+  buf_t* buf;
+  for(buf = buf_hash[sector % BUF_HASH_SIZE]; buf != NULL; buf = buf->hash_next) {
+    WORK(NODES_WALKED, 1);
+    if( buf->sector == sector ) {
+      return buf;
+    }
+  }
+  return NULL;
+}
+
+void CacheHashInsert(buf_t* buf) {
+  buf_t** bucket = &buf_hash[buf->sector % BUF_HASH_SIZE];
+  buf->hash_next = *bucket;
+  *bucket = buf;
+}
+
+void CacheHashRemove(buf_t* buf) {
+  buf_t** link;
+  for(link = &buf_hash[buf->sector % BUF_HASH_SIZE]; *link != buf; link = &(*link)->hash_next) {
+  }
+  *link = buf->hash_next;
+  buf->hash_next = NULL;
+}
+
+// Makes buf the most recently used buffer.
+void CacheTouch(buf_t* buf) {
+  if( buf_lru == buf ) {
+    return;
+  }
+  // Unlink (buf is not the head, so it has a lru_prev).
+  buf->lru_prev->lru_next = buf->lru_next;
+  if( buf->lru_next != NULL ) {
+    buf->lru_next->lru_prev = buf->lru_prev;
+  } else {
+    buf_lru_tail = buf->lru_prev;
+  }
+  // Push at the head.
+  buf->lru_prev = NULL;
+  buf->lru_next = buf_lru;
+  buf_lru->lru_prev = buf;
+  buf_lru = buf;
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+void CacheInit(void) {
+  bufs = (buf_t*)calloc(BLOCK_CACHESIZE, sizeof(buf_t));
+  assert(bufs);
+  buf_hash = (buf_t**)calloc(BUF_HASH_SIZE, sizeof(buf_t*));
+  assert(buf_hash);
+  InitQueue(&BUF_WAITING);
+
+  int i;
+  for(i = 0; i < BLOCK_CACHESIZE; i++) {
+    bufs[i].sector = -1;
+    bufs[i].data   = (char*)malloc(SECTORSIZE);
+    assert(bufs[i].data);
+    InitQueue(&bufs[i].WAITERS);
+    bufs[i].lru_prev = i > 0                   ? &bufs[i - 1] : NULL;
+    bufs[i].lru_next = i < BLOCK_CACHESIZE - 1 ? &bufs[i + 1] : NULL;
+  }
+  buf_lru      = &bufs[0];
+  buf_lru_tail = &bufs[BLOCK_CACHESIZE - 1];
+}
+
+// Helper method. Makes every process in QUEUE ready.
+void CacheWake(queue_t* QUEUE) {
+  while( QUEUE->head != NULL ) {
+    pcb_t* proc = QUEUE->head;
+    RemoveFromQueue(proc, QUEUE);
+    AddToQueue(proc, &READY);
+  }
+}
+
+// Helper method for CacheGet() and CachePrefetch(). Gives buf (clean, not held) to sector.
+void CacheClaim(buf_t* buf, int sector) {
+  if( buf->sector >= 0 ) {
+    CacheHashRemove(buf);
+  }
+  if( buf->readahead ) {
+    buf->readahead = 0;
+    cache_ra_wasted++;
+  }
+  buf->sector = sector;
+  CacheHashInsert(buf);
+  CacheTouch(buf);
+}
+
+// Helper method for CachePrefetch(). Called from the disk trap.
+void CacheReadDone(disk_request_t* request) {
+  buf_t* buf = (buf_t*)request->owner;
+  if( request->result != SUCCESS ) {
+    TracePrintf(TRACE_SEVERE, "CacheReadDone(): reading ahead sector %d failed.\n", buf->sector);
+    CacheHashRemove(buf);
+    buf->sector    = -1;
+    buf->readahead = 0;
+    cache_ra_wasted++;
+  }
+  buf->busy = 0;
+  free(request);
+  CacheWake(&buf->WAITERS);
+  CacheWake(&BUF_WAITING);
+}
+
+// Helper method for CacheStartWrite(). Called from the disk trap.
+void CacheWriteDone(disk_request_t* request) {
+  buf_t* buf = (buf_t*)request->owner;
+  if( request->result != SUCCESS ) {
+    // Try again with the next write-back.
+    TracePrintf(TRACE_SEVERE, "CacheWriteDone(): writing back sector %d failed.\n", buf->sector);
+    buf->dirty = 1;
+  }
+  buf->busy = 0;
+  free(request);
+  CacheWake(&buf->WAITERS);
+  CacheWake(&BUF_WAITING);
+}
+
+// Helper method for CacheGet() and CacheWriteBack(). Does not block.
+void CacheStartWrite(buf_t* buf) {
+  disk_request_t* request = DiskNewRequest(DISK_WRITE, buf->sector, buf->data, 0);
+  request->callback = &CacheWriteDone;
+  request->owner    = buf;
+  buf->dirty = 0;
+  buf->busy  = 1;
+  cache_writebacks++;
+  DiskSubmit(request);
+}
+
+buf_t* CacheGet(int sector, int fill) {
+  while( 1 ) {
+    buf_t* buf = CacheLookup(sector);
+    if( buf != NULL ) {
+      if( buf->busy ) {
+	BlockOn(&buf->WAITERS, NO_TIMEOUT);
+	continue;
+      }
+      cache_hits++;
+      if( buf->readahead ) {
+	buf->readahead = 0;
+	cache_ra_hits++;
+      }
+      buf->refs++;
+      CacheTouch(buf);
+      return buf;
+    }
+
+    // Miss. Take the least recently used buffer that no one holds.
+    for(buf = buf_lru_tail; buf != NULL; buf = buf->lru_prev) {
+      if( buf->refs == 0 && !buf->busy ) {
+	break;
+      }
+    }
+    if( buf == NULL ) {
+      KTRACE(TRACE_VERBOSE, "CacheGet(): every buffer is in use.\n");
+      BlockOn(&BUF_WAITING, NO_TIMEOUT);
+      continue;
+    }
+    if( buf->dirty ) {
+      // Write it back first. Look again afterwards: while I wait, someone may bring
+      // sector in, or take this buffer.
+      CacheStartWrite(buf);
+      BlockOn(&buf->WAITERS, NO_TIMEOUT);
+      continue;
+    }
+
+    cache_misses++;
+    CacheClaim(buf, sector);
+    buf->refs = 1;
+    if( !fill ) {
+      return buf;
+    }
+
+    buf->busy = 1;
+    int result = DiskIO(DISK_READ, sector, buf->data);
+    buf->busy = 0;
+    CacheWake(&buf->WAITERS);
+    if( result != SUCCESS ) {
+      CacheHashRemove(buf);
+      buf->sector = -1;
+      buf->refs   = 0;
+      CacheWake(&BUF_WAITING);
+      return NULL;
+    }
+    return buf;
+  }
+}
+
+void CachePrefetch(int sector) {
+  if( CacheLookup(sector) != NULL ) {
+    return;
+  }
+  // Only a buffer which is free right now: read-ahead is not worth waiting for.
+  buf_t* buf;
+  for(buf = buf_lru_tail; buf != NULL; buf = buf->lru_prev) {
+    if( buf->refs == 0 && !buf->busy && !buf->dirty ) {
+      break;
+    }
+  }
+  if( buf == NULL ) {
+    return;
+  }
+  CacheClaim(buf, sector);
+  buf->busy      = 1;
+  buf->readahead = 1;
+  cache_readaheads++;
+
+  disk_request_t* request = DiskNewRequest(DISK_READ, sector, buf->data, 0);
+  request->callback = &CacheReadDone;
+  request->owner    = buf;
+  DiskSubmit(request);
+}
+
+int CacheReadAhead(readahead_t* ra, int block, int count, int* first) {
+  if( block == ra->next ) {
+    ra->window = ra->window == 0 ? READAHEAD_MIN : 2 * ra->window;
+    if( ra->window > READAHEAD_MAX ) {
+      ra->window = READAHEAD_MAX;
+    }
+  } else {
+    ra->window = 0;
+    ra->ahead  = 0;
+  }
+  ra->next = block + count;
+  *first   = ra->next; // Set even when there is nothing to read ahead.
+  if( ra->window == 0 ) {
+    return 0;
+  }
+
+  // Only what is not read ahead already.
+  if( ra->ahead > ra->next ) {
+    *first = ra->ahead;
+  }
+  int end = ra->next + ra->window;
+  if( end <= *first ) {
+    return 0;
+  }
+  ra->ahead = end;
+  return end - *first;
+}
+
+void CacheRelease(buf_t* buf, int dirty) {
+  if( dirty ) {
+    buf->dirty = 1;
+  }
+  buf->refs--;
+  if( buf->refs == 0 ) {
+    CacheWake(&BUF_WAITING);
+  }
+}
+
+void CacheWriteBack(void) {
+  int i;
+  for(i = 0; i < BLOCK_CACHESIZE; i++) {
+    if( bufs[i].dirty && !bufs[i].busy && bufs[i].refs == 0 ) {
+      KTRACE(TRACE_VERBOSE, "CacheWriteBack(): sector %d.\n", bufs[i].sector);
+      CacheStartWrite(&bufs[i]);
+    }
+  }
+}
+
+void CacheSync(void) {
+  CacheWriteBack();
+  int i;
+  for(i = 0; i < BLOCK_CACHESIZE; i++) {
+    while( bufs[i].busy ) {
+      BlockOn(&bufs[i].WAITERS, NO_TIMEOUT);
+    }
+  }
+}
+
+// End of Cache.c
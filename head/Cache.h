@@ -0,0 +1,65 @@
+// Cache.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Buffer cache in front of the disk.
+//
+// BLOCK_CACHESIZE buffers of one sector each, found by sector through a hash table
+// and evicted least recently used first. ReadSector() and WriteSector() go through the
+// cache: a hit never touches the disk, and a write only dirties its buffer.
+//
+// Dirty buffers reach the disk
+// - every CACHE_WRITEBACK_TICKS ticks, from the clock trap (CacheWriteBack()),
+// - when they are evicted, and
+// - on Sync() (CacheSync()).
+// A write-back works on the buffer's own data, so the buffer is busy until the disk is
+// done with it; CacheGet() waits for that.
+//
+// Read-ahead. A reader keeps a readahead_t per stream (ReadSector() per process,
+// Read() per open file). Once its reads are sequential, CacheReadAhead() asks for the
+// next few blocks, READAHEAD_MIN at first and twice as many with each sequential read,
+// up to READAHEAD_MAX; the caller maps them to sectors and calls CachePrefetch(),
+// which reads them into the cache in the background. A read-ahead buffer counts as a
+// read-ahead hit when first used and as wasted if it is evicted before that.
+//
+// Only CacheWriteBack() and CachePrefetch() may be called from a trap which must not
+// block.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "include/filesystem.h"
+#include "DataStructures.h"
+#include "KernelGlobals.h"
+#include "Utility.h"
+
+// Allocates the buffers. Called once from KernelStart().
+void CacheInit(void);
+
+// Returns the buffer holding sector, held by the caller until CacheRelease(). With fill
+// set, a miss reads the sector from the disk; without it, the caller is about to
+// overwrite all SECTORSIZE bytes and the read is skipped. May block.
+// Returns NULL if the read failed.
+buf_t* CacheGet(int sector, int fill);
+
+// Lets go of a buffer from CacheGet(). dirty says whether the caller changed its data.
+void CacheRelease(buf_t* buf, int dirty);
+
+// Starts reading sector into a free buffer, unless it is cached or no buffer is free
+// right now. Does not block.
+void CachePrefetch(int sector);
+
+// Records that blocks [block, block + count) were just read through ra. Returns how
+// many blocks, from *first on, to read ahead (0 if the reads are not sequential);
+// *first is set either way.
+int CacheReadAhead(readahead_t* ra, int block, int count, int* first);
+
+// Starts writing back every dirty buffer that no one holds. Does not block.
+void CacheWriteBack(void);
+
+// CacheWriteBack(), then blocks until those writes (and any earlier ones) are done.
+// Buffers held by someone are written back once released.
+void CacheSync(void);
+
+#endif
+// End of Cache.h
@@ -11,6 +11,19 @@
 
 #define PIPE_BUFFER_SIZE 1024
 #define MAX_PROGRAM_NAME_LENGTH 512
+#define TTY_OUTPUT_SIZE 4096 // Bytes of output buffered per terminal (see tty_output_t).
+#define TTY_STREAM_MAX  2048 // Most of those one process may hold, so others always get room.
+#define TTY_INPUT_SIZE  2048 // Bytes of input buffered per terminal (see tty_input_t).
+#define TTY_INPUT_LINES 64   // Lines of input buffered per terminal.
+#define DISK_DEADLINE  20 // Ticks after which a disk request is served ahead of others.
+#define DISK_MERGE_MAX 8  // Most sectors in one multi-sector disk operation.
+#define BUF_HASH_SIZE         64 // Buckets in the buffer cache's hash table.
+#define CACHE_WRITEBACK_TICKS 10 // Dirty buffers are written back every this many ticks.
+#define READAHEAD_MIN 2 // Read-ahead window when a sequential run is first seen (blocks).
+#define READAHEAD_MAX 8 // Largest read-ahead window; it doubles up to this.
+#define FS_NUM_INODES  127 // Inodes on a newly formatted disk (with the header, 16 blocks).
+#define FS_DCACHE_SIZE 64  // Entries in the file system's name cache.
+#define LI_CACHE_SIZE  8   // Programs whose parsed load_info is kept (see LoadProgram.c).
 
 
 #endif
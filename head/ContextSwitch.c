@@ -31,7 +31,7 @@ KernelContext* ContextSwitchHelper
   ChangeAddressSpace(next);
 
   //  here();
-  TracePrintf(TRACE_COMMENT, "Switching from process #%d to #%d\n", current->pid, next->pid);
+  KTRACE(TRACE_COMMENT, "Switching from process #%d to #%d\n", current->pid, next->pid);
   //  TraceUserContext(TRACE_VERBOSE, &current->u_context);
   //  TraceUserContext(TRACE_VERBOSE, &next->u_context);
   //  here();
@@ -50,6 +50,14 @@ KernelContext* OneWayContextSwitchHelper(KernelContext* k_context, void* null, v
 // next starts running.
 void ContextSwitch(pcb_t* next, queue_t* FROM, queue_t* TO) {
   pcb_t* current = RUNNING.head;
+  EVENT(EV_SWITCH, next->pid, TO == &READY, 0);
+  COUNT(CONTEXT_SWITCHES);
+  if( current != NULL ) {
+    current->work[WORK_SWITCHES]++;
+  }
+  if( TO == &READY ) {
+    COUNT(PREEMPTIONS);
+  }
 
   RemoveFromQueue(next, FROM);
   if( TO != NULL ) {
@@ -58,10 +66,12 @@ void ContextSwitch(pcb_t* next, queue_t* FROM, queue_t* TO) {
   } // Otherwise (i.e., if TO == NULL, RUNNING.head is already dead.
   AddToQueue(next, &RUNNING);
   
-  TracePrintf(TRACE_VERBOSE, "ContextSwitch(): new queue arrangement:\n");
-  PrintAllQueues(); // JHL. TRACE_VERBOSE level trace print.
+  if( KTRACE_ON(TRACE_VERBOSE) ) {
+    TracePrintf(TRACE_VERBOSE, "ContextSwitch(): new queue arrangement:\n");
+    PrintAllQueues();
+  }
   
-  TracePrintf(TRACE_VERBOSE, "Calling KernelContextSwitch()...\n");
+  KTRACE(TRACE_VERBOSE, "Calling KernelContextSwitch()...\n");
   if( TO != NULL ) {  
     if( ERROR == KernelContextSwitch(ContextSwitchHelper, current, next) ) {
       TracePrintf(TRACE_WRONG, "ContextSwitch(): error in KernelContextSwitch().\n");
@@ -74,7 +84,26 @@ void ContextSwitch(pcb_t* next, queue_t* FROM, queue_t* TO) {
     }
   }
 
-  TracePrintf(TRACE_VERBOSE, "Leaving ContextSwitch()...\n---------------\n");
+  KTRACE(TRACE_VERBOSE, "Leaving ContextSwitch()...\n---------------\n");
+}
+
+//-------- -------- -------- -------- -------- -------- -------- --------
+
+int BlockOn(queue_t* QUEUE, int timeout) {
+  if( timeout == 0 ) {
+    return TIMEOUT;
+  }
+  if( timeout == NO_TIMEOUT ) {
+    ContextSwitch(READY.head, &READY, QUEUE);
+    return SUCCESS;
+  }
+
+  StartTimeout(RUNNING.head, QUEUE, timeout);
+  ContextSwitch(READY.head, &READY, QUEUE);
+  if( StopTimeout(RUNNING.head) ) {
+    return TIMEOUT;
+  }
+  return SUCCESS;
 }
 
 //-------- -------- -------- -------- -------- -------- -------- --------
@@ -102,9 +131,9 @@ KernelContext* CopyKernelStackHelper
 
   // copy the kernel stack
   unsigned char kernel_stack_buffer[R0_STACK_PAGE_TABLE_SIZE * PAGESIZE];
-  memcpy(kernel_stack_buffer, KERNEL_STACK_BASE, R0_STACK_PAGE_TABLE_SIZE * PAGESIZE);
+  memcpy(kernel_stack_buffer, (void*) KERNEL_STACK_BASE, R0_STACK_PAGE_TABLE_SIZE * PAGESIZE);
   ChangeAddressSpace(target_idle);
-  memcpy(KERNEL_STACK_BASE, kernel_stack_buffer, R0_STACK_PAGE_TABLE_SIZE * PAGESIZE);
+  memcpy((void*) KERNEL_STACK_BASE, kernel_stack_buffer, R0_STACK_PAGE_TABLE_SIZE * PAGESIZE);
   ChangeAddressSpace(source_init);
 
   return k_context;
@@ -19,6 +19,12 @@ void ContextSwitch
                      // THIS_TO == NULL is legitimate if RUNNING just died.
  );
 
+// Blocks the running process on QUEUE until someone takes it out, or until
+// timeout ticks pass. timeout == NO_TIMEOUT waits forever; timeout == 0 does not block.
+// Returns TIMEOUT if the wait timed out, SUCCESS otherwise.
+#define NO_TIMEOUT (-1)
+int BlockOn(queue_t* QUEUE, int timeout);
+
 void LoadKernelContext(pcb_t* proc);
 void CopyKernelStack(pcb_t* target_idle, pcb_t* source_init);
 #endif
@@ -0,0 +1,114 @@
+// Counters.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Kernel performance counters.
+//
+// The kernel counts, since boot,
+// - the events in COUNTER_LIST below, with COUNT() (KernelGlobals.h), and
+// - every system call, by code (YALNIX_*, and CUSTOM_* for YALNIX_CUSTOM_0).
+// A process reads them all with GetCounters() (CustomCalls.h); the kernel prints them
+// as a table when it halts.
+//
+// This header is shared by the kernel, user programs and tools/.
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include "include/yalnix.h"
+
+// X(id, name): counter COUNTER_id is reported as name.
+#define COUNTER_LIST							\
+  X(CONTEXT_SWITCHES,      "context switches")				\
+  X(PREEMPTIONS,           "  of which preemptions")			\
+  X(ADDRESS_SPACE_CHANGES, "address space changes")			\
+  X(TLB_FLUSHES,           "TLB flushes")				\
+  X(FRAMES_ALLOCATED,      "frames allocated")				\
+  X(FRAMES_FREED,          "frames freed")				\
+  X(FRAMES_COPIED,         "pages copied by Fork()")			\
+  X(PROCESSES_CREATED,     "processes created")				\
+  X(PROCESSES_KILLED,      "processes killed or exited")		\
+  X(SYSCALLS,              "system calls")				\
+  X(CLOCK_TRAPS,           "clock traps")				\
+  X(MEMORY_TRAPS,          "memory traps")				\
+  X(STACK_GROWTHS,         "  of which stack growths")			\
+  X(MEMORY_KILLS,          "  of which killed the process")		\
+  X(TTY_RECEIVE_TRAPS,     "tty receive traps")				\
+  X(TTY_TRANSMIT_TRAPS,    "tty transmit traps")			\
+  X(DISK_TRAPS,            "disk traps")
+
+#define X(id, name) COUNTER_##id,
+enum { COUNTER_LIST NUM_COUNTERS };
+#undef X
+
+#define SYSCALL_CODES 256  // Counted by (code & YALNIX_MASK).
+#define CUSTOM_CODES  0x40 // Custom calls have codes below this.
+
+typedef struct {
+  int counters[NUM_COUNTERS];
+  int syscalls[SYSCALL_CODES]; // Indexed by (YALNIX_* & YALNIX_MASK).
+  int custom[CUSTOM_CODES];    // Indexed by CUSTOM_*; these also count as YALNIX_CUSTOM_0.
+} counters_t;
+
+// Per-system-call histograms.
+//
+// For each call, the kernel records the ticks from entry to return, and the work the
+// call did for the caller (blocked time excluded; work done by others while it waits is
+// theirs). Histograms are log-scale: bucket 0 counts 0, and bucket b > 0 counts values
+// in [2^(b-1), 2^b); the last bucket also counts anything larger.
+#define WORK_PAGES_COPIED 0 // Pages copied (Fork()).
+#define WORK_BYTES_COPIED 1 // Bytes of data copied (user buffers, pipes, terminals, files).
+#define WORK_NODES_WALKED 2 // Queue, list and hash chain entries looked at.
+#define WORK_SWITCHES     3 // Times the caller was switched out.
+#define NUM_WORK          4
+//
+#define HIST_BUCKETS     24
+#define HIST_CUSTOM_BASE 0x80 // Histogram of custom call c is HIST_CUSTOM_BASE + c; that
+                              // of YALNIX_x is (YALNIX_x & YALNIX_MASK).
+#define HIST_CALLS       (HIST_CUSTOM_BASE + CUSTOM_CODES)
+//
+typedef struct {
+  int calls;
+  int ticks[HIST_BUCKETS];
+  int work[NUM_WORK][HIST_BUCKETS];
+} syscall_hist_t;
+
+// Name tables for reports: code_name_t names[] = { SYSCALL_NAMES, { 0, NULL } };
+typedef struct {
+  int   code;
+  char* name;
+} code_name_t;
+#define SYSCALL_NAMES							\
+  { YALNIX_FORK, "Fork" }, { YALNIX_EXEC, "Exec" }, { YALNIX_EXIT, "Exit" },	\
+  { YALNIX_WAIT, "Wait" }, { YALNIX_GETPID, "GetPid" }, { YALNIX_BRK, "Brk" },	\
+  { YALNIX_DELAY, "Delay" }, { YALNIX_TTY_READ, "TtyRead" },		\
+  { YALNIX_TTY_WRITE, "TtyWrite" }, { YALNIX_READ_SECTOR, "ReadSector" },	\
+  { YALNIX_WRITE_SECTOR, "WriteSector" }, { YALNIX_PIPE_INIT, "PipeInit" },	\
+  { YALNIX_PIPE_READ, "PipeRead" }, { YALNIX_PIPE_WRITE, "PipeWrite" },	\
+  { YALNIX_LOCK_INIT, "LockInit" }, { YALNIX_LOCK_ACQUIRE, "Acquire" },	\
+  { YALNIX_LOCK_RELEASE, "Release" }, { YALNIX_CVAR_INIT, "CvarInit" },	\
+  { YALNIX_CVAR_SIGNAL, "CvarSignal" }, { YALNIX_CVAR_BROADCAST, "CvarBroadcast" }, \
+  { YALNIX_CVAR_WAIT, "CvarWait" }, { YALNIX_RECLAIM, "Reclaim" },	\
+  { YALNIX_CUSTOM_0, "Custom0" }
+#define CUSTOM_NAMES							\
+  { CUSTOM_SHM_CREATE, "ShmCreate" }, { CUSTOM_SHM_ATTACH, "ShmAttach" },	\
+  { CUSTOM_SHM_DETACH, "ShmDetach" }, { CUSTOM_RWLOCK_INIT, "RWLockInit" },	\
+  { CUSTOM_RWLOCK_READ, "AcquireRead" }, { CUSTOM_RWLOCK_WRITE, "AcquireWrite" }, \
+  { CUSTOM_RWLOCK_RELEASE, "ReleaseRW" }, { CUSTOM_ACQUIRE_TIMED, "AcquireTimed" }, \
+  { CUSTOM_CVAR_WAIT_TIMED, "CvarWaitTimed" }, { CUSTOM_PIPE_READ_TIMED, "PipeReadTimed" }, \
+  { CUSTOM_POLL, "Poll" }, { CUSTOM_TTY_READ, "TtyReadFlags" },		\
+  { CUSTOM_TTY_WRITE, "TtyWriteFlags" }, { CUSTOM_PIPE_READ, "PipeReadFlags" }, \
+  { CUSTOM_PIPE_WRITE, "PipeWriteFlags" }, { CUSTOM_TTY_STATS, "TtyStats" },	\
+  { CUSTOM_GET_TICKS, "GetTicks" }, { CUSTOM_SYNC, "Sync" },		\
+  { CUSTOM_CACHE_STATS, "CacheStats" }, { CUSTOM_OPEN, "Open" },		\
+  { CUSTOM_CLOSE, "Close" }, { CUSTOM_CREATE, "Create" }, { CUSTOM_READ, "Read" }, \
+  { CUSTOM_WRITE, "Write" }, { CUSTOM_SEEK, "Seek" }, { CUSTOM_UNLINK, "Unlink" }, \
+  { CUSTOM_MKDIR, "MkDir" }, { CUSTOM_READDIR, "ReadDir" },		\
+  { CUSTOM_INSTALL, "Install" }, { CUSTOM_SPAWN, "Spawn" },		\
+  { CUSTOM_FRAME_STATS, "FrameStats" }, { CUSTOM_SET_TRACE_LEVEL, "SetTraceLevel" }, \
+  { CUSTOM_DUMP_EVENTS, "DumpEvents" }, { CUSTOM_GET_COUNTERS, "GetCounters" },	\
+  { CUSTOM_SYSCALL_HIST, "SyscallHist" }, { CUSTOM_PROFILE, "Profile" },	\
+  { CUSTOM_FRAME_MAP, "FrameMap" }, { CUSTOM_DUMP_TIMELINE, "DumpTimeline" }
+
+#endif
+// End of Counters.h
@@ -0,0 +1,415 @@
+// CustomCalls.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// System calls beyond those declared in include/yalnix.h.
+//
+// libuser.a only has stubs for the calls in yalnix.h, so every call we add goes
+// through Custom0(code, arg1, arg2, arg3). The first argument is one of the codes
+// below; the kernel reads it from regs[0] and the call's arguments from regs[1..3].
+// HandleTrapKernel() hands YALNIX_CUSTOM_0 over to HandleTrapCustom().
+//
+// Some calls take flags, which are or-ed into the upper half of the code.
+//
+// This header is shared by the kernel and user programs.
+
+#ifndef CUSTOM_CALLS_H
+#define CUSTOM_CALLS_H
+
+#include "include/yalnix.h"
+#include "Counters.h"
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Call codes.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// Shared memory.
+#define CUSTOM_SHM_CREATE 0x01
+#define CUSTOM_SHM_ATTACH 0x02
+#define CUSTOM_SHM_DETACH 0x03
+//
+// Reader-writer locks.
+#define CUSTOM_RWLOCK_INIT    0x04
+#define CUSTOM_RWLOCK_READ    0x05
+#define CUSTOM_RWLOCK_WRITE   0x06
+#define CUSTOM_RWLOCK_RELEASE 0x07
+//
+// Timed waits.
+#define CUSTOM_ACQUIRE_TIMED   0x08
+#define CUSTOM_CVAR_WAIT_TIMED 0x09
+#define CUSTOM_PIPE_READ_TIMED 0x0A
+//
+// Multiplexed wait.
+#define CUSTOM_POLL 0x0B
+//
+// I/O with flags.
+#define CUSTOM_TTY_READ   0x0C
+#define CUSTOM_TTY_WRITE  0x0D
+#define CUSTOM_PIPE_READ  0x0E
+#define CUSTOM_PIPE_WRITE 0x0F
+//
+// Terminal statistics.
+#define CUSTOM_TTY_STATS 0x10
+//
+// Clock.
+#define CUSTOM_GET_TICKS 0x11
+//
+// Buffer cache.
+#define CUSTOM_SYNC        0x12
+#define CUSTOM_CACHE_STATS 0x13
+//
+// File system.
+#define CUSTOM_OPEN    0x14
+#define CUSTOM_CLOSE   0x15
+#define CUSTOM_CREATE  0x16
+#define CUSTOM_READ    0x17
+#define CUSTOM_WRITE   0x18
+#define CUSTOM_SEEK    0x19
+#define CUSTOM_UNLINK  0x1A
+#define CUSTOM_MKDIR   0x1B
+#define CUSTOM_READDIR 0x1C
+//
+// Programs in the file system.
+#define CUSTOM_INSTALL 0x1D
+//
+// Process creation.
+#define CUSTOM_SPAWN       0x1E
+#define CUSTOM_FRAME_STATS 0x1F
+//
+// Kernel tracing.
+#define CUSTOM_SET_TRACE_LEVEL 0x20
+#define CUSTOM_DUMP_EVENTS     0x21
+//
+// Performance counters.
+#define CUSTOM_GET_COUNTERS 0x22
+#define CUSTOM_SYSCALL_HIST 0x23
+//
+// Profiler.
+#define CUSTOM_PROFILE 0x24
+//
+// Frame map.
+#define CUSTOM_FRAME_MAP 0x25
+//
+// Scheduler timeline.
+#define CUSTOM_DUMP_TIMELINE 0x26
+//
+// Flags.
+#define CUSTOM_CODE_MASK 0x0000ffff
+#define CUSTOM_FLAG_MASK 0xffff0000
+#define IO_NONBLOCK 0x00010000 // Return WOULDBLOCK instead of blocking.
+#define IO_VECTOR   0x00020000 // (buffer, length) is (iovec_t* iov, int iovcnt).
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Return codes.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// ERROR (-1) is defined in yalnix.h. (-2) is KILL, internal to the kernel.
+#define TIMEOUT    (-3) // A timed wait gave up.
+#define WOULDBLOCK (-4) // An IO_NONBLOCK call would have blocked.
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Poll() events.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// events[i] says what ids[i] is; Poll() sets POLL_READY in it if the source is ready.
+#define POLL_PIPE  0x1 // ids[i] is a pipe. Ready when PipeRead() would not block.
+#define POLL_TTY   0x2 // ids[i] is a terminal. Ready when TtyRead() would not block.
+#define POLL_CHILD 0x4 // ids[i] is ignored. Ready when Wait() would not block.
+#define POLL_READY 0x100
+//
+#define POLL_MAX     32   // Most sources in one Poll().
+#define POLL_FOREVER (-1) // Timeout which never runs out.
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Vectored I/O.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// With IO_VECTOR, a call works on the concatenation of iov[0..(iovcnt-1)], as if it
+// were one buffer: writes gather, reads scatter.
+typedef struct {
+  void* base;
+  int   len;
+} iovec_t;
+//
+#define YALNIX_IOV_MAX 16 // Most entries in one call (not libc's IOV_MAX).
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Terminal statistics.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+typedef struct {
+  int input_buffered; // Bytes received but not yet read.
+  int input_lines;    // Lines received but not yet (fully) read.
+  int bytes_buffered; // Bytes ever received.
+  int overruns;       // Lines dropped because the input buffer was full.
+  //
+  int output_buffered;  // Bytes written but not yet sent.
+  int output_transmits; // TtyTransmit()s completed; bytes_sent / output_transmits is
+  int bytes_sent;       // the throughput in bytes per transmit interrupt.
+} tty_stats_t;
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Buffer cache statistics.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+typedef struct {
+  int hits;       // Sector reads and writes served from memory.
+  int misses;     // Those which had to go to the disk.
+  int writebacks; // Dirty sectors written to the disk.
+  int dirty;      // Sectors changed in memory but not yet on the disk.
+  //
+  int readaheads; // Sectors read ahead of sequential readers.
+  int ra_hits;    // Read-ahead sectors then read.
+  int ra_wasted;  // Read-ahead sectors evicted before anyone read them.
+} cache_stats_t;
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Frame statistics.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// Counters are since boot; the difference across a call is what the call touched.
+typedef struct {
+  int allocated; // Frames handed out, for any purpose.
+  int copied;    // Pages Fork() copied from a parent to its child.
+  int free;      // Frames free now.
+} frame_stats_t;
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Frame map.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// What each frame of physical memory holds, and for whom.
+#define FRAME_FREE         0
+#define FRAME_KERNEL       1 // Kernel text and data.
+#define FRAME_KERNEL_HEAP  2 // malloc()'s, so PCBs and page tables too.
+#define FRAME_KERNEL_STACK 3
+#define FRAME_TEXT         4
+#define FRAME_DATA         5 // Initialized and uninitialized data.
+#define FRAME_HEAP         6 // Brk()'s.
+#define FRAME_STACK        7
+#define FRAME_SHARED       8 // A shared memory segment's.
+#define FRAME_KINDS        9
+#define FRAME_KIND_NAMES \
+  { "free", "kernel", "kheap", "kstack", "text", "data", "heap", "stack", "shared" }
+//
+typedef struct {
+  short         pid;  // Process the frame was allocated for; 0 for the kernel's own.
+  unsigned char kind; // FRAME_*.
+  unsigned char refs; // Page table entries and segments using it (at most 255).
+  int           vpn;  // Page it was allocated for, in pid's address space (for
+                      // FRAME_SHARED, its index in the segment).
+} frame_map_t;
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// User-side wrappers.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// Shared memory.
+//
+// ShmCreate(size) creates a segment of at least size bytes and returns its id.
+// ShmAttach(id, addr) maps the segment at page-aligned addr in Region 1, which
+// must lie between the heap and the stack with one free page on either side.
+// ShmDetach() unmaps the caller's segment. A process has at most one segment
+// attached; Fork() children inherit it.
+#define ShmCreate(size)     Custom0(CUSTOM_SHM_CREATE, (int)(size), 0, 0)
+#define ShmAttach(id, addr) Custom0(CUSTOM_SHM_ATTACH, (int)(id), (int)(addr), 0)
+#define ShmDetach()         Custom0(CUSTOM_SHM_DETACH, 0, 0, 0)
+//
+// Reader-writer locks.
+//
+// RWLockInit(&id) creates a lock, like LockInit(). AcquireRead() and AcquireWrite()
+// block until the lock is granted; ReleaseRW() releases either kind of hold.
+// Locks held by a process are released when it exits.
+#define RWLockInit(id_ptr) Custom0(CUSTOM_RWLOCK_INIT,    (int)(id_ptr), 0, 0)
+#define AcquireRead(id)    Custom0(CUSTOM_RWLOCK_READ,    (int)(id),     0, 0)
+#define AcquireWrite(id)   Custom0(CUSTOM_RWLOCK_WRITE,   (int)(id),     0, 0)
+#define ReleaseRW(id)      Custom0(CUSTOM_RWLOCK_RELEASE, (int)(id),     0, 0)
+//
+// Timed waits.
+//
+// Like Acquire(), CvarWait() and PipeRead(), but give up after timeout clock ticks
+// and return TIMEOUT. A timeout of 0 never blocks. CvarWaitTimed() reacquires the
+// lock before returning, whether or not it timed out.
+#define AcquireTimed(id, timeout) \
+  Custom0(CUSTOM_ACQUIRE_TIMED, (int)(id), (int)(timeout), 0)
+#define CvarWaitTimed(id, lock_id, timeout) \
+  Custom0(CUSTOM_CVAR_WAIT_TIMED, (int)(id), (int)(lock_id), (int)(timeout))
+// Four arguments do not fit in Custom0(), so they are passed in an array.
+#define PipeReadTimed(id, buffer, length, timeout) ({			\
+      int _args[4] = { (int)(id), (int)(buffer), (int)(length), (int)(timeout) }; \
+      Custom0(CUSTOM_PIPE_READ_TIMED, (int)_args, 0, 0);		\
+    })
+//
+// Multiplexed wait.
+//
+// Poll(ids, events, n, timeout) blocks until at least one of the n sources is ready,
+// or until timeout ticks pass (POLL_FOREVER waits forever, 0 never blocks). Returns
+// the number of ready sources, marked with POLL_READY in events[], or TIMEOUT. With
+// no sources (n is 0), it just waits out timeout; POLL_FOREVER is then an ERROR.
+#define Poll(ids, events, n, timeout) ({				\
+      int _args[4] = { (int)(ids), (int)(events), (int)(n), (int)(timeout) }; \
+      Custom0(CUSTOM_POLL, (int)_args, 0, 0);				\
+    })
+//
+// I/O with flags.
+//
+// Same as TtyRead(), TtyWrite(), PipeRead() and PipeWrite(), with IO_* flags.
+// TtyWrite() returns once its bytes are buffered by the kernel, not once they are sent.
+// A write of at most TERMINAL_MAX_LINE bytes is never mixed with other output; a larger
+// one may have other writers' output between its lines. With IO_NONBLOCK, TtyWrite()
+// buffers as much as fits and returns that count, or WOULDBLOCK if nothing does
+// (a small write is all or nothing).
+// PipeWrite() never blocks, so IO_NONBLOCK does not change it.
+#define TtyReadFlags(tty, buffer, length, flags) \
+  Custom0(CUSTOM_TTY_READ   | (flags), (int)(tty), (int)(buffer), (int)(length))
+#define TtyWriteFlags(tty, buffer, length, flags) \
+  Custom0(CUSTOM_TTY_WRITE  | (flags), (int)(tty), (int)(buffer), (int)(length))
+#define PipeReadFlags(id, buffer, length, flags) \
+  Custom0(CUSTOM_PIPE_READ  | (flags), (int)(id),  (int)(buffer), (int)(length))
+#define PipeWriteFlags(id, buffer, length, flags) \
+  Custom0(CUSTOM_PIPE_WRITE | (flags), (int)(id),  (int)(buffer), (int)(length))
+//
+// Vectored forms. A TtyWritev() reaches the terminal as one write, not one per entry.
+#define TtyReadv(tty, iov, iovcnt)  TtyReadFlags (tty, iov, iovcnt, IO_VECTOR)
+#define TtyWritev(tty, iov, iovcnt) TtyWriteFlags(tty, iov, iovcnt, IO_VECTOR)
+#define PipeReadv(id, iov, iovcnt)  PipeReadFlags (id, iov, iovcnt, IO_VECTOR)
+#define PipeWritev(id, iov, iovcnt) PipeWriteFlags(id, iov, iovcnt, IO_VECTOR)
+//
+// Terminal statistics.
+//
+// TtyStats(tty, &stats) fills in a tty_stats_t. Lines typed while no one reads are
+// buffered by the kernel; TtyRead() returns them without blocking.
+#define TtyStats(tty, stats_ptr) Custom0(CUSTOM_TTY_STATS, (int)(tty), (int)(stats_ptr), 0)
+//
+// Clock.
+//
+// GetTicks() returns the number of clock ticks since boot.
+#define GetTicks() Custom0(CUSTOM_GET_TICKS, 0, 0, 0)
+//
+// Buffer cache.
+//
+// ReadSector() and WriteSector() go through a kernel cache; WriteSector() returns
+// before the sector is on the disk. Sync() returns once every sector written before
+// it is. CacheStats(&stats) fills in a cache_stats_t.
+#define Sync()                Custom0(CUSTOM_SYNC,        0,               0, 0)
+#define CacheStats(stats_ptr) Custom0(CUSTOM_CACHE_STATS, (int)(stats_ptr), 0, 0)
+//
+// File system (YFS, see include/filesystem.h).
+//
+// Paths are absolute or relative to the root. Open() and Create() return a file
+// descriptor (at most MAX_OPEN_FILES per process); Fork() children share their parent's
+// open files, offsets included. Create() truncates an existing file. Read() and Write()
+// return the number of bytes moved; Read() returns 0 at the end of the file. Seek()
+// returns the new offset. Unlink() removes a regular file that no one has open.
+// ReadDir() copies the next used entry of an open directory into *entry and returns 1,
+// or returns 0 after the last one.
+#define FS_SEEK_SET 0
+#define FS_SEEK_CUR 1
+#define FS_SEEK_END 2
+#define Open(path)                Custom0(CUSTOM_OPEN,    (int)(path), 0,             0)
+#define Close(fd)                 Custom0(CUSTOM_CLOSE,   (int)(fd),   0,             0)
+#define Create(path)              Custom0(CUSTOM_CREATE,  (int)(path), 0,             0)
+#define Read(fd, buffer, length)  Custom0(CUSTOM_READ,    (int)(fd),   (int)(buffer), (int)(length))
+#define Write(fd, buffer, length) Custom0(CUSTOM_WRITE,   (int)(fd),   (int)(buffer), (int)(length))
+#define Seek(fd, offset, whence)  Custom0(CUSTOM_SEEK,    (int)(fd),   (int)(offset), (int)(whence))
+#define Unlink(path)              Custom0(CUSTOM_UNLINK,  (int)(path), 0,             0)
+#define MkDir(path)               Custom0(CUSTOM_MKDIR,   (int)(path), 0,             0)
+#define ReadDir(fd, entry)        Custom0(CUSTOM_READDIR, (int)(fd),   (int)(entry),  0)
+//
+// Programs in the file system.
+//
+// Install(linux_name, path) copies the Linux program linux_name (as Exec() takes it)
+// into the file system as path, checked and laid out for loading. Exec() looks a name
+// up in the file system when no Linux file has it. Returns ERROR if the copy fails
+// partway: a new path is removed, and a path that was there holds no image (Exec() of
+// it fails). Returns ERROR, changing nothing, if path is open (say, being loaded).
+#define Install(linux_name, path) Custom0(CUSTOM_INSTALL, (int)(linux_name), (int)(path), 0)
+//
+// Process creation.
+//
+// Spawn(name, argv) is Fork() followed by Exec(name, argv) in the child, without
+// copying the caller's address space: the child starts with an empty Region 1 and
+// loads name itself. The child gets the caller's open files, and nothing else
+// (no shared memory segment). Returns the child's pid once name is loaded, or ERROR
+// if it could not be (then there is no child to Wait() for).
+// FrameStats(&stats) fills in a frame_stats_t.
+#define Spawn(name, argv)        Custom0(CUSTOM_SPAWN,       (int)(name),      (int)(argv), 0)
+#define FrameStats(stats_ptr)    Custom0(CUSTOM_FRAME_STATS, (int)(stats_ptr), 0,           0)
+//
+// Kernel tracing.
+//
+// SetTraceLevel(level) makes the kernel's hot-path trace messages (KTRACE() in
+// KernelGlobals.h) print only up to level, and returns the previous level. The level
+// is kernel-wide, for every process, and clamped to [0, KTRACE_MAX]: it cannot turn
+// on what the kernel was built without.
+// DumpEvents() writes the kernel's event log (see Events.h) to the Linux file EVENTS
+// now, as the kernel does when it halts, and returns the number of events written.
+#define SetTraceLevel(level) Custom0(CUSTOM_SET_TRACE_LEVEL, (int)(level), 0, 0)
+#define DumpEvents()         Custom0(CUSTOM_DUMP_EVENTS,     0,            0, 0)
+//
+// Performance counters.
+//
+// GetCounters(&counters) fills in a counters_t (see Counters.h).
+// SyscallHist(call, &hist) fills in the syscall_hist_t of system call call (Counters.h
+// says how calls are numbered), all zeros if it has not been made.
+#define GetCounters(counters_ptr)     Custom0(CUSTOM_GET_COUNTERS, (int)(counters_ptr), 0,               0)
+#define SyscallHist(call, hist_ptr)   Custom0(CUSTOM_SYSCALL_HIST, (int)(call),         (int)(hist_ptr), 0)
+//
+// Profiler (see Profile.h).
+//
+// Profile(1) starts sampling the caller's pc at every clock tick, and Profile(0) stops;
+// both return the samples taken so far (not yet written to PROFILE). Children created
+// while it is on are profiled too.
+#define Profile(on) Custom0(CUSTOM_PROFILE, (int)(on), 0, 0)
+//
+// Frame map.
+//
+// FrameMap(map, first, count) copies the frame_map_t of frames first, first + 1, ...
+// into map[0..(count-1)], stopping at the last frame, and returns how many it copied
+// (0 once first is past the last frame). Read it a chunk at a time.
+#define FrameMap(map_ptr, first, count) \
+  Custom0(CUSTOM_FRAME_MAP, (int)(map_ptr), (int)(first), (int)(count))
+//
+// Scheduler timeline (see Timeline.h).
+//
+// DumpTimeline() writes the kernel's queue sizes of the last TIMELINE_RING_SIZE ticks
+// to the Linux file TIMELINE now, as the kernel does when it halts, and returns the
+// number of ticks written.
+#define DumpTimeline() Custom0(CUSTOM_DUMP_TIMELINE, 0, 0, 0)
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+#endif
+// End of CustomCalls.h
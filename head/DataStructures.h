@@ -7,8 +7,14 @@
 #ifndef DATA_STRUCTURES_H
 #define DATA_STRUCTURES_H
 
+#include <stdlib.h>
+#include <string.h>
 #include "include/hardware.h"
+#include "include/filesystem.h"
+#include "include/load_info.h"
 #include "Constants.h"
+#include "Counters.h"
+#include "Profile.h"
 
 // ======== ======== ======== ======== ======== ======== ======== ========
 // Frame table.
@@ -18,8 +24,14 @@
 //
 typedef struct fte fte_t;
 struct fte {
-  unsigned char valid : 1;
-  unsigned char prot  : 3;
+  unsigned char  valid : 1;
+  unsigned char  prot  : 3;
+  unsigned char  kind;  // FRAME_* (CustomCalls.h); FRAME_FREE while not valid.
+  unsigned short refs;  // Page table entries (and shared memory segments) using this frame.
+                        // FreeFrame() releases the frame when this drops to 0.
+  // Reverse map, set by SetFrameOwner(): who the frame was allocated for.
+  short          owner; // pid; 0 for the kernel's own frames.
+  int            vpn;   // Page number (address >> PAGESHIFT) in owner's address space.
 };
 //
 // Frame table is ((fte_t*) frame_table).
@@ -82,6 +94,22 @@ struct soul {
 
 #define R1_PAGETABLE_NUM_ENTRIES (VMEM_1_SIZE / PAGESIZE)
 #define PCB_NAME_LENGTH 32 // (MAX_PROGRAM_NAME_LENGTH)
+//
+// Sequential-read detector, one per stream of reads (see CacheReadAhead() in Cache.h).
+typedef struct {
+  int next;   // Block a sequential reader reads next.
+  int window; // Blocks to keep read ahead of it (0 if not sequential).
+  int ahead;  // Blocks below this one have been read ahead already.
+} readahead_t;
+//
+// Clock samples of a profiled process (see Profile.h), hashed by pc; pc 0 is a free slot.
+typedef struct {
+  int on;      // Sampling now. Profile(0) keeps the samples.
+  int samples; // Dropped ones included.
+  int dropped; // Samples at pcs that found the table full.
+  profile_sample_t table[PROFILE_SLOTS];
+} profile_t;
+//
 typedef struct pcb pcb_t;
 struct pcb {
   int pid;    // Process id.
@@ -98,12 +126,29 @@ struct pcb {
   int r1_stack_base_index;  // Lowest address in process's stack.
   int r1_break_limit_index; // Lowest address above process's heap.
 
+  int shm_id;               // Attached shared memory segment (0 if none).
+  int r1_shm_base_index;    // First page of the segment in Region 1.
+
+  struct open_file* files[MAX_OPEN_FILES]; // Indexed by file descriptor (NULL if unused).
+  readahead_t       sector_ra;             // Over ReadSector()'s sectors.
+
+  int work[NUM_WORK]; // Work done for this process, since it was created (Counters.h).
+  profile_t* profile; // Clock samples; NULL unless Profile() was ever turned on.
+
   UserContext   u_context;
   KernelContext k_context;
 
   // Doubly linked list.
   pcb_t* prev;
   pcb_t* next;
+  struct queue* queue; // Queue this process is in (NULL if none). Maintained by AddToQueue().
+
+  // Timed waits (see StartTimeout() in Utility.h).
+  int           timeout_time;  // Tick at which the wait gives up.
+  struct queue* timeout_queue; // Queue the process waits on (NULL if not in a timed wait).
+  int           timed_out;     // Set by HandleTrapClock() when the wait gives up.
+  pcb_t*        timer_prev;    // Doubly linked list of timed waits, sorted by timeout_time.
+  pcb_t*        timer_next;
 
   // Information about children.
   int num_children; /* alive */ // Used to ensure that Wait() returns immediately if no children.
@@ -112,7 +157,7 @@ struct pcb {
 };
 //
 // Queues for process control blocks.
-typedef struct {
+typedef struct queue {
   pcb_t* head;
   int size;
 } queue_t;
@@ -137,6 +182,75 @@ typedef struct {
 //
 // -------- -------- -------- -------- -------- -------- -------- --------
 //
+// Terminal output.
+//
+// TtyWrite() copies its bytes into a record and returns. Each process writing to the
+// terminal has a stream of records, in the order it wrote them.
+//
+// TtyStartTransmit() builds the next chunk (at most TERMINAL_MAX_LINE bytes) by visiting
+// the streams round-robin:
+// - A record that fits in what is left of the chunk goes in whole. Several small
+//   writes thus share one TtyTransmit().
+// - A large record (from a write of more than TERMINAL_MAX_LINE bytes) is cut at the
+//   last newline that fits, so that other streams get their turn at line boundaries.
+// - A small record that does not fit waits for the next chunk: it is never split.
+// Bytes count in the terminal's budget (TTY_OUTPUT_SIZE) until their transmission
+// completes.
+typedef struct tty_record tty_record_t;
+struct tty_record {
+  char*         data;
+  int           length;
+  int           sent;  // Bytes of data already put in a chunk.
+  int           large; // From a write of more than TERMINAL_MAX_LINE bytes.
+  tty_record_t* next;
+};
+typedef struct tty_stream tty_stream_t;
+struct tty_stream {
+  int           pid;
+  int           bytes; // Bytes in records, not yet in a chunk.
+  tty_record_t* head;
+  tty_record_t* tail;
+  tty_stream_t* next;
+};
+typedef struct {
+  tty_stream_t* streams;   // Next to be served first.
+  int           count;     // Bytes buffered, including those in flight.
+  int           in_flight; // Bytes handed to TtyTransmit(). 0 if the terminal is idle.
+  //
+  // Counters.
+  int           transmits;  // Completed TtyTransmit()s.
+  int           bytes_sent;
+} tty_output_t;
+//
+// Terminal input rings.
+//
+// HandleTrapTtyReceive() calls TtyReceive() right away and appends the line here;
+// TtyRead() takes from the first line, and leaves what it does not take for the next
+// TtyRead(). A line which does not fit is dropped and counted as an overrun.
+typedef struct {
+  char* data;                       // TTY_INPUT_SIZE bytes.
+  int   head;                       // Index of the oldest byte.
+  int   count;                      // Bytes in the ring.
+  int   line_len[TTY_INPUT_LINES];  // Bytes left in each line, oldest at line_head.
+  int   line_head;
+  int   lines;                      // Lines in the ring.
+  //
+  // Counters.
+  int   bytes_buffered;             // Bytes ever appended.
+  int   overruns;                   // Lines ever dropped.
+} tty_input_t;
+//
+// Pollers.
+//
+// A process blocked in Poll() waits in POLLING, not in its sources' queues (a pcb is
+// in one queue at a time). Instead, it is listed in each source's pollers, and the
+// source wakes up everyone listed when it becomes ready. See WakePollers().
+typedef struct poller poller_t;
+struct poller {
+  pcb_t*    proc;
+  poller_t* next;
+};
+//
 // Locks.
 typedef struct {
   pcb_t*  owner; // Only owner can destroy this lock.
@@ -157,23 +271,185 @@ typedef struct {
   char*   buffer;
   int     length; // Length of buffer.
   queue_t QUEUE;
+  poller_t* pollers; // Processes which Poll() this pipe.
 } pipe_t;
 //
+// Reader-writer locks.
+//
+// Any number of readers or a single writer may hold the lock. Once a writer is
+// waiting, new readers wait too (writer preference). When a writer releases, all
+// readers which queued up behind it get the lock at once; if there are none, the
+// next writer does. When the last reader releases, the next writer gets the lock.
+typedef struct holder holder_t;
+struct holder {
+  pcb_t*    proc;
+  holder_t* next;
+};
+typedef struct {
+  pcb_t*    owner;       // Only owner can destroy this lock.
+  pcb_t*    writer;      // Process which holds this lock for writing (NULL if none).
+  holder_t* readers;     // Processes which hold this lock for reading.
+  int       num_readers;
+  queue_t   READERS;     // Processes waiting to read.
+  queue_t   WRITERS;     // Processes waiting to write.
+} rwlock_t;
+//
+// Shared memory segments.
+//
+// The segment holds one reference to each of its frames, and each attached
+// process holds another (through its page table). The segment is destroyed when
+// its last attacher detaches or exits. A segment no one has attached yet lives
+// until its owner Reclaim()s it.
+typedef struct {
+  pcb_t*  owner;    // Only owner can destroy this segment (while no one is attached).
+  int     npg;      // Number of pages in the segment.
+  int*    frames;   // frames[0..(npg-1)].
+  int     attached; // Number of processes which have the segment mapped.
+  int     zeroed;   // Frames are zeroed by the first ShmAttach().
+} shm_t;
+//
 // interp_t struct
 ///
 // Interp ID (IID) is implicitly stored as the interp's index in interp_array.
 typedef struct {
   enum {
-    LOCK, CVAR, PIPE
+    LOCK, CVAR, PIPE, SHM, RWLOCK
   } type;
   union {
-    lock_t* lock;
-    cvar_t* cvar;
-    pipe_t* pipe;
+    lock_t*   lock;
+    cvar_t*   cvar;
+    pipe_t*   pipe;
+    shm_t*    shm;
+    rwlock_t* rwlock;
   } ptr;
 } interp_t;
 //
 // -------- -------- -------- -------- -------- -------- -------- --------
 
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Disk requests.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// See Disk.h.
+typedef struct disk_request disk_request_t;
+struct disk_request {
+  int     op;      // DISK_READ or DISK_WRITE.
+  int     sector;
+  char*   buffer;  // SECTORSIZE bytes in kernel memory.
+  int     async;   // No one waits; freed (with buffer) when done.
+  int     done;
+  int     result;  // SUCCESS or ERROR, once done.
+  queue_t WAITERS; // Processes waiting for this request.
+  int     deadline; // In ticks. Past it, the request is served ahead of C-LOOK order.
+  void  (*callback)(disk_request_t*); // If set, called when done instead of waking WAITERS.
+  void*   owner;                      // For callback.
+  disk_request_t* next;     // In disk_queue.
+  disk_request_t* run_next; // Next sector of the same multi-sector operation.
+  disk_request_t* dups;     // Reads of the same sector, served by the same access.
+};
+//
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Buffer cache.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// See Cache.h.
+typedef struct buf buf_t;
+struct buf {
+  int     sector;  // -1 if the buffer holds no sector.
+  int     dirty;   // data is newer than the disk.
+  int     busy;    // A disk access is filling or writing back data.
+  int     refs;    // Holders (CacheGet() without CacheRelease()); never evicted while > 0.
+  int     readahead; // Read ahead by CachePrefetch() and not used yet.
+  char*   data;    // SECTORSIZE bytes.
+  queue_t WAITERS; // Processes waiting for busy to clear.
+  buf_t*  hash_next; // In buf_hash[].
+  buf_t*  lru_prev;  // Toward the most recently used buffer.
+  buf_t*  lru_next;  // Toward the least recently used buffer.
+};
+//
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// File system.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// See Fs.h.
+//
+// In-core inode: an entry of the inode cache.
+typedef struct {
+  int          inum;  // 0 if the entry is free.
+  int          refs;  // Holders (IGet() without IPut()); never evicted while > 0.
+  int          stamp; // fs_stamp when last used; the lowest is evicted first.
+  struct inode inode;
+} icache_t;
+//
+// Entry of the name cache: name in directory dir is inode inum.
+typedef struct {
+  int  dir;   // 0 if the entry is free.
+  int  len;
+  char name[DIRNAMELEN];
+  int  inum;
+  int  stamp;
+} dcache_t;
+//
+// Program image in the file system, as written by InstallProgram(): this header in
+// the first block, then the text pages from li.t_faddr and the data pages from
+// li.id_faddr. li was checked when the image was installed.
+#define IMAGE_MAGIC 0x59494d47 // "YIMG"
+typedef struct {
+  int              magic;
+  struct load_info li;
+} image_header_t;
+//
+// Entry of the load_info cache: what LoadInfo() said about a Linux file, valid while
+// the file keeps its size and its modification and change times, to the nanosecond
+// (a program relinked within a second, to the same size, is a different program).
+typedef struct {
+  dev_t  dev;   // dev and ino say which file; ino is 0 if the entry is free.
+  ino_t  ino;
+  off_t  size;
+  struct timespec mtime;
+  struct timespec ctime;
+  int    stamp; // li_stamp when last used; the lowest is replaced first.
+  struct load_info li;
+} li_cache_t;
+//
+// Open file, shared by the descriptors that Fork() copies.
+typedef struct open_file open_file_t;
+struct open_file {
+  int inum;
+  int pos;  // Offset of the next Read() or Write().
+  int refs; // Descriptors (in any process) which refer to this.
+  readahead_t ra; // Over the file's blocks.
+  open_file_t* next; // In open_files.
+};
+//
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Spawn().
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// Handed from a Spawn() caller to its child, which loads the program and reports back.
+typedef struct {
+  char*   name;    // Kernel copies of Spawn()'s arguments.
+  char**  args;
+  int     done;    // The child has tried to load name.
+  int     result;  // SUCCESS, ERROR or KILL from LoadProgram(), once done.
+  queue_t WAITERS; // The caller, until done.
+} spawn_t;
+//
+// -------- -------- -------- -------- -------- -------- -------- --------
+
 #endif
 // End of DataStructures.h
@@ -0,0 +1,192 @@
+// Disk.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Disk driver. See Disk.h.
+
+#include "Disk.h"
+#include "ContextSwitch.h"
+
+disk_request_t* DiskNewRequest(int op, int sector, char* buffer, int async) {
+  disk_request_t* request = (disk_request_t*)malloc(sizeof(disk_request_t));
+  assert(request);
+  request->op       = op;
+  request->sector   = sector;
+  request->buffer   = buffer;
+  request->async    = async;
+  request->done     = 0;
+  request->result   = SUCCESS;
+  request->deadline = ticks + DISK_DEADLINE;
+  request->callback = NULL;
+  request->owner    = NULL;
+  request->next     = NULL;
+  request->run_next = NULL;
+  request->dups     = NULL;
+  InitQueue(&request->WAITERS);
+  return request;
+}
+
+// Helper method for DiskPick().
+void DiskUnqueue(disk_request_t* request) {
+  disk_request_t** link;
+  for(link = &disk_queue; *link != request; link = &(*link)->next) {
+    WORK(NODES_WALKED, 1);
+  }
+  *link = request->next;
+  request->next = NULL;
+}
+
+// Helper method for DiskPick(). Returns the pending request with op and sector, if any.
+disk_request_t* DiskFind(int op, int sector) {
+  disk_request_t* request;
+  for(request = disk_queue; request != NULL; request = request->next) {
+    WORK(NODES_WALKED, 1);
+    if( request->op == op && request->sector == sector ) {
+      return request;
+    }
+  }
+  return NULL;
+}
+
+// Takes the next operation out of disk_queue: a run of requests for consecutive
+// sectors, linked through run_next. See Disk.h.
+disk_request_t* DiskPick(void) {
+  disk_request_t* pick = NULL;
+
+  // disk_queue is oldest first, so only its head can be overdue first.
+  if( ticks >= disk_queue->deadline ) {
+    pick = disk_queue;
+    KTRACE(TRACE_VERBOSE, "DiskPick(): sector %d is overdue.\n", pick->sector);
+  } else {
+    disk_request_t* lowest = NULL;
+    disk_request_t* request;
+    for(request = disk_queue; request != NULL; request = request->next) {
+      if( request->sector >= disk_head && (pick == NULL || request->sector < pick->sector) ) {
+	pick = request;
+      }
+      if( lowest == NULL || request->sector < lowest->sector ) {
+	lowest = request;
+      }
+    }
+    if( pick == NULL ) {
+      pick = lowest; // Wrap around.
+    }
+  }
+  DiskUnqueue(pick);
+
+  // Build the run. Writes to one sector are not merged: they must land in order.
+  // Nothing is merged past a pending request of the other op for the same sector
+  // (e.g., a write-back from the buffer cache), which may be older.
+  int other = pick->op == DISK_READ ? DISK_WRITE : DISK_READ;
+  disk_request_t* last = pick;
+  int i;
+  for(i = 0; i < DISK_MERGE_MAX; i++) {
+    disk_request_t* dup;
+    while( last->op == DISK_READ && DiskFind(DISK_WRITE, last->sector) == NULL &&
+	   (dup = DiskFind(DISK_READ, last->sector)) != NULL ) {
+      DiskUnqueue(dup);
+      dup->next  = last->dups;
+      last->dups = dup;
+    }
+    if( i == DISK_MERGE_MAX - 1 ) {
+      break;
+    }
+    disk_request_t* next = DiskFind(pick->op, last->sector + 1);
+    if( next == NULL || DiskFind(other, last->sector + 1) != NULL ) {
+      break;
+    }
+    DiskUnqueue(next);
+    last->run_next = next;
+    last = next;
+  }
+  return pick;
+}
+
+// Helper method for DiskSubmit() and HandleTrapDisk().
+void DiskStart(disk_request_t* request) {
+  disk_current = request;
+  disk_head    = request->sector;
+
+  KTRACE(TRACE_VERBOSE, "DiskStart(): %s sector %d.\n",
+	      request->op == DISK_READ ? "reading" : "writing", request->sector);
+  DiskAccess(request->op, request->sector, request->buffer);
+}
+
+void DiskSubmit(disk_request_t* request) {
+  // Append, so that disk_queue stays oldest first.
+  disk_request_t** link;
+  for(link = &disk_queue; *link != NULL; link = &(*link)->next) {
+    WORK(NODES_WALKED, 1);
+  }
+  *link = request;
+
+  if( disk_current == NULL ) {
+    DiskStart(DiskPick());
+  }
+}
+
+int DiskWait(disk_request_t* request) {
+  while( !request->done ) {
+    ContextSwitch(READY.head, &READY, &request->WAITERS);
+  }
+  int result = request->result;
+  free(request);
+  return result;
+}
+
+int DiskIO(int op, int sector, char* buffer) {
+  disk_request_t* request = DiskNewRequest(op, sector, buffer, 0);
+  DiskSubmit(request);
+  return DiskWait(request);
+}
+
+// Helper method for HandleTrapDisk().
+void DiskComplete(disk_request_t* request) {
+  request->done = 1;
+  if( request->callback != NULL ) {
+    request->callback(request);
+    return;
+  }
+  if( request->async ) {
+    free(request->buffer);
+    free(request);
+    return;
+  }
+  while( request->WAITERS.head != NULL ) {
+    pcb_t* proc = request->WAITERS.head;
+    RemoveFromQueue(proc, &request->WAITERS);
+    AddToQueue(proc, &READY);
+  }
+}
+
+void HandleTrapDisk(UserContext* u_context) {
+  KTRACE(TRACE_TRAP, "TRAP_DISK\n");
+
+  disk_request_t* request = disk_current;
+  if( request == NULL ) {
+    TracePrintf(TRACE_WRONG, "HandleTrapDisk(): no request was in flight.\n");
+    return;
+  }
+  disk_current = NULL;
+  EVENT(EV_DISK, request->sector, request->op, 0);
+  COUNT(DISK_TRAPS);
+
+  // Keep the disk busy first: the rest of the run, or whatever comes next.
+  if( request->run_next != NULL ) {
+    DiskStart(request->run_next);
+  } else if( disk_queue != NULL ) {
+    DiskStart(DiskPick());
+  }
+
+  // Reads merged into this one get a copy of the sector.
+  while( request->dups != NULL ) {
+    disk_request_t* dup = request->dups;
+    request->dups = dup->next;
+    memcpy(dup->buffer, request->buffer, SECTORSIZE);
+    dup->result = request->result;
+    DiskComplete(dup);
+  }
+  DiskComplete(request);
+}
+
+// End of Disk.c
@@ -0,0 +1,49 @@
+// Disk.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Disk driver.
+//
+// The disk does one DiskAccess() at a time and raises TRAP_DISK when it is done.
+// Requests wait in disk_queue until the disk is free; HandleTrapDisk() completes the
+// one in flight and starts the next. A process which needs the result blocks on the
+// request's own WAITERS queue, not on the disk.
+//
+// Scheduling (DiskPick()):
+// - C-LOOK: the next request is the one with the lowest sector at or after disk_head;
+//   past the last one, the head goes back to the lowest sector.
+// - A request older than DISK_DEADLINE ticks goes first, so none starves.
+// - Requests for the sectors right after the picked one (same op) are merged into one
+//   multi-sector operation of up to DISK_MERGE_MAX sectors, issued back to back.
+//   Reads of the picked sector itself share its access.
+//
+// Buffers handed to the disk must be in kernel memory (Region 0).
+
+#ifndef DISK_H
+#define DISK_H
+
+#include "DataStructures.h"
+#include "KernelGlobals.h"
+#include "Utility.h"
+
+// Makes a request for one sector. buffer is SECTORSIZE bytes of kernel memory.
+// With async set, no one waits: HandleTrapDisk() frees the request and its buffer.
+// A request with a callback (set after DiskNewRequest()) is handed to it when done,
+// from the disk trap; the callback then owns the request and its buffer.
+disk_request_t* DiskNewRequest(int op /*DISK_READ or DISK_WRITE*/, int sector, char* buffer, int async);
+
+// Queues request, and starts it if the disk is idle.
+void DiskSubmit(disk_request_t* request);
+
+// Blocks the running process until request is done, then frees request (not its buffer).
+// Returns SUCCESS, or ERROR if the request failed.
+int DiskWait(disk_request_t* request);
+
+// DiskSubmit() followed by DiskWait().
+int DiskIO(int op, int sector, char* buffer);
+
+// TRAP_DISK.
+void HandleTrapDisk(UserContext* u_context);
+
+#endif
+// End of Disk.h
@@ -0,0 +1,53 @@
+// Events.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Kernel event log: what the scheduler, the traps and the system calls did, in binary.
+//
+// The kernel records each event with EVENT() (KernelGlobals.h) into a ring of the last
+// EVENT_RING_SIZE events; recording one is a handful of stores. The ring is written to
+// the Linux file EVENT_FILE when the kernel halts, and whenever a process calls
+// DumpEvents(). The file is an events_header_t followed by its events, oldest first.
+//
+// tools/EventDecode turns the file into a timeline, or into Chrome trace-event JSON
+// (load it in chrome://tracing or ui.perfetto.dev).
+//
+// This header is shared by the kernel and tools/; it uses only 32-bit ints, so the
+// layout is the same for the -m32 kernel and a 64-bit host.
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#define EVENT_FILE      "EVENTS"
+#define EVENT_MAGIC     0x59455654 // "YEVT"
+#define EVENT_RING_SIZE 4096       // Must be a power of 2.
+#define EVENT_ARGS      3
+
+// Event types, and what their args are.
+#define EV_SWITCH       1 // ContextSwitch(): pid switches to args[0]; args[1] is 1 if pid stays READY (preempted).
+#define EV_SYSCALL      2 // System call entered: args[0] is the code (YALNIX_*), args[1] the custom code
+                          // (CUSTOM_*) for YALNIX_CUSTOM_0.
+#define EV_SYSCALL_DONE 3 // System call returns to pid: args[0] and args[1] as above, args[2] the result.
+#define EV_FAULT        4 // TRAP_MEMORY: args[0] is the address, args[1] the code (YALNIX_MAPERR/ACCERR).
+#define EV_READY        5 // args[0] is added to READY (woken up, or preempted).
+#define EV_TTY_RECEIVE  6 // TRAP_TTY_RECEIVE: args[0] is the terminal, args[1] the bytes received.
+#define EV_TTY_TRANSMIT 7 // TRAP_TTY_TRANSMIT: args[0] is the terminal, args[1] the bytes sent.
+#define EV_DISK         8 // TRAP_DISK: args[0] is the sector, args[1] DISK_READ or DISK_WRITE.
+#define EV_EXIT         9 // Process args[0] dies with exit status args[1].
+#define EV_NUM_TYPES    10
+
+typedef struct {
+  int tick; // ticks when it happened.
+  int pid;  // Running process (-1 if none).
+  int type; // EV_*.
+  int args[EVENT_ARGS];
+} event_t;
+
+typedef struct {
+  int magic;   // EVENT_MAGIC.
+  int count;   // Events that follow.
+  int dropped; // Older events overwritten in the ring before the dump.
+} events_header_t;
+
+#endif
+// End of Events.h
@@ -0,0 +1,745 @@
+// Fs.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// File system. See Fs.h.
+
+#include "Fs.h"
+#include "Cache.h"
+#include "ContextSwitch.h"
+
+#define DIRENT_SIZE   ((int)sizeof(struct dir_entry))
+#define NUM_INDIRECT  (BLOCKSIZE / (int)sizeof(int))
+#define MAX_FILE_SIZE ((NUM_DIRECT + NUM_INDIRECT) * BLOCKSIZE)
+
+// First block after the inodes.
+#define FIRST_DATA_BLOCK (1 + (fs_info.num_inodes + 1 + INODES_PER_BLOCK - 1) / INODES_PER_BLOCK)
+
+void FsInit(void) {
+  icache = (icache_t*)calloc(INODE_CACHESIZE, sizeof(icache_t));
+  assert(icache);
+  dcache = (dcache_t*)calloc(FS_DCACHE_SIZE, sizeof(dcache_t));
+  assert(dcache);
+  InitQueue(&FS_WAITING);
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Inodes and blocks.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// Returns the in-core inode inum, held until IPut(), or NULL if it cannot be read.
+icache_t* IGet(int inum) {
+  icache_t* victim = NULL;
+  int i;
+  for(i = 0; i < INODE_CACHESIZE; i++) {
+    if( icache[i].inum == inum ) {
+      icache[i].refs++;
+      icache[i].stamp = ++fs_stamp;
+      return &icache[i];
+    }
+    if( icache[i].refs == 0 && (victim == NULL || icache[i].stamp < victim->stamp) ) {
+      victim = &icache[i];
+    }
+  }
+  if( victim == NULL ) {
+    TracePrintf(TRACE_WRONG, "IGet(): every cached inode is in use.\n");
+    return NULL;
+  }
+
+  buf_t* buf = CacheGet(1 + inum / INODES_PER_BLOCK, 1);
+  if( buf == NULL ) {
+    return NULL;
+  }
+  memcpy(&victim->inode, buf->data + (inum % INODES_PER_BLOCK) * INODESIZE, sizeof(struct inode));
+  CacheRelease(buf, 0);
+  victim->inum  = inum;
+  victim->refs  = 1;
+  victim->stamp = ++fs_stamp;
+  return victim;
+}
+
+void IPut(icache_t* ip) {
+  ip->refs--;
+}
+
+// Writes ip->inode through to the buffer cache.
+int IUpdate(icache_t* ip) {
+  buf_t* buf = CacheGet(1 + ip->inum / INODES_PER_BLOCK, 1);
+  if( buf == NULL ) {
+    return ERROR;
+  }
+  memcpy(buf->data + (ip->inum % INODES_PER_BLOCK) * INODESIZE, &ip->inode, sizeof(struct inode));
+  CacheRelease(buf, 1);
+  return SUCCESS;
+}
+
+// Returns a zeroed free block, or 0 if the disk is full.
+int FsBlockAlloc(void) {
+  int block;
+  for(block = FIRST_DATA_BLOCK; block < fs_info.num_blocks; block++) {
+    if( !fs_block_used[block] ) {
+      fs_block_used[block] = 1;
+      buf_t* buf = CacheGet(block, 0);
+      memset(buf->data, 0, BLOCKSIZE);
+      CacheRelease(buf, 1);
+      return block;
+    }
+  }
+  TracePrintf(TRACE_USER_WARNING, "FsBlockAlloc(): the disk is full.\n");
+  return 0;
+}
+
+// Returns a free inode number, or 0 if there is none.
+int FsInodeAlloc(void) {
+  int inum;
+  for(inum = ROOTINODE + 1; inum <= fs_info.num_inodes; inum++) {
+    if( !fs_inode_used[inum] ) {
+      fs_inode_used[inum] = 1;
+      return inum;
+    }
+  }
+  TracePrintf(TRACE_USER_WARNING, "FsInodeAlloc(): no inode is free.\n");
+  return 0;
+}
+
+// Returns the disk block holding block n of the file, or 0 if there is none. With
+// alloc set, a missing block is allocated (0 if the disk is full).
+int FsBmap(icache_t* ip, int n, int alloc) {
+  struct inode* inode = &ip->inode;
+  if( n < NUM_DIRECT ) {
+    if( inode->direct[n] == 0 && alloc && (inode->direct[n] = FsBlockAlloc()) != 0 ) {
+      IUpdate(ip);
+    }
+    return inode->direct[n];
+  }
+
+  n -= NUM_DIRECT;
+  if( n >= NUM_INDIRECT ) {
+    return 0;
+  }
+  if( inode->indirect == 0 ) {
+    if( !alloc || (inode->indirect = FsBlockAlloc()) == 0 ) {
+      return 0;
+    }
+    IUpdate(ip);
+  }
+  buf_t* buf = CacheGet(inode->indirect, 1);
+  if( buf == NULL ) {
+    return 0;
+  }
+  int* table = (int*)buf->data;
+  int  dirty = 0;
+  if( table[n] == 0 && alloc && (table[n] = FsBlockAlloc()) != 0 ) {
+    dirty = 1;
+  }
+  int block = table[n];
+  CacheRelease(buf, dirty);
+  return block;
+}
+
+// Frees every block of the file and sets its size to 0.
+void FsTruncate(icache_t* ip) {
+  struct inode* inode = &ip->inode;
+  int i;
+  for(i = 0; i < NUM_DIRECT; i++) {
+    if( inode->direct[i] != 0 ) {
+      fs_block_used[inode->direct[i]] = 0;
+      inode->direct[i] = 0;
+    }
+  }
+  if( inode->indirect != 0 ) {
+    buf_t* buf = CacheGet(inode->indirect, 1);
+    if( buf != NULL ) {
+      int* table = (int*)buf->data;
+      for(i = 0; i < NUM_INDIRECT; i++) {
+	if( table[i] != 0 ) {
+	  fs_block_used[table[i]] = 0;
+	}
+      }
+      CacheRelease(buf, 0);
+    }
+    fs_block_used[inode->indirect] = 0;
+    inode->indirect = 0;
+  }
+  inode->size = 0;
+  IUpdate(ip);
+}
+
+int FsReadi(icache_t* ip, char* buffer, int pos, int length) {
+  if( pos >= ip->inode.size ) {
+    return 0;
+  }
+  if( length > ip->inode.size - pos ) {
+    length = ip->inode.size - pos;
+  }
+  int done = 0;
+  while( done < length ) {
+    int offset = (pos + done) % BLOCKSIZE;
+    int chunk  = BLOCKSIZE - offset < length - done ? BLOCKSIZE - offset : length - done;
+    int block  = FsBmap(ip, (pos + done) / BLOCKSIZE, 0);
+    if( block == 0 ) {
+      memset(buffer + done, 0, chunk); // A hole.
+    } else {
+      buf_t* buf = CacheGet(block, 1);
+      if( buf == NULL ) {
+	break;
+      }
+      memcpy(buffer + done, buf->data + offset, chunk);
+      WORK(BYTES_COPIED, chunk);
+      CacheRelease(buf, 0);
+    }
+    done += chunk;
+  }
+  return done;
+}
+
+int FsWritei(icache_t* ip, char* buffer, int pos, int length) {
+  int done = 0;
+  while( done < length && pos + done < MAX_FILE_SIZE ) {
+    int offset = (pos + done) % BLOCKSIZE;
+    int chunk  = BLOCKSIZE - offset < length - done ? BLOCKSIZE - offset : length - done;
+    int block  = FsBmap(ip, (pos + done) / BLOCKSIZE, 1);
+    if( block == 0 ) {
+      break;
+    }
+    buf_t* buf = CacheGet(block, chunk < BLOCKSIZE);
+    if( buf == NULL ) {
+      break;
+    }
+    memcpy(buf->data + offset, buffer + done, chunk);
+    WORK(BYTES_COPIED, chunk);
+    CacheRelease(buf, 1);
+    done += chunk;
+  }
+  if( pos + done > ip->inode.size ) {
+    ip->inode.size = pos + done;
+    IUpdate(ip);
+  }
+  return done;
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Directories and paths.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// Returns 1 if entry is called name (len bytes, not NUL-terminated).
+int FsNameIs(struct dir_entry* entry, char* name, int len) {
+  return memcmp(entry->name, name, len) == 0 && (len == DIRNAMELEN || entry->name[len] == '\0');
+}
+
+dcache_t* DcacheFind(int dir, char* name, int len) {
+  int i;
+  for(i = 0; i < FS_DCACHE_SIZE; i++) {
+    if( dcache[i].dir == dir && dcache[i].len == len && memcmp(dcache[i].name, name, len) == 0 ) {
+      return &dcache[i];
+    }
+  }
+  return NULL;
+}
+
+void DcacheAdd(int dir, char* name, int len, int inum) {
+  dcache_t* entry = DcacheFind(dir, name, len);
+  if( entry == NULL ) {
+    // Take a free entry, or else the least recently used one.
+    entry = &dcache[0];
+    int i;
+    for(i = 1; i < FS_DCACHE_SIZE && entry->dir != 0; i++) {
+      if( dcache[i].dir == 0 || dcache[i].stamp < entry->stamp ) {
+	entry = &dcache[i];
+      }
+    }
+  }
+  entry->dir   = dir;
+  entry->len   = len;
+  memcpy(entry->name, name, len);
+  entry->inum  = inum;
+  entry->stamp = ++fs_stamp;
+}
+
+// Returns the inode number of name in directory dp, or 0. *slot is set to the offset of
+// the entry (if found) or of the first free entry (-1 if none).
+int FsDirLookup(icache_t* dp, char* name, int len, int* slot) {
+  dcache_t* cached = DcacheFind(dp->inum, name, len);
+  if( cached != NULL && slot == NULL ) {
+    cached->stamp = ++fs_stamp;
+    return cached->inum;
+  }
+
+  struct dir_entry entry;
+  int pos;
+  if( slot != NULL ) {
+    *slot = -1;
+  }
+  for(pos = 0; pos + DIRENT_SIZE <= dp->inode.size; pos += DIRENT_SIZE) {
+    if( FsReadi(dp, (char*)&entry, pos, DIRENT_SIZE) != DIRENT_SIZE ) {
+      return 0;
+    }
+    if( entry.inum == 0 ) {
+      if( slot != NULL && *slot == -1 ) {
+	*slot = pos;
+      }
+    } else if( FsNameIs(&entry, name, len) ) {
+      if( slot != NULL ) {
+	*slot = pos;
+      }
+      DcacheAdd(dp->inum, name, len, entry.inum);
+      return entry.inum;
+    }
+  }
+  return 0;
+}
+
+// Writes the entry (name -> inum) at pos of directory dp (past the end to append).
+// inum 0 frees the entry.
+int FsDirSet(icache_t* dp, int pos, char* name, int len, int inum) {
+  struct dir_entry entry;
+  memset(&entry, 0, DIRENT_SIZE);
+  entry.inum = inum;
+  memcpy(entry.name, name, len);
+  if( pos < 0 ) {
+    pos = dp->inode.size;
+  }
+  if( FsWritei(dp, (char*)&entry, pos, DIRENT_SIZE) != DIRENT_SIZE ) {
+    return ERROR;
+  }
+  if( inum == 0 ) {
+    dcache_t* cached = DcacheFind(dp->inum, name, len);
+    if( cached != NULL ) {
+      cached->dir = 0;
+    }
+  } else {
+    DcacheAdd(dp->inum, name, len, inum);
+  }
+  return SUCCESS;
+}
+
+// Helper method for FsWalk(). Skips to the next component of *path, sets *name to it
+// and returns its length (0 at the end).
+int FsNextName(char** path, char** name) {
+  char* p = *path;
+  while( *p == '/' ) {
+    p++;
+  }
+  *name = p;
+  while( *p != '/' && *p != '\0' ) {
+    p++;
+  }
+  *path = p;
+  return p - *name;
+}
+
+// Returns the inode number of path, or 0 if it does not exist. With parent set, returns
+// that of the directory holding the last component instead, and copies the component
+// into last (*last_len bytes).
+int FsWalk(char* path, int parent, char* last, int* last_len) {
+  int   inum = ROOTINODE;
+  char* name;
+  int   len = FsNextName(&path, &name);
+  if( parent && len == 0 ) {
+    return 0; // The root is in no directory.
+  }
+  while( len > 0 ) {
+    if( len > DIRNAMELEN ) {
+      return 0;
+    }
+    char* next_name;
+    int   next_len = FsNextName(&path, &next_name);
+    if( parent && next_len == 0 ) {
+      memcpy(last, name, len);
+      *last_len = len;
+      return inum;
+    }
+
+    icache_t* dp = IGet(inum);
+    if( dp == NULL ) {
+      return 0;
+    }
+    inum = dp->inode.type == INODE_DIRECTORY ? FsDirLookup(dp, name, len, NULL) : 0;
+    IPut(dp);
+    if( inum == 0 ) {
+      return 0;
+    }
+    name = next_name;
+    len  = next_len;
+  }
+  return inum;
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Mounting.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// Helper method for FsMount().
+void FsNewMaps(void) {
+  free(fs_block_used);
+  free(fs_inode_used);
+  fs_block_used = (char*)calloc(fs_info.num_blocks, 1);
+  assert(fs_block_used);
+  fs_inode_used = (char*)calloc(fs_info.num_inodes + 1, 1);
+  assert(fs_inode_used);
+  int block;
+  for(block = 0; block < FIRST_DATA_BLOCK; block++) {
+    fs_block_used[block] = 1;
+  }
+  fs_inode_used[0] = 1; // The header.
+}
+
+// Helper method for FsMount(). Marks the blocks of one inode as used; returns ERROR if
+// one is out of range.
+int FsScanBlocks(int* blocks, int count) {
+  int i;
+  for(i = 0; i < count; i++) {
+    if( blocks[i] < 0 || blocks[i] >= fs_info.num_blocks ) {
+      return ERROR;
+    }
+    if( blocks[i] != 0 ) {
+      fs_block_used[blocks[i]] = 1;
+    }
+  }
+  return SUCCESS;
+}
+
+// Helper method for FsMount(). Rebuilds the free maps from the inodes.
+int FsScan(void) {
+  FsNewMaps();
+  int inum;
+  for(inum = ROOTINODE; inum <= fs_info.num_inodes; inum++) {
+    buf_t* buf = CacheGet(1 + inum / INODES_PER_BLOCK, 1);
+    if( buf == NULL ) {
+      return ERROR;
+    }
+    struct inode inode;
+    memcpy(&inode, buf->data + (inum % INODES_PER_BLOCK) * INODESIZE, sizeof(struct inode));
+    CacheRelease(buf, 0);
+    if( inode.type == INODE_FREE ) {
+      continue;
+    }
+    fs_inode_used[inum] = 1;
+    if( FsScanBlocks(inode.direct, NUM_DIRECT) != SUCCESS || FsScanBlocks(&inode.indirect, 1) != SUCCESS ) {
+      return ERROR;
+    }
+    if( inode.indirect != 0 ) {
+      buf = CacheGet(inode.indirect, 1);
+      if( buf == NULL ) {
+	return ERROR;
+      }
+      int result = FsScanBlocks((int*)buf->data, NUM_INDIRECT);
+      CacheRelease(buf, 0);
+      if( result != SUCCESS ) {
+	return ERROR;
+      }
+    }
+  }
+  return fs_inode_used[ROOTINODE] ? SUCCESS : ERROR;
+}
+
+// Helper method for FsMount(). Makes an empty file system.
+int FsFormat(void) {
+  TracePrintf(TRACE_USER_WARNING, "FsFormat(): no file system on the disk; making one.\n");
+  memset(&fs_info, 0, sizeof(fs_info));
+  fs_info.num_blocks = NUMBLOCKS;
+  fs_info.num_inodes = FS_NUM_INODES;
+  FsNewMaps();
+
+  int block;
+  for(block = 1; block < FIRST_DATA_BLOCK; block++) {
+    buf_t* buf = CacheGet(block, 0);
+    memset(buf->data, 0, BLOCKSIZE);
+    if( block == 1 ) {
+      memcpy(buf->data, &fs_info, sizeof(fs_info));
+    }
+    CacheRelease(buf, 1);
+  }
+  // Forget inodes cached from the old disk contents.
+  memset(icache, 0, INODE_CACHESIZE * sizeof(icache_t));
+  memset(dcache, 0, FS_DCACHE_SIZE * sizeof(dcache_t));
+
+  fs_inode_used[ROOTINODE] = 1;
+  icache_t* root = IGet(ROOTINODE);
+  if( root == NULL ) {
+    return ERROR;
+  }
+  memset(&root->inode, 0, sizeof(struct inode));
+  root->inode.type  = INODE_DIRECTORY;
+  root->inode.nlink = 1;
+  int result = IUpdate(root);
+  if( result == SUCCESS ) {
+    result = FsDirSet(root, -1, ".", 1, ROOTINODE);
+  }
+  if( result == SUCCESS ) {
+    result = FsDirSet(root, -1, "..", 2, ROOTINODE);
+  }
+  IPut(root);
+  return result;
+}
+
+// Helper method for FsLock().
+int FsMount(void) {
+  buf_t* buf = CacheGet(1, 1);
+  if( buf == NULL ) {
+    return ERROR;
+  }
+  memcpy(&fs_info, buf->data, sizeof(fs_info));
+  CacheRelease(buf, 0);
+
+  int valid = fs_info.num_blocks == NUMBLOCKS && fs_info.num_inodes > ROOTINODE &&
+    fs_info.num_inodes < NUMBLOCKS * INODES_PER_BLOCK && FIRST_DATA_BLOCK < fs_info.num_blocks &&
+    FsScan() == SUCCESS;
+  if( valid ) {
+    icache_t* root = IGet(ROOTINODE);
+    valid = root != NULL && root->inode.type == INODE_DIRECTORY;
+    if( root != NULL ) {
+      IPut(root);
+    }
+  }
+  if( !valid && FsFormat() != SUCCESS ) {
+    return ERROR;
+  }
+  KTRACE(TRACE_VERBOSE, "FsMount(): %d blocks, %d inodes.\n", fs_info.num_blocks, fs_info.num_inodes);
+  fs_mounted = 1;
+  return SUCCESS;
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+int FsLock(void) {
+  while( fs_locked ) {
+    BlockOn(&FS_WAITING, NO_TIMEOUT);
+  }
+  fs_locked = 1;
+  if( !fs_mounted ) {
+    return FsMount();
+  }
+  return SUCCESS;
+}
+
+void FsUnlock(void) {
+  fs_locked = 0;
+  if( FS_WAITING.head != NULL ) {
+    pcb_t* proc = FS_WAITING.head;
+    RemoveFromQueue(proc, &FS_WAITING);
+    AddToQueue(proc, &READY);
+  }
+}
+
+int FsLookup(char* path) {
+  int inum = FsWalk(path, 0, NULL, NULL);
+  return inum != 0 ? inum : ERROR;
+}
+
+int FsCreate(char* path, int type) {
+  char name[DIRNAMELEN];
+  int  len;
+  int  parent = FsWalk(path, 1, name, &len);
+  if( parent == 0 ) {
+    return ERROR;
+  }
+  icache_t* dp = IGet(parent);
+  if( dp == NULL ) {
+    return ERROR;
+  }
+  if( dp->inode.type != INODE_DIRECTORY ) {
+    IPut(dp);
+    return ERROR;
+  }
+
+  int slot;
+  int inum = FsDirLookup(dp, name, len, &slot);
+  if( inum != 0 ) {
+    // Exists. Truncate a regular file; anything else is an error.
+    icache_t* ip = IGet(inum);
+    int result = ERROR;
+    if( ip != NULL && type == INODE_REGULAR && ip->inode.type == INODE_REGULAR ) {
+      FsTruncate(ip);
+      result = inum;
+    }
+    if( ip != NULL ) {
+      IPut(ip);
+    }
+    IPut(dp);
+    return result;
+  }
+
+  inum = FsInodeAlloc();
+  icache_t* ip = inum != 0 ? IGet(inum) : NULL;
+  if( ip == NULL ) {
+    IPut(dp);
+    return ERROR;
+  }
+  memset(&ip->inode, 0, sizeof(struct inode));
+  ip->inode.type  = type;
+  ip->inode.nlink = 1;
+  int result = IUpdate(ip);
+  if( result == SUCCESS && type == INODE_DIRECTORY ) {
+    result = FsDirSet(ip, -1, ".", 1, inum);
+    if( result == SUCCESS ) {
+      result = FsDirSet(ip, -1, "..", 2, parent);
+    }
+  }
+  if( result == SUCCESS ) {
+    result = FsDirSet(dp, slot, name, len, inum);
+  }
+  if( result != SUCCESS ) {
+    FsTruncate(ip);
+    ip->inode.type = INODE_FREE;
+    IUpdate(ip);
+    fs_inode_used[inum] = 0;
+  }
+  IPut(ip);
+  IPut(dp);
+  return result == SUCCESS ? inum : ERROR;
+}
+
+int FsIsOpen(int inum) {
+  open_file_t* file;
+  for(file = open_files; file != NULL; file = file->next) {
+    if( file->inum == inum ) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int FsUnlink(char* path) {
+  char name[DIRNAMELEN];
+  int  len;
+  int  parent = FsWalk(path, 1, name, &len);
+  if( parent == 0 ) {
+    return ERROR;
+  }
+  icache_t* dp = IGet(parent);
+  if( dp == NULL ) {
+    return ERROR;
+  }
+  int slot;
+  int inum = dp->inode.type == INODE_DIRECTORY ? FsDirLookup(dp, name, len, &slot) : 0;
+  icache_t* ip = inum != 0 ? IGet(inum) : NULL;
+  if( ip == NULL || ip->inode.type != INODE_REGULAR || FsIsOpen(inum) ) {
+    if( ip != NULL ) {
+      IPut(ip);
+    }
+    IPut(dp);
+    return ERROR;
+  }
+
+  int result = FsDirSet(dp, slot, name, len, 0);
+  if( result == SUCCESS && --ip->inode.nlink == 0 ) {
+    FsTruncate(ip);
+    ip->inode.type = INODE_FREE;
+    fs_inode_used[inum] = 0;
+  }
+  if( result == SUCCESS ) {
+    result = IUpdate(ip);
+  }
+  IPut(ip);
+  IPut(dp);
+  return result;
+}
+
+int FsRead(int inum, void* buffer, int pos, int length, readahead_t* ra) {
+  icache_t* ip = IGet(inum);
+  if( ip == NULL ) {
+    return ERROR;
+  }
+  int result = FsReadi(ip, (char*)buffer, pos, length);
+
+  // Read ahead, within the file, of a reader going through it in order.
+  if( ra != NULL && result > 0 ) {
+    int first;
+    int count = CacheReadAhead(ra, pos / BLOCKSIZE, (pos + result - 1) / BLOCKSIZE - pos / BLOCKSIZE + 1, &first);
+    int last  = (ip->inode.size - 1) / BLOCKSIZE;
+    int n;
+    for(n = first; n < first + count && n <= last; n++) {
+      int block = FsBmap(ip, n, 0);
+      if( block != 0 ) {
+	CachePrefetch(block);
+      }
+    }
+  }
+  IPut(ip);
+  return result;
+}
+
+int FsWrite(int inum, void* buffer, int pos, int length) {
+  icache_t* ip = IGet(inum);
+  if( ip == NULL ) {
+    return ERROR;
+  }
+  int result = FsWritei(ip, (char*)buffer, pos, length);
+  IPut(ip);
+  return result;
+}
+
+int FsStat(int inum, int* type, int* size) {
+  icache_t* ip = IGet(inum);
+  if( ip == NULL ) {
+    return ERROR;
+  }
+  *type = ip->inode.type;
+  *size = ip->inode.size;
+  IPut(ip);
+  return SUCCESS;
+}
+
+
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Open-file table.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+open_file_t* FsOpenFile(int inum) {
+  open_file_t* file = (open_file_t*)malloc(sizeof(open_file_t));
+  assert(file);
+  file->inum = inum;
+  file->pos  = 0;
+  file->refs = 1;
+  memset(&file->ra, 0, sizeof(file->ra)); // Not sequential until it reads.
+  file->next = open_files;
+  open_files = file;
+  return file;
+}
+
+void FsCloseFile(open_file_t* file) {
+  if( --file->refs > 0 ) {
+    return;
+  }
+  open_file_t** link;
+  for(link = &open_files; *link != file; link = &(*link)->next) {
+  }
+  *link = file->next;
+  free(file);
+}
+
+void FsForkProcess(pcb_t* parent, pcb_t* child) {
+  int fd;
+  for(fd = 0; fd < MAX_OPEN_FILES; fd++) {
+    child->files[fd] = parent->files[fd];
+    if( child->files[fd] != NULL ) {
+      child->files[fd]->refs++;
+    }
+  }
+}
+
+void FsCloseAll(pcb_t* proc) {
+  int fd;
+  for(fd = 0; fd < MAX_OPEN_FILES; fd++) {
+    if( proc->files[fd] != NULL ) {
+      FsCloseFile(proc->files[fd]);
+      proc->files[fd] = NULL;
+    }
+  }
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+// End of Fs.c
@@ -0,0 +1,71 @@
+// Fs.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// File system: YFS (include/filesystem.h), in the kernel, on top of the buffer cache.
+//
+// Layout. Block 0 is the boot block. The fs_header and the inodes follow from block 1,
+// INODES_PER_BLOCK to a block; the rest are data blocks. The free maps are not on the
+// disk: FsMount() rebuilds them by scanning the inodes. A disk without a valid file
+// system is formatted, with FS_NUM_INODES inodes and an empty root, the first time a
+// file system call is made.
+//
+// Caches.
+// - Inodes: INODE_CACHESIZE in-core inodes, least recently used evicted first. An
+//   inode change is written through to the buffer cache, which writes it back.
+// - Names: FS_DCACHE_SIZE (directory, name) -> inode entries, filled by lookups and
+//   kept up to date by FsCreate() and FsUnlink().
+//
+// Paths are absolute, or relative to the root (there is no current directory); "."
+// and ".." work. Names longer than DIRNAMELEN do not exist.
+//
+// One process at a time is in the file system: callers hold FsLock() around any
+// other Fs*() call, since those may block on the disk.
+
+#ifndef FS_H
+#define FS_H
+
+#include "DataStructures.h"
+#include "KernelGlobals.h"
+#include "Utility.h"
+
+#define INODES_PER_BLOCK (BLOCKSIZE / INODESIZE)
+
+// Allocates the caches. Called once from KernelStart().
+void FsInit(void);
+
+// Waits until no one else is in the file system, then mounts it if need be.
+// Returns ERROR if the disk cannot be read; the lock is held either way.
+int  FsLock(void);
+void FsUnlock(void);
+
+// Returns the inode number of path, or ERROR if it does not exist.
+int FsLookup(char* path);
+
+// Makes path a new file of type (INODE_REGULAR or INODE_DIRECTORY) and returns its
+// inode number. An existing regular file is truncated instead; an existing directory
+// is an ERROR.
+int FsCreate(char* path, int type);
+
+// Removes path, which must be a regular file that no one has open.
+int FsUnlink(char* path);
+
+// Read or write length bytes at pos of inode inum, between the file and buffer (in the
+// kernel or in the running process). Return the number of bytes moved, which is short
+// at the end of the file (reads) or when the disk or the file is full (writes).
+// FsRead() reads ahead through ra (NULL for none); see Cache.h.
+int FsRead (int inum, void* buffer, int pos, int length, readahead_t* ra);
+int FsWrite(int inum, void* buffer, int pos, int length);
+
+// Sets *type and *size from inode inum.
+int FsStat(int inum, int* type, int* size);
+
+// Open-file table.
+open_file_t* FsOpenFile(int inum);      // refs is 1.
+void FsCloseFile(open_file_t* file);    // Drops one reference.
+int  FsIsOpen(int inum);                // 1 if anyone has inode inum open.
+void FsForkProcess(pcb_t* parent, pcb_t* child); // child shares parent's open files.
+void FsCloseAll(pcb_t* proc);           // For KillPCB(). Does not block.
+
+#endif
+// End of Fs.h
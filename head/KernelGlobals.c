@@ -14,6 +14,7 @@ void* KERNEL_DATA_END;
 void* kernel_break;
 unsigned int PMEM_SIZE;
 void (*trap_vector_table[TRAP_VECTOR_SIZE]) (UserContext*);
+int trace_level = KTRACE_MAX;
 fte_t* frame_table;
 pte_t* r0_page_table;
 queue_t RUNNING;
@@ -21,14 +22,56 @@ queue_t READY;
 queue_t SLEEPING;
 queue_t WAITING;
 queue_t* WRITING/*[0..3]*/;
-queue_t* WRITING_WAIT;
 queue_t* READING/*[0..3]*/;
+queue_t POLLING;
+poller_t** tty_pollers/*[0..3]*/;
+pcb_t* timer_list = NULL;
+disk_request_t* disk_queue   = NULL;
+disk_request_t* disk_current = NULL;
+int disk_head = 0;
+buf_t*  bufs;
+buf_t** buf_hash;
+buf_t*  buf_lru      = NULL;
+buf_t*  buf_lru_tail = NULL;
+queue_t BUF_WAITING;
+int cache_hits       = 0;
+int cache_misses     = 0;
+int cache_writebacks = 0;
+int cache_readaheads = 0;
+int cache_ra_hits    = 0;
+int cache_ra_wasted  = 0;
+int              fs_mounted = 0;
+int              fs_locked  = 0;
+queue_t          FS_WAITING;
+struct fs_header fs_info;
+char*            fs_block_used = NULL;
+char*            fs_inode_used = NULL;
+icache_t*        icache;
+dcache_t*        dcache;
+int              fs_stamp   = 0;
+open_file_t*     open_files = NULL;
+li_cache_t li_cache[LI_CACHE_SIZE];
+int li_stamp        = 0;
+int li_cache_hits   = 0;
+int li_cache_misses = 0;
+event_t      event_ring[EVENT_RING_SIZE];
+unsigned int event_count = 0;
+
+timeline_sample_t timeline_ring[TIMELINE_RING_SIZE];
+unsigned int      timeline_count = 0;
+int counters[NUM_COUNTERS];
+int syscall_counts[SYSCALL_CODES];
+int custom_counts[CUSTOM_CODES];
+syscall_hist_t* syscall_hists[HIST_CALLS];
+int profile_started = 0;
 int pid_count = 0;
 int ticks = 0;
 pcb_t** pcb_array;
 int pcb_array_size = PCB_ARRAY_INITIAL_SIZE;
 char** tty_write_buffer/*[0..3]*/;
 char** tty_read_buffer /*[0..3]*/;
+tty_output_t* tty_out  /*[0..3]*/;
+tty_input_t* tty_in    /*[0..3]*/;
 int interp_array_size = INTERP_ARRAY_INITIAL_SIZE;
 interp_t** interp_array;
 int iid_count = 0;
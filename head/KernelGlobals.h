@@ -10,6 +10,9 @@
 
 #include "include/hardware.h"
 #include "include/yalnix.h"
+#include "CustomCalls.h"
+#include "Events.h"
+#include "Timeline.h"
 #include "Constants.h"
 #include "DataStructures.h"
 
@@ -63,6 +66,22 @@
 // Insert between each line in multi-line TracePrintf() outputs.
 #define TRACE_N "           "
 //
+// KTRACE() is TracePrintf() for the hot paths (traps, system calls, scheduling).
+// A call with level above KTRACE_MAX compiles to nothing. The others print only if
+// level <= trace_level (see SetTraceLevel()), which is checked before any argument is
+// evaluated; TracePrintf()'s own -lk filter still applies after that.
+// KTRACE_MAX is TRACE_COMMENT unless the kernel is built with `make KTRACE_MAX=99`.
+#ifndef KTRACE_MAX
+#define KTRACE_MAX TRACE_COMMENT
+#endif
+extern int trace_level; // Initially KTRACE_MAX.
+#define KTRACE_ON(level) ((level) <= KTRACE_MAX && (level) <= trace_level)
+#define KTRACE(level, ...) do {			\
+    if( KTRACE_ON(level) ) {			\
+      TracePrintf((level), __VA_ARGS__);	\
+    }						\
+  } while(0)
+//
 // ======== ======== ======== ======== ======== ======== ======== ========
 
 // ======== ======== ======== ======== ======== ======== ======== ========
@@ -128,6 +147,15 @@ extern char** tty_write_buffer;
 extern char** tty_read_buffer;
 // Initialized in KernelStart().
 //
+// tty_out[0..(NUM_TERMINALS-1)] hold the buffered output. tty_write_buffer[tty_id]
+// holds the chunk being transmitted.
+extern tty_output_t* tty_out;
+//
+// tty_in[0..(NUM_TERMINALS-1)] are the input rings. tty_read_buffer[tty_id] is where
+// TtyReceive() puts a line before it goes into the ring.
+extern tty_input_t* tty_in;
+// Initialized in KernelStart().
+//
 // -------- -------- -------- -------- -------- -------- -------- --------
 
 
@@ -187,11 +215,113 @@ extern queue_t RUNNING;
 extern queue_t READY;
 extern queue_t SLEEPING;
 extern queue_t WAITING;
-extern queue_t* WRITING     /*[0..3]*/; // To tty.
-extern queue_t* WRITING_WAIT/*[0..3]*/;
+extern queue_t* WRITING     /*[0..3]*/; // Waiting for tty_out[] to drain (for room, or until empty).
 extern queue_t* READING     /*[0..3]*/; // To tty.
+extern queue_t POLLING;                 // In Poll().
 // All first initialized in KernelStart().
 //
+// tty_pollers[tty_id] lists the processes which Poll() tty #tty_id.
+extern poller_t** tty_pollers/*[0..3]*/;
+// Initialized in KernelStart().
+//
+// Processes in a timed wait, sorted by timeout_time. Linked through timer_next.
+// A process in this list is also in the queue it waits on.
+extern pcb_t* timer_list;
+// Declared and initialized (to NULL) in KernelGlobals.c.
+//
+// Disk requests waiting for the disk, oldest first, and the one the disk is working
+// on (NULL if idle). disk_head is the last sector accessed. See Disk.h.
+extern disk_request_t* disk_queue;
+extern disk_request_t* disk_current;
+extern int             disk_head;
+// Declared and initialized (to NULL) in KernelGlobals.c.
+//
+// The buffer cache: bufs[0..(BLOCK_CACHESIZE-1)], hashed by sector into
+// buf_hash[0..(BUF_HASH_SIZE-1)], and kept in LRU order from buf_lru (most recent)
+// to buf_lru_tail. Processes wait in BUF_WAITING when every buffer is held.
+// See Cache.h.
+extern buf_t*  bufs;
+extern buf_t** buf_hash;
+extern buf_t*  buf_lru;
+extern buf_t*  buf_lru_tail;
+extern queue_t BUF_WAITING;
+extern int cache_hits;       // CacheGet()s served from memory.
+extern int cache_misses;     // CacheGet()s which went to the disk.
+extern int cache_writebacks; // Dirty buffers written to the disk.
+extern int cache_readaheads; // Sectors read ahead by CachePrefetch().
+extern int cache_ra_hits;    // Of those, sectors used before eviction.
+extern int cache_ra_wasted;  // Of those, sectors evicted (or failed) unused.
+// Initialized in CacheInit().
+//
+// The file system. fs_info is the header on the disk; fs_block_used[] and
+// fs_inode_used[] are the free maps, built by FsMount(). icache[] and dcache[] are the
+// inode and name caches. fs_locked is set while a process is in the file system;
+// others wait in FS_WAITING. See Fs.h.
+extern int              fs_mounted;
+extern int              fs_locked;
+extern queue_t          FS_WAITING;
+extern struct fs_header fs_info;
+extern char*            fs_block_used /*[0..(fs_info.num_blocks-1)]*/;
+extern char*            fs_inode_used /*[0..fs_info.num_inodes]*/;
+extern icache_t*        icache        /*[0..(INODE_CACHESIZE-1)]*/;
+extern dcache_t*        dcache        /*[0..(FS_DCACHE_SIZE-1)]*/;
+extern int              fs_stamp;
+extern open_file_t*     open_files;
+// Initialized in FsInit() and FsMount().
+//
+// load_info cache for programs loaded from Linux files (see LoadProgram.c).
+extern li_cache_t li_cache[LI_CACHE_SIZE];
+extern int li_stamp;
+extern int li_cache_hits;   // LoadInfo() calls saved.
+extern int li_cache_misses; // LoadInfo() calls made.
+// Declared and initialized (to 0) in KernelGlobals.c.
+//
+// Event log (see Events.h): event_ring[event_count % EVENT_RING_SIZE] is the next
+// event to be overwritten. EVENT() records one.
+extern event_t      event_ring[EVENT_RING_SIZE];
+extern unsigned int event_count;
+// Declared and initialized (to 0) in KernelGlobals.c.
+//
+#define EVENT(_type, arg0, arg1, arg2) do {				\
+    event_t* _e = &event_ring[event_count++ & (EVENT_RING_SIZE - 1)];	\
+    _e->tick    = ticks;							\
+    _e->pid     = RUNNING.head != NULL ? RUNNING.head->pid : -1;	\
+    _e->type    = (_type);						\
+    _e->args[0] = (int)(arg0);						\
+    _e->args[1] = (int)(arg1);						\
+    _e->args[2] = (int)(arg2);						\
+  } while(0)
+//
+// Scheduler timeline (see Timeline.h): timeline_ring[timeline_count %
+// TIMELINE_RING_SIZE] is the next sample to be overwritten. TimelineSample() records
+// one.
+extern timeline_sample_t timeline_ring[TIMELINE_RING_SIZE];
+extern unsigned int      timeline_count;
+// Declared and initialized (to 0) in KernelGlobals.c.
+//
+// Performance counters (see Counters.h). COUNT(CONTEXT_SWITCHES) counts one context
+// switch, etc.
+extern int counters[NUM_COUNTERS];
+extern int syscall_counts[SYSCALL_CODES];
+extern int custom_counts[CUSTOM_CODES];
+// Declared and initialized (to 0) in KernelGlobals.c.
+#define COUNT(id) (counters[COUNTER_##id]++)
+//
+// Per-system-call histograms (see Counters.h), indexed as syscall_hist_t says;
+// allocated when the call is first made. WORK(BYTES_COPIED, n) charges n bytes copied
+// to the running process.
+extern syscall_hist_t* syscall_hists[HIST_CALLS];
+// Declared and initialized (to NULL) in KernelGlobals.c.
+#define WORK(kind, n) do {				\
+    if( RUNNING.head != NULL ) {			\
+      RUNNING.head->work[WORK_##kind] += (n);		\
+    }							\
+  } while(0)
+//
+// Whether PROFILE_FILE has been started this boot (see Profile.h).
+extern int profile_started;
+// Declared and initialized (to 0) in KernelGlobals.c.
+//
 // Array of all processes.
 // Increasing in the number of processes eventually result in reallocking the array.
 #define PCB_ARRAY_INITIAL_SIZE 128
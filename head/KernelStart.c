@@ -13,7 +13,7 @@
 #define IDLE_PROCESS    "IdleProcess"
 
 void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context) {
-  TracePrintf(TRACE_COMMENT, "Executing KernelStart()...\n");
+  KTRACE(TRACE_COMMENT, "Executing KernelStart()...\n");
 
   // This variable is 0 if InitProcess is not running. In this case, we load InitProcess.
   // Otherwise (when we return to KernelStart by manipulating program counter),
@@ -26,15 +26,15 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
   int default_process;
   if( cmd_args[0] == NULL ) {
     default_process = 1;
-    TracePrintf(TRACE_COMMENT, "KernelStart(): default process will run.\n");
+    KTRACE(TRACE_COMMENT, "KernelStart(): default process will run.\n");
   } else {
     default_process = 0;
-    TracePrintf(TRACE_COMMENT, "KernelStart(): argument process will run: %s.\n", cmd_args[0]);
+    KTRACE(TRACE_COMMENT, "KernelStart(): argument process will run: %s.\n", cmd_args[0]);
   }
   
   // Initialize global variables.
   PMEM_SIZE = pmem_size;
-  TracePrintf(TRACE_VERBOSE, "KernelStart(): PMEM_SIZE: 0x%x\n", PMEM_SIZE);
+  KTRACE(TRACE_VERBOSE, "KernelStart(): PMEM_SIZE: 0x%x\n", PMEM_SIZE);
   // In particular, malloc things before frame tables are examined.
   frame_table     = (fte_t*)calloc(sizeof(fte_t), FRAME_TABLE_SIZE);
   assert(frame_table);
@@ -54,17 +54,15 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
   InitQueue(&RUNNING);
   InitQueue(&SLEEPING);
   InitQueue(&WAITING);
+  InitQueue(&POLLING);
   WRITING = (queue_t*)calloc(NUM_TERMINALS, sizeof(queue_t));
   assert(WRITING);
   READING = (queue_t*)calloc(NUM_TERMINALS, sizeof(queue_t));
   assert(READING);
-  WRITING_WAIT = (queue_t*)calloc(NUM_TERMINALS, sizeof(queue_t));
-  assert(WRITING_WAIT);
   { int i;
     for(i = 0; i < NUM_TERMINALS; i++) {
       InitQueue(&WRITING[i]);
       InitQueue(&READING[i]);
-      InitQueue(&WRITING_WAIT[i]);
     }
   }
 
@@ -81,6 +79,22 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       assert(tty_read_buffer[i]);
     }
   }
+  tty_out = (tty_output_t*)calloc(NUM_TERMINALS, sizeof(tty_output_t));
+  assert(tty_out);
+  tty_in = (tty_input_t*)calloc(NUM_TERMINALS, sizeof(tty_input_t));
+  assert(tty_in);
+  { int i;
+    for(i = 0; i < NUM_TERMINALS; i++) {
+      tty_in[i].data = (char*)malloc(TTY_INPUT_SIZE);
+      assert(tty_in[i].data);
+    }
+  }
+  tty_pollers       = (poller_t**)calloc(NUM_TERMINALS, sizeof(poller_t*));
+  assert(tty_pollers);
+
+  // Initialize the buffer cache and the file system's caches.
+  CacheInit();
+  FsInit();
 
   // Initialize the trap vector table.
   // Initialize the register pointer for trap vector table.
@@ -91,6 +105,7 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
   trap_vector_table[TRAP_MATH        /*4*/] = &HandleTrapMath;
   trap_vector_table[TRAP_TTY_RECEIVE /*5*/] = &HandleTrapTtyReceive;
   trap_vector_table[TRAP_TTY_TRANSMIT/*6*/] = &HandleTrapTtyTransmit;
+  trap_vector_table[TRAP_DISK        /*7*/] = &HandleTrapDisk;
   { int i;
     for(i = 0; i < TRAP_VECTOR_SIZE/*16*/; i++) {
       // Undefined traps point to this handler which will abort the process.
@@ -99,8 +114,8 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
     }
   }
   WriteRegister(REG_VECTOR_BASE, (unsigned int) trap_vector_table);
-  TracePrintf(TRACE_COMMENT, "KernelStart(): trap vector table initialized.\n");
-  TracePrintf(TRACE_VERBOSE, "               (at %p)\n", (void*) ReadRegister(REG_VECTOR_BASE));
+  KTRACE(TRACE_COMMENT, "KernelStart(): trap vector table initialized.\n");
+  KTRACE(TRACE_VERBOSE, "               (at %p)\n", (void*) ReadRegister(REG_VECTOR_BASE));
 
   // Create a list of free frames.
   // Frames already in use should not be included (i.e., between KERNEL_DATA_START and KERNEL_DATA_END).
@@ -113,16 +128,22 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
 	        // Kernel text segment.
 	        frame_table[i].valid = 1;
 	        frame_table[i].prot  = PROT_READ | PROT_EXEC;
+	        frame_table[i].refs  = 1;
+	        SetFrameOwner(i, 0, frame_id_to_addr(i), FRAME_KERNEL);
 	        frames_used++;
       } else if( i < frame_addr_to_id(UP_TO_PAGE(KERNEL_DATA_END)) ) {
 	        // Kernel data segment.
 	        frame_table[i].valid = 1;
 	        frame_table[i].prot  = PROT_READ | PROT_WRITE;
+	        frame_table[i].refs  = 1;
+	        SetFrameOwner(i, 0, frame_id_to_addr(i), FRAME_KERNEL);
 	        frames_used++;
       } else if( i < frame_addr_to_id(kernel_break) ) {
 	        // Kernel heap segment (parts used already).
 	        frame_table[i].valid = 1;
 	        frame_table[i].prot  = PROT_READ | PROT_WRITE;
+	        frame_table[i].refs  = 1;
+	        SetFrameOwner(i, 0, frame_id_to_addr(i), FRAME_KERNEL_HEAP);
       } else if( i < frame_addr_to_id(KERNEL_STACK_BASE) /*hardware.h*/)  {
 	        // Kernel heap segment (parts not used yet).
 	        frame_table[i].valid = 0;
@@ -131,6 +152,8 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
 	        // Kernel stack segment.
 	        frame_table[i].valid = 1;
 	        frame_table[i].prot  = PROT_READ | PROT_WRITE;
+	        frame_table[i].refs  = 1;
+	        SetFrameOwner(i, 0, frame_id_to_addr(i), FRAME_KERNEL_STACK);
       } else {
 	        // Region 1.
 	        frame_table[i].valid = 0;
@@ -138,7 +161,7 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       }
     }
   }
-  TracePrintf(TRACE_COMMENT, "KernelStart(): frame table built. %d frames in use.\n", frames_used);
+  KTRACE(TRACE_COMMENT, "KernelStart(): frame table built. %d frames in use.\n", frames_used);
 
   // Build virtual memory page table for region 0. (directly mapped to physical memory)
   /* r0_page_table = (pte_t*)malloc(sizeof(pte_t) * R0_PAGE_TABLE_SIZE); */
@@ -154,7 +177,7 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       }
     }
   }
-  TracePrintf(TRACE_COMMENT, "KernelStart(): page table for region 0 written.\n");
+  KTRACE(TRACE_COMMENT, "KernelStart(): page table for region 0 written.\n");
 
   // Enable virtual memory.
   // (Documentation 3.2.4., 3.2.6.).
@@ -163,9 +186,9 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
   WriteRegister(REG_PTBR1, (unsigned int) init_pcb->r1_page_table);
   WriteRegister(REG_PTLR1, R1_PAGE_TABLE_SIZE);
   WriteRegister(REG_VM_ENABLE, 1);
-  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_ALL);
-  TracePrintf(TRACE_COMMENT, "KernelStart(): virtual memory enabled.\n");
-  TracePrintf(TRACE_VERBOSE,
+  FlushTLB(TLB_FLUSH_ALL);
+  KTRACE(TRACE_COMMENT, "KernelStart(): virtual memory enabled.\n");
+  KTRACE(TRACE_VERBOSE,
 	      "KernelStart():\n"  TRACE_N
 	      "  REG_PTBR0: %p\n" TRACE_N
 	      "  REG_PTLR0: %d\n" TRACE_N
@@ -175,7 +198,7 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
 	      (void*) ReadRegister(REG_PTBR1), ReadRegister(REG_PTLR1));
 
   // Flush TLB. (again)
-  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_ALL);
+  FlushTLB(TLB_FLUSH_ALL);
 
   // Create and run init process.
   // Arguments to init is passed from cmd_args.
@@ -190,13 +213,15 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       init_pcb->r0_stack_page_table[i].valid = 1;
       init_pcb->r0_stack_page_table[i].prot  = PROT_READ | PROT_WRITE;
       init_pcb->r0_stack_page_table[i].pfn   = frame_addr_to_id(KERNEL_STACK_BASE) + i;
+      SetFrameOwner(init_pcb->r0_stack_page_table[i].pfn, init_pcb->pid,
+		    (void*) (KERNEL_STACK_BASE + i * PAGESIZE), FRAME_KERNEL_STACK);
       if( idle_pcb->r0_stack_page_table[i].pfn == ERROR ) {
 	TracePrintf(TRACE_WRONG, "KernelStart(): cannot find free frame for InitProcess.\n");
 	Halt();
       }
     }
   }
-  TracePrintf(TRACE_COMMENT, "KernelStart(): kernel stack page table written for first process.\n");
+  KTRACE(TRACE_COMMENT, "KernelStart(): kernel stack page table written for first process.\n");
 
   // Idle process.
   {
@@ -210,10 +235,12 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       idle_pcb->r0_stack_page_table[i].valid = 1;
       idle_pcb->r0_stack_page_table[i].prot  = PROT_READ | PROT_WRITE;
       idle_pcb->r0_stack_page_table[i].pfn   = FindFreeFrame(PROT_READ | PROT_WRITE); // this creates a new kernel stack for idle
-      if( idle_pcb->r1_page_table[i].pfn == ERROR ) {
+      if( idle_pcb->r0_stack_page_table[i].pfn == ERROR ) {
 	TracePrintf(TRACE_WRONG, "KernelStart(): cannot find free frame for IdleProcess.\n");
 	Halt();
       }
+      SetFrameOwner(idle_pcb->r0_stack_page_table[i].pfn, idle_pcb->pid,
+		    (void*) (KERNEL_STACK_BASE + i * PAGESIZE), FRAME_KERNEL_STACK);
     }
 	
     // JBB. Here, we will make a special call to KernelContextSwitch(), in order to get
@@ -231,14 +258,18 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
     // now, we need to conditionally transform ourselves into either init process or idle process
     if (!init_process_running) {
       // start init process
-      TracePrintf(TRACE_COMMENT, "KernelStart(): Init process continuing in KernelStart\n");
+      KTRACE(TRACE_COMMENT, "KernelStart(): Init process continuing in KernelStart\n");
       
+      // LoadProgram() writes through region 1, so init's page table must be the one in
+      // REG_PTBR1 (it was set for the PCB InitPCB() replaced).
+      ChangeAddressSpace(init_pcb);
+
       // Load program.
       int rv;
       if( default_process ) {
-	rv = LoadProgram(DEFAULT_PROCESS, cmd_args /* cmd_args[0] == NULL */, init_pcb);
+	rv = LoadProgram(DEFAULT_PROCESS, cmd_args /* cmd_args[0] == NULL */, init_pcb, 0);
       } else {
-	rv = LoadProgram(cmd_args[0], cmd_args, init_pcb);
+	rv = LoadProgram(cmd_args[0], cmd_args, init_pcb, 0);
       }
       // JHL. What do we do if LoadProgram() fails?
       // It shouldn't but...
@@ -257,14 +288,14 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       ChangeAddressSpace(init_pcb);
       
       init_process_running = 1;
-      TracePrintf(TRACE_COMMENT, "KernelStart(): returning to init process!\n");
+      KTRACE(TRACE_COMMENT, "KernelStart(): returning to init process!\n");
 
       // JHL.
       // Immediately initialize the Idle Process?
       ContextSwitch(READY.head, &READY, &READY);
     } else {
       // start idle process (we need to copy the kernel stack now)
-      TracePrintf(TRACE_COMMENT, "KernelStart(): Idle process continuing in KernelStart\n");
+      KTRACE(TRACE_COMMENT, "KernelStart(): Idle process continuing in KernelStart\n");
       
       // Change address space to IdleProcess's. (includes kernel stack)
       ChangeAddressSpace(idle_pcb);
@@ -274,7 +305,7 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       char* args[1];
       args[0] = NULL;
 
-      rv = LoadProgram(IDLE_PROCESS, args, idle_pcb);
+      rv = LoadProgram(IDLE_PROCESS, args, idle_pcb, 0);
       // JHL. What do we do if LoadProgram() fails?
       // It shouldn't but...
       if( rv == ERROR ) {
@@ -289,11 +320,11 @@ void KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* u_context
       memcpy(u_context, &idle_pcb->u_context, sizeof(UserContext));
       ChangeAddressSpace(idle_pcb);
       
-      TracePrintf(TRACE_COMMENT, "KernelStart(): returning to idle process!\n");
+      KTRACE(TRACE_COMMENT, "KernelStart(): returning to idle process!\n");
     } 
   }
   
-  TracePrintf(TRACE_COMMENT, "Leaving KernelStart()...\n");
+  KTRACE(TRACE_COMMENT, "Leaving KernelStart()...\n");
 }
 
 // End of KernelStart.c
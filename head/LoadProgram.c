@@ -13,12 +13,217 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <hardware.h>
 #include <load_info.h>
 // ==>> #include anything you need for your kernel here
 #include "DataStructures.h"
 #include "KernelGlobals.h"
 #include "Utility.h"
+#include "Fs.h"
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Program images.
+// -------- -------- -------- -------- -------- -------- -------- --------
+//
+// A program comes from a Linux file (an ELF executable, parsed by LoadInfo()), or from
+// the file system (an image written by InstallProgram(), see image_header_t).
+//
+// LoadInfo() reads and checks the ELF headers on every call, so its results are kept
+// in li_cache[], keyed by the file's device and inode numbers. An entry is used only
+// while the file has the same size, and modification and change times (to the
+// nanosecond), as when it was parsed.
+//
+// An image in the file system is checked when installed. Loading it takes one read for
+// the header and one bulk read per segment.
+typedef struct {
+  int              fd;   // Linux file, or -1.
+  open_file_t*     file; // File system file, or NULL.
+  struct load_info li;
+} image_t;
+
+// Helper method for LinuxImageInfo().
+int SameTime(struct timespec* a, struct timespec* b) {
+  return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+// Helper method for OpenImage(). Fills in image->li for the Linux file image->fd.
+int LinuxImageInfo(image_t* image, char* name) {
+  struct stat st;
+  if( fstat(image->fd, &st) != 0 ) {
+    return ERROR;
+  }
+
+  li_cache_t* entry  = NULL;
+  li_cache_t* victim = &li_cache[0];
+  int i;
+  for(i = 0; i < LI_CACHE_SIZE; i++) {
+    if( li_cache[i].ino == st.st_ino && li_cache[i].dev == st.st_dev ) {
+      entry = &li_cache[i];
+      break;
+    }
+    if( li_cache[i].stamp < victim->stamp ) {
+      victim = &li_cache[i];
+    }
+  }
+  if( entry != NULL && entry->size == st.st_size &&
+      SameTime(&entry->mtime, &st.st_mtim) && SameTime(&entry->ctime, &st.st_ctim) ) {
+    li_cache_hits++;
+    entry->stamp = ++li_stamp;
+    image->li    = entry->li;
+    return SUCCESS;
+  }
+
+  li_cache_misses++;
+  if (LoadInfo(image->fd, &image->li) != LI_NO_ERROR) {
+    TracePrintf(0, "LoadProgram: '%s' not in Yalnix format\n", name);
+    return ERROR;
+  }
+  if (image->li.entry < VMEM_1_BASE) {
+    TracePrintf(0, "LoadProgram: '%s' not linked for Yalnix\n", name);
+    return ERROR;
+  }
+
+  // Remember it, in place of the stale entry or the least recently used one.
+  if( entry == NULL ) {
+    entry = victim;
+  }
+  entry->dev   = st.st_dev;
+  entry->ino   = st.st_ino;
+  entry->size  = st.st_size;
+  entry->mtime = st.st_mtim;
+  entry->ctime = st.st_ctim;
+  entry->stamp = ++li_stamp;
+  entry->li    = image->li;
+  return SUCCESS;
+}
+
+// Helper method for OpenImage(). Opens the file system image path.
+int DiskImageInfo(image_t* image, char* name) {
+  char path[MAXPATHNAMELEN];
+  strncpy(path, name, MAXPATHNAMELEN - 1);
+  path[MAXPATHNAMELEN - 1] = '\0';
+
+  image_header_t header;
+  int inum   = ERROR;
+  int length = 0;
+  if( FsLock() == SUCCESS && (inum = FsLookup(path)) != ERROR ) {
+    length = FsRead(inum, &header, 0, sizeof(header), NULL);
+  }
+  FsUnlock();
+  if( inum == ERROR ) {
+    TracePrintf(0, "LoadProgram: can't open file '%s'\n", name);
+    return ERROR;
+  }
+  if( length != sizeof(header) || header.magic != IMAGE_MAGIC || header.li.entry < VMEM_1_BASE ) {
+    TracePrintf(0, "LoadProgram: '%s' is not a program image\n", name);
+    return ERROR;
+  }
+  image->li   = header.li;
+  image->file = FsOpenFile(inum); // So that no one unlinks it while I load it.
+  return SUCCESS;
+}
+
+// Opens the program name: a Linux file, or (with from_disk set) an image in the file
+// system. Sets image->li.
+int OpenImage(char* name, int from_disk, image_t* image) {
+  image->file = NULL;
+  image->fd   = open(name, O_RDONLY);
+  if( image->fd >= 0 ) {
+    if( LinuxImageInfo(image, name) != SUCCESS ) {
+      close(image->fd);
+      return ERROR;
+    }
+    return SUCCESS;
+  }
+  if( !from_disk ) {
+    TracePrintf(0, "LoadProgram: can't open file '%s'\n", name);
+    return ERROR;
+  }
+  return DiskImageInfo(image, name);
+}
+
+// Reads length bytes at offset of the image into buffer. Returns SUCCESS if all came.
+int ReadImage(image_t* image, off_t offset, void* buffer, long length) {
+  if( image->fd >= 0 ) {
+    lseek(image->fd, offset, SEEK_SET);
+    return read(image->fd, buffer, length) == length ? SUCCESS : ERROR;
+  }
+  int result = ERROR;
+  if( FsLock() == SUCCESS ) {
+    result = FsRead(image->file->inum, buffer, offset, length, &image->file->ra);
+  }
+  FsUnlock();
+  return result == length ? SUCCESS : ERROR;
+}
+
+void CloseImage(image_t* image) {
+  if( image->fd >= 0 ) {
+    close(image->fd);
+  } else {
+    FsCloseFile(image->file);
+  }
+}
+//
+// ======== ======== ======== ======== ======== ======== ======== ========
+
+
+
+int InstallProgram(char* linux_name, char* path) {
+  image_t image;
+  if( OpenImage(linux_name, 0, &image) != SUCCESS ) {
+    return ERROR;
+  }
+
+  // Text and data go in whole pages, right after the header's block.
+  image_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic       = IMAGE_MAGIC;
+  header.li          = image.li;
+  header.li.t_faddr  = BLOCKSIZE;
+  header.li.id_faddr = BLOCKSIZE + (image.li.t_npg << PAGESHIFT);
+
+  // The header goes in last, so that a short write never leaves an image which looks
+  // whole; and an image someone is loading (or running Read() on) is not truncated.
+  char* page = (char*)malloc(PAGESIZE);
+  assert(page);
+  int result = FsLock();
+  int inum   = ERROR;
+  int existed = result == SUCCESS && (inum = FsLookup(path)) != ERROR;
+  if( existed && FsIsOpen(inum) ) {
+    KTRACE(TRACE_COMMENT, "InstallProgram(): '%s' is open.\n", path);
+    result = ERROR;
+  }
+  if( result == SUCCESS && (inum = FsCreate(path, INODE_REGULAR)) == ERROR ) {
+    result = ERROR;
+  }
+  // A new file is unlinked again if the rest fails. One that was there is not: it is
+  // truncated, so without its header it is no image, and Exec() of it fails cleanly.
+  int created = result == SUCCESS && !existed;
+  unsigned long i;
+  for(i = 0; result == SUCCESS && i < image.li.t_npg + image.li.id_npg; i++) {
+    off_t from = i < image.li.t_npg ?
+      image.li.t_faddr  + (i << PAGESHIFT) :
+      image.li.id_faddr + ((i - image.li.t_npg) << PAGESHIFT);
+    if( ReadImage(&image, from, page, PAGESIZE) != SUCCESS ||
+	FsWrite(inum, page, BLOCKSIZE + (i << PAGESHIFT), PAGESIZE) != PAGESIZE ) {
+      result = ERROR;
+    }
+  }
+  if( result == SUCCESS && FsWrite(inum, &header, 0, sizeof(header)) != sizeof(header) ) {
+    result = ERROR;
+  }
+  if( result != SUCCESS && created ) {
+    FsUnlink(path);
+  }
+  FsUnlock();
+  free(page);
+  CloseImage(&image);
+
+  KTRACE(TRACE_VERBOSE, "InstallProgram(): '%s' as '%s': %s.\n", linux_name, path,
+	      result == SUCCESS ? "done" : "failed");
+  return result;
+}
 
 /*
  *  Load a program into an existing address space.  The program comes from
@@ -28,16 +233,15 @@
  *  is to be loaded. 
  */
 int
-LoadProgram(char *name, char *args[], pcb_t* proc) 
+LoadProgram(char *name, char *args[], pcb_t* proc, int from_disk) 
 // ==>> Declare the argument "proc" to be a pointer to your PCB or
 // ==>> process descriptor data structure.  We assume you have a member
 // ==>> of this structure used to hold the cpu context 
 // ==>> for the process holding the new program.  
 {
-  TracePrintf(TRACE_COMMENT, "Entering LoadProgram() with \"%s\"\n", name);
+  KTRACE(TRACE_COMMENT, "Entering LoadProgram() with \"%s\"\n", name);
 
-  int fd;
-  int (*entry)();
+  image_t image;
   struct load_info li;
   int i;
   char *cp;
@@ -57,24 +261,12 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   my_name[PCB_NAME_LENGTH-1] = '\0';
   
   /*
-   * Open the executable file 
+   * Open the executable file, and get its load_info (checked by OpenImage()).
    */
-  if ((fd = open(name, O_RDONLY)) < 0) {
-    TracePrintf(0, "LoadProgram: can't open file '%s'\n", name);
-    return ERROR;
-  }
-
-  if (LoadInfo(fd, &li) != LI_NO_ERROR) {
-    TracePrintf(0, "LoadProgram: '%s' not in Yalnix format\n", name);
-    close(fd);
-    return (-1);
-  }
-
-  if (li.entry < VMEM_1_BASE) {
-    TracePrintf(0, "LoadProgram: '%s' not linked for Yalnix\n", name);
-    close(fd);
+  if (OpenImage(name, from_disk, &image) != SUCCESS) {
     return ERROR;
   }
+  li = image.li;
 
   /*
    * Figure out in what region 1 page the different program sections
@@ -135,7 +327,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
 
   /* leave at least one page between heap and stack */
   if (stack_npg + data_pg1 + data_npg >= MAX_PT_LEN) {
-    close(fd);
+    CloseImage(&image);
     return ERROR;
   }
 
@@ -161,6 +353,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   // ==>> You should perhaps check that malloc returned valid space
   if( cp2 == NULL ) {
     TracePrintf(TRACE_SEVERE, "LoadProgram(): fails because malloc() returns NULL.\n");
+    CloseImage(&image);
     return ERROR;
   }
   for (i = 0; args[i] != NULL; i++) {
@@ -186,6 +379,8 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   // ==>> how many pages the new process needs and allocate or
   // ==>> deallocate a few pages to fit the size of memory to the requirements
   // ==>> of the new process.
+  // The new program does not inherit the old one's shared memory.
+  ShmDetachProcess(proc);
   { int i;
     int pfn;
     for(i = 0; i < R1_PAGE_TABLE_SIZE; i++) {
@@ -205,10 +400,9 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   // ==>> These pages should be marked valid, with a protection of 
   // ==>> (PROT_READ | PROT_WRITE).
   { int i;
-    int pfn;
     for(i = text_pg1; i < text_pg1 + li.t_npg; i++) {
       // JHL. I'm assuming that text_pg1 through text_pg1+li.t_npg are all unused.
-      TracePrintf(TRACE_VERBOSE, "LoadProgram(): mapping page %d to text\n", i);
+      KTRACE(TRACE_VERBOSE, "LoadProgram(): mapping page %d to text\n", i);
       
       if( proc->r1_page_table[i].valid == 1 ) {
 	    TracePrintf(TRACE_WRONG, "LoadProgram(): overwriting text on page %d in use\n.", i);
@@ -225,8 +419,10 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
 	    TracePrintf(TRACE_UNIMPLEMENTED_CRITICAL,
 		        "LoadProgram(): cannot find %d of %d frames required for writing text.\n",
 		        i, li.t_npg);
+	    CloseImage(&image);
 	    return KILL;
       }
+      SetFrameOwner(proc->r1_page_table[i].pfn, proc->pid, r1_id_to_addr(i), FRAME_TEXT);
     }
   }
   // ==>> Allocate "data_npg" physical pages and map them starting at
@@ -234,9 +430,8 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   // ==>> These pages should be marked valid, with a protection of 
   // ==>> (PROT_READ | PROT_WRITE).
   { int i;
-    int pfn;
     for(i = data_pg1; i < data_pg1 + data_npg; i++) {
-        TracePrintf(TRACE_VERBOSE, "LoadProgram(): mapping page %d to data\n", i);
+        KTRACE(TRACE_VERBOSE, "LoadProgram(): mapping page %d to data\n", i);
     
       // JHL. I'm assuming that data_pg1 through data_pg1+data_npg are all unused.
       if( proc->r1_page_table[i].valid == 1 ) {
@@ -253,8 +448,10 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
 	    TracePrintf(TRACE_UNIMPLEMENTED_CRITICAL,
 		    "LoadProgram(): cannot find %d of %d frames required for data.\n",
 		    i, li.t_npg);
+	    CloseImage(&image);
 	    return KILL;
       }
+      SetFrameOwner(proc->r1_page_table[i].pfn, proc->pid, r1_id_to_addr(i), FRAME_DATA);
     }
   }
 
@@ -268,10 +465,10 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   { int i;
     int new_stack_base = (R1_PAGE_TABLE_SIZE - 1) - (stack_npg - 1);
     proc->r1_stack_base_index = new_stack_base;
-    TracePrintf(TRACE_VERBOSE, "LoadProgram(): new stack base:%d\n", new_stack_base);
+    KTRACE(TRACE_VERBOSE, "LoadProgram(): new stack base:%d\n", new_stack_base);
     
     for(i = R1_PAGE_TABLE_SIZE - 1; i >= new_stack_base; i--){
-        TracePrintf(TRACE_VERBOSE, "LoadProgram(): mapping page %d to stack\n", i);
+        KTRACE(TRACE_VERBOSE, "LoadProgram(): mapping page %d to stack\n", i);
         // JHL. I'm assuming that data_pg1 through data_pg1+data_npg are all unused.
         if( proc->r1_page_table[i].valid == 1 ) {
 	        TracePrintf(TRACE_WRONG, "LoadProgram(): ERROR: overwriting stack on page %d in use.\n", i);
@@ -290,8 +487,10 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
 	       TracePrintf(TRACE_UNIMPLEMENTED_CRITICAL,
 		    "LoadProgram(): cannot find %d of %d frames required for data.\n",
 		    i, li.t_npg);
+	    CloseImage(&image);
 	    return KILL;
       }
+        SetFrameOwner(proc->r1_page_table[i].pfn, proc->pid, r1_id_to_addr(i), FRAME_STACK);
     }
   }
 
@@ -300,7 +499,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   {
     int i;
     for(i = 0; i < R1_PAGE_TABLE_SIZE; i++) {
-      TracePrintf(TRACE_COMMENT, "***r1_page_table[%d]: valid[%d] prot[%d]\n",
+      KTRACE(TRACE_COMMENT, "***r1_page_table[%d]: valid[%d] prot[%d]\n",
 		  i, proc->r1_page_table[i].valid, proc->r1_page_table[i].prot);
     }
   }
@@ -312,14 +511,13 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    * But they are not yet in the TLB, remember!
    */
   // JHL. Do we flush so that new address space doesn't get confused?
-  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_ALL);
+  FlushTLB(TLB_FLUSH_ALL);
   /*
    * Read the text from the file into memory.
    */
-  lseek(fd, li.t_faddr, SEEK_SET);
   segment_size = li.t_npg << PAGESHIFT;
-  if (read(fd, (void *) li.t_vaddr, segment_size) != segment_size) {
-    close(fd);
+  if (ReadImage(&image, li.t_faddr, (void *) li.t_vaddr, segment_size) != SUCCESS) {
+    CloseImage(&image);
     // ==>> KILL is not defined anywhere: it is an error code distinct
     // ==>> from ERROR because it requires different action in the caller.
     // ==>> Since this error code is internal to your kernel, you get to define it.
@@ -330,11 +528,10 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   /*
    * Read the data from the file into memory.
    */
-  lseek(fd, li.id_faddr, 0);
   segment_size = li.id_npg << PAGESHIFT;
 
-  if (read(fd, (void *) li.id_vaddr, segment_size) != segment_size) {
-    close(fd);
+  if (ReadImage(&image, li.id_faddr, (void *) li.id_vaddr, segment_size) != SUCCESS) {
+    CloseImage(&image);
     TracePrintf(TRACE_SEVERE, "LoadProgram(): cannot load %s: error reading data.\n", name);
     return KILL;
   }
@@ -365,12 +562,12 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
     }
   }
 
-  close(fd);			/* we've read it all now */
+  CloseImage(&image);		/* we've read it all now */
 
   /*
    * Zero out the uninitialized data area
    */
-  bzero(li.id_end, li.ud_end - li.id_end);
+  bzero((void*) li.id_end, li.ud_end - li.id_end);
 
   /*
    * Set the entry point in the exception frame.
@@ -385,7 +582,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    */
 
   // save the name of the process into the PCB
-  // TracePrintf(TRACE_VERBOSE, "LoadProgram: attempting to save name information into the PCB! (Name is '%s'(len=%d))\n", name, strlen(name));
+  // KTRACE(TRACE_VERBOSE, "LoadProgram: attempting to save name information into the PCB! (Name is '%s'(len=%d))\n", name, strlen(name));
   memcpy(proc->pname, my_name, sizeof(char) * PCB_NAME_LENGTH);
 
 #ifdef LINUX
@@ -414,7 +611,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
     // (i is the index of first invalid page.)
   }
 
-  TracePrintf(TRACE_COMMENT, "Leaving LoadProgram() with SUCCESS...\n");
+  KTRACE(TRACE_COMMENT, "Leaving LoadProgram() with SUCCESS...\n");
   return SUCCESS;
 }
 
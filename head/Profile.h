@@ -0,0 +1,45 @@
+// Profile.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Clock-tick sampling profiler for user programs.
+//
+// A process turns profiling on with Profile(1) (CustomCalls.h). From then on, each
+// TRAP_CLOCK that interrupts it counts one sample at the interrupted pc, in a table of
+// PROFILE_SLOTS pcs kept with the process; samples at pcs that do not fit are counted
+// as dropped. Children created by Fork() or Spawn() are profiled too, each on its own.
+//
+// A process's profile is appended to the Linux file PROFILE_FILE when it Exec()s (the
+// samples belong to the program it leaves), when it dies, and when the kernel halts.
+// The file is started afresh at each boot, and holds records of a profile_header_t
+// followed by its profile_sample_t's.
+//
+// tools/ProfileDecode maps the pcs to the functions of each program, from `nm -n`.
+//
+// This header is shared by the kernel and tools/; it uses only 32-bit ints, so the
+// layout is the same for the -m32 kernel and a 64-bit host.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#define PROFILE_FILE  "PROFILE"
+#define PROFILE_MAGIC 0x59505246 // "YPRF"
+#define PROFILE_SLOTS 1024       // Distinct pcs per process. Must be a power of 2.
+#define PROFILE_NAME  32         // PCB_NAME_LENGTH.
+
+typedef struct {
+  int  magic;              // PROFILE_MAGIC.
+  int  pid;
+  char name[PROFILE_NAME]; // Program, as given to Exec().
+  int  samples;            // All samples, dropped ones included.
+  int  dropped;
+  int  count;              // profile_sample_t's that follow.
+} profile_header_t;
+
+typedef struct {
+  int pc;
+  int samples;
+} profile_sample_t;
+
+#endif
+// End of Profile.h
@@ -9,7 +9,7 @@
 
 int SetKernelBrk (void* addr)
 {
-  TracePrintf(TRACE_COMMENT, "SetKernelBrk(): request address at %p, current kernel break at %p.\n", addr, kernel_break);
+  KTRACE(TRACE_COMMENT, "SetKernelBrk(): request address at %p, current kernel break at %p.\n", addr, kernel_break);
 
   if( ReadRegister(REG_VM_ENABLE) ) {
     here();
@@ -38,10 +38,11 @@ int SetKernelBrk (void* addr)
 	  TracePrintf(TRACE_WRONG, "SetKernelBrk(): cannot grant memory request at %p: insufficient memory.\n", addr);
 	  Halt();
 	}
+	SetFrameOwner(r0_page_table[i].pfn, 0, r0_id_to_addr(i), FRAME_KERNEL_HEAP);
 	j++;
       }
       kernel_break = (void*) UP_TO_PAGE(addr);
-      TracePrintf(TRACE_COMMENT, "SetKernelBrk(): memory request at %p granted. %d frames allocated.  New kernel break at %p.\n", addr, j, kernel_break);
+      KTRACE(TRACE_COMMENT, "SetKernelBrk(): memory request at %p granted. %d frames allocated.  New kernel break at %p.\n", addr, j, kernel_break);
     }
 
   } else {
@@ -66,7 +67,7 @@ int SetKernelBrk (void* addr)
     // Keep track of maximum extent passed on calls to SetKernelBrk().
     kernel_break = (void*) UP_TO_PAGE(addr);    
 
-    TracePrintf(TRACE_VERBOSE, "SetKernelBrk() : completed. requested:%p\t new brk:%p\n", addr, kernel_break);
+    KTRACE(TRACE_VERBOSE, "SetKernelBrk() : completed. requested:%p\t new brk:%p\n", addr, kernel_break);
   }
 
   // JBB: malloc expects us to return the address of the new break.
@@ -6,7 +6,7 @@
 
 void SetKernelData(void* _KernelDataStart, void* _KernelDataEnd)
 {
-  TracePrintf(TRACE_COMMENT, "Executing SetKernelData()...\n");
+  KTRACE(TRACE_COMMENT, "Executing SetKernelData()...\n");
 
   // Let the machine inform us about kernel's current memory usage.
   KERNEL_DATA_START = _KernelDataStart;
@@ -16,14 +16,14 @@ void SetKernelData(void* _KernelDataStart, void* _KernelDataEnd)
   // KERNEL_DATA_END.
   kernel_break      = (void*) UP_TO_PAGE(_KernelDataEnd);
 
-  TracePrintf(TRACE_VERBOSE,
+  KTRACE(TRACE_VERBOSE,
 	      "SetKernelData():\n" TRACE_N
 	      "  KERNEL_DATA_START at %p\n" TRACE_N
 	      "  KERNEL_DATA_END   at %p\n" TRACE_N
 	      "  kernel_break      at %p\n",
 	      KERNEL_DATA_START, KERNEL_DATA_END, kernel_break);
 
-  TracePrintf(TRACE_COMMENT, "Leaving SetKernelData()...\n");
+  KTRACE(TRACE_COMMENT, "Leaving SetKernelData()...\n");
 }
 
 // End of SetKernelData.c
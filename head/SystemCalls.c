@@ -69,6 +69,7 @@ pcb_t* HandleFork(void) {
   child->ppid = parent->pid;
   child->prev = NULL; // Not in any queue yet.
   child->next = NULL;
+  child->queue = NULL;
   child->num_children = 0;
   child->dead_children_head = NULL;
   child->dead_children_tail = NULL;
@@ -81,6 +82,10 @@ pcb_t* HandleFork(void) {
 
     // R1 page table:
     for(i = 0; i < R1_PAGE_TABLE_SIZE; i++) {
+      // Shared memory keeps parent's frames (see ShmForkProcess() below).
+      if( IsShmPage(child, i) ) {
+	continue;
+      }
       if( child->r1_page_table[i].valid ) {
 	// Find a new frame for each valid frame.
 	child->r1_page_table[i].pfn = FindFreeFrame(child->r1_page_table[i].prot);
@@ -91,15 +96,16 @@ pcb_t* HandleFork(void) {
 
 	  // First free all frames allocated for child.
 	  for(j = 0; j < i; j++) {
-	    if( child->r1_page_table[j].valid ) {
-	      frame_table[child->r1_page_table[j].pfn].valid = 0;
-	      frame_table[child->r1_page_table[j].pfn].prot  = PROT_NONE;
+	    if( child->r1_page_table[j].valid && !IsShmPage(child, j) ) {
+	      FreeFrame(child->r1_page_table[j].pfn);
 	    }
 	  }
 	  // Proceed to cleanup.
 	  goto fail_fin;
 	}
-
+	// The copy holds what the parent's page does.
+	SetFrameOwner(child->r1_page_table[i].pfn, child->pid, r1_id_to_addr(i),
+		      frame_table[parent->r1_page_table[i].pfn].kind);
       }
     }
 
@@ -114,13 +120,14 @@ pcb_t* HandleFork(void) {
 	// First free all frames allocated for child.
 	for(j = 0; j < i; j++) {
 	  if( child->r0_stack_page_table[j].valid ) {
-	    frame_table[child->r0_stack_page_table[j].pfn].valid = 0;
-	    frame_table[child->r0_stack_page_table[j].pfn].prot  = PROT_NONE;
+	    FreeFrame(child->r0_stack_page_table[j].pfn);
 	  }
 	}
 	// Proceed to cleanup.
 	goto fail_r1_page_table;
       }
+      SetFrameOwner(child->r0_stack_page_table[i].pfn, child->pid,
+		    (void*) (KERNEL_STACK_BASE + i * PAGESIZE), FRAME_KERNEL_STACK);
     }
   }
   
@@ -128,20 +135,31 @@ pcb_t* HandleFork(void) {
   { int i;
     unsigned char PAGE_BUFFER[PAGESIZE];
     for(i = 0; i < R1_PAGE_TABLE_SIZE; i++) {
-      if( child->r1_page_table[i].valid ) {
+      if( child->r1_page_table[i].valid && !IsShmPage(child, i) ) {
 	int prot = child->r1_page_table[i].prot;
 	parent->r1_page_table[i].prot = PROT_READ;
 	child ->r1_page_table[i].prot = PROT_WRITE;
-	memcpy(PAGE_BUFFER, VMEM_1_BASE + i*PAGESIZE, PAGESIZE);
+	memcpy(PAGE_BUFFER, (void*) (VMEM_1_BASE + i*PAGESIZE), PAGESIZE);
 	ChangeAddressSpace(child);
-	memcpy(VMEM_1_BASE + i*PAGESIZE, PAGE_BUFFER, PAGESIZE);
+	memcpy((void*) (VMEM_1_BASE + i*PAGESIZE), PAGE_BUFFER, PAGESIZE);
 	ChangeAddressSpace(parent);
 	parent->r1_page_table[i].prot = prot;
 	child ->r1_page_table[i].prot = prot;
+	COUNT(FRAMES_COPIED);
+	WORK(PAGES_COPIED, 1);
       }
     }
   }
 
+  // Child shares parent's shared memory segment, if any.
+  ShmForkProcess(parent, child);
+
+  // Child shares parent's open files.
+  FsForkProcess(parent, child);
+
+  // Child is profiled if parent is, in a profile of its own.
+  ProfileFork(parent, child);
+
   // 5. Add child to READY queue.
   AddToQueue(child, &READY);
 
@@ -164,13 +182,14 @@ pcb_t* HandleFork(void) {
  fail_r1_page_table:
   { int i;
     for(i = 0; i < R1_PAGE_TABLE_SIZE; i++) {
-      if( child->r1_page_table[i].valid ) {
-	frame_table[child->r1_page_table[i].pfn].valid = 0;
-	frame_table[child->r1_page_table[i].pfn].prot  = PROT_NONE;
+      if( child->r1_page_table[i].valid && !IsShmPage(child, i) ) {
+	FreeFrame(child->r1_page_table[i].pfn);
       }
     }
   }
  fail_fin:
+  pcb_array[child->pid] = NULL;
+  parent->num_children--;
   free(child);
   parent->u_context.regs[0] = ERROR;
   return NULL;
@@ -185,7 +204,7 @@ int HandleDelay(int delay_ticks, UserContext* u_context){
   }
   
   RUNNING.head->wakeup_time = ticks + delay_ticks;
-  TracePrintf(TRACE_VERBOSE, "HandleDelay() at tick %d: putting process #%d to sleep until tick %d\n",
+  KTRACE(TRACE_VERBOSE, "HandleDelay() at tick %d: putting process #%d to sleep until tick %d\n",
 	      ticks, RUNNING.head->pid, RUNNING.head->wakeup_time);
 
   memcpy(&RUNNING.head->u_context, u_context, sizeof(UserContext));
@@ -203,11 +222,13 @@ int HandleExec(char* filename, char** argv) {
 
   int pid = RUNNING.head->pid;
   int ppid = RUNNING.head->ppid;
-  //TracePrintf(TRACE_COMMENT, "HandleExec: before load program, pid#%d, ppid#%d\n", pid, ppid);
-  int rv = LoadProgram(filename, argv, RUNNING.head);
+  //KTRACE(TRACE_COMMENT, "HandleExec: before load program, pid#%d, ppid#%d\n", pid, ppid);
+  // The samples so far are of the program being left.
+  ProfileWrite(RUNNING.head);
+  int rv = LoadProgram(filename, argv, RUNNING.head, 1);
   pid = RUNNING.head->pid;
   ppid = RUNNING.head->ppid;
-  TracePrintf(TRACE_COMMENT, "HandleExec: after load program, pid#%d, ppid#%d\n", pid, ppid);
+  KTRACE(TRACE_COMMENT, "HandleExec: after load program, pid#%d, ppid#%d\n", pid, ppid);
   
   if( rv == SUCCESS ) {
     return SUCCESS;
@@ -222,6 +243,228 @@ int HandleExec(char* filename, char** argv) {
   return KILL;
 }
 
+// Helper method for HandleSpawn(). Frees the kernel copies of Spawn()'s arguments.
+void FreeSpawn(spawn_t* spawn) {
+  int i;
+  for(i = 0; spawn->args != NULL && spawn->args[i] != NULL; i++) {
+    free(spawn->args[i]);
+  }
+  free(spawn->args);
+  free(spawn->name);
+  free(spawn);
+}
+
+// Helper method for HandleSpawn(). Copies name and argv into the kernel, since the
+// child loads them from its own (empty) Region 1. Returns NULL if any is bad.
+spawn_t* NewSpawn(char* user_name, char** user_argv) {
+  if( !CheckUserString(user_name, PROT_READ, MAX_PROGRAM_NAME_LENGTH) ) {
+    WARN_USER("HandleSpawn(): bad program name.\n");
+    return NULL;
+  }
+  int argc;
+  for(argc = 0; ; argc++) {
+    if( !CheckUserPointer(&user_argv[argc], PROT_READ) ) {
+      WARN_USER("HandleSpawn(): bad argument array.\n");
+      return NULL;
+    }
+    if( user_argv[argc] == NULL ) {
+      break;
+    }
+    if( !CheckUserString(user_argv[argc], PROT_READ, MAX_PROGRAM_NAME_LENGTH) ) {
+      WARN_USER("HandleSpawn(): bad argument.\n");
+      return NULL;
+    }
+  }
+
+  spawn_t* spawn = (spawn_t*)calloc(1, sizeof(spawn_t));
+  assert(spawn);
+  spawn->name = (char*)malloc(strlen(user_name) + 1);
+  assert(spawn->name);
+  strcpy(spawn->name, user_name);
+  spawn->args = (char**)calloc(argc + 1, sizeof(char*));
+  assert(spawn->args);
+  int i;
+  for(i = 0; i < argc; i++) {
+    spawn->args[i] = (char*)malloc(strlen(user_argv[i]) + 1);
+    assert(spawn->args[i]);
+    strcpy(spawn->args[i], user_argv[i]);
+  }
+  InitQueue(&spawn->WAITERS);
+  return spawn;
+}
+
+// Helper method for HandleSpawn(). Takes a child which never ran a program off
+// parent's books, so that Wait() does not see it.
+void ForgetChild(pcb_t* parent, int pid) {
+  soul_t** link;
+  for(link = &parent->dead_children_head; *link != NULL; link = &(*link)->next) {
+    if( (*link)->pid == pid ) {
+      soul_t* soul = *link;
+      *link = soul->next;
+      free(soul);
+      break;
+    }
+  }
+  // Recompute the tail.
+  parent->dead_children_tail = NULL;
+  for(link = &parent->dead_children_head; *link != NULL; link = &(*link)->next) {
+    parent->dead_children_tail = *link;
+  }
+  parent->num_children--;
+}
+
+// Spawn().
+//
+// 1. Copy name and argv into the kernel.
+// 2. Prepare a fresh PCB for the child, with a kernel stack and no Region 1.
+// 3. Give the child parent's open files.
+// 4. Add child to READY queue, freezing its kernel context here.
+// 5. Child: load the program into its own address space, and tell parent how it went.
+// 6. Parent: wait for that.
+//
+// Unlike HandleFork(), nothing in Region 1 is allocated or copied for the child:
+// LoadProgram() builds its address space from scratch.
+int HandleSpawn(char* user_name, char** user_argv, UserContext* u_context) {
+  // 1. Copy arguments.
+  if( user_argv == NULL ) {
+    WARN_USER("HandleSpawn(): passed NULL argument array.\n");
+    return ERROR;
+  }
+  spawn_t* spawn = NewSpawn(user_name, user_argv);
+  if( spawn == NULL ) {
+    return ERROR;
+  }
+
+  // 2. Prepare child's PCB.
+  pcb_t* parent = RUNNING.head;
+  pcb_t* child  = InitPCB(parent->pid);
+  int    pid    = child->pid;
+  { int i;
+    for(i = 0; i < R0_STACK_PAGE_TABLE_SIZE; i++) {
+      child->r0_stack_page_table[i].valid = 1;
+      child->r0_stack_page_table[i].prot  = PROT_READ | PROT_WRITE;
+      child->r0_stack_page_table[i].pfn   = FindFreeFrame(PROT_READ | PROT_WRITE);
+      if( ERROR == child->r0_stack_page_table[i].pfn ) {
+	TracePrintf(TRACE_CRITICAL, "HandleSpawn(): insufficient memory for process #%d to create new process #%d.\n", parent->pid, pid);
+	int j;
+	for(j = 0; j < i; j++) {
+	  FreeFrame(child->r0_stack_page_table[j].pfn);
+	}
+	pcb_array[pid] = NULL;
+	free(child);
+	FreeSpawn(spawn);
+	return ERROR;
+      }
+      SetFrameOwner(child->r0_stack_page_table[i].pfn, pid,
+		    (void*) (KERNEL_STACK_BASE + i * PAGESIZE), FRAME_KERNEL_STACK);
+    }
+  }
+  parent->num_children++;
+
+  // 3. Child shares parent's open files; shared memory is left behind with Region 1.
+  FsForkProcess(parent, child);
+  ProfileFork(parent, child);
+
+  // 4. Add child to READY queue, and freeze its kernel context and stack.
+  // The child starts from the caller's registers; LoadProgram() sets pc and sp.
+  memcpy(&child->u_context, u_context, sizeof(UserContext));
+  AddToQueue(child, &READY);
+  CopyKernelStack(child, parent);
+  LoadKernelContext(child);
+
+  // 5. Child, running for the first time.
+  if( RUNNING.head == child ) {
+    int rv = LoadProgram(spawn->name, spawn->args, child, 1);
+    spawn->result = rv;
+    spawn->done   = 1;
+    while( spawn->WAITERS.head != NULL ) {
+      pcb_t* proc = spawn->WAITERS.head;
+      RemoveFromQueue(proc, &spawn->WAITERS);
+      AddToQueue(proc, &READY);
+    }
+    if( rv != SUCCESS ) {
+      TracePrintf(TRACE_USER_WARNING, "HandleSpawn(): process #%d cannot load '%s'.\n", pid, spawn->name);
+      KillProcess(child, &RUNNING, rv); // Does not return.
+    }
+    memcpy(u_context, &child->u_context, sizeof(UserContext));
+    ChangeAddressSpace(child);
+    return 0;
+  }
+
+  // 6. Parent. The child frees nothing in spawn; it is done with it once done is set.
+  while( !spawn->done ) {
+    ContextSwitch(READY.head, &READY, &spawn->WAITERS);
+  }
+  int result = spawn->result == SUCCESS ? pid : ERROR;
+  if( result == ERROR ) {
+    ForgetChild(parent, pid);
+  }
+  FreeSpawn(spawn);
+  return result;
+}
+
+int HandleGetCounters(counters_t* user_counters) {
+  if( !CheckUserBuffer(user_counters, sizeof(counters_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  memcpy(user_counters->counters, counters,       sizeof(counters));
+  memcpy(user_counters->syscalls, syscall_counts, sizeof(syscall_counts));
+  memcpy(user_counters->custom,   custom_counts,  sizeof(custom_counts));
+  return SUCCESS;
+}
+
+int HandleSyscallHist(int call, syscall_hist_t* user_hist) {
+  if( call < 0 || call >= HIST_CALLS ||
+      !CheckUserBuffer(user_hist, sizeof(syscall_hist_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  if( syscall_hists[call] == NULL ) {
+    memset(user_hist, 0, sizeof(syscall_hist_t));
+  } else {
+    memcpy(user_hist, syscall_hists[call], sizeof(syscall_hist_t));
+  }
+  return SUCCESS;
+}
+
+int HandleFrameStats(frame_stats_t* stats) {
+  if( !CheckUserBuffer(stats, sizeof(frame_stats_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  stats->allocated = counters[COUNTER_FRAMES_ALLOCATED];
+  stats->copied    = counters[COUNTER_FRAMES_COPIED];
+  stats->free      = 0;
+  int i;
+  for(i = frame_addr_to_id(KERNEL_DATA_END); i < FRAME_TABLE_SIZE; i++) {
+    stats->free += !frame_table[i].valid;
+  }
+  return SUCCESS;
+}
+
+int HandleFrameMap(frame_map_t* map, int first, int count) {
+  if( first < 0 || count < 0 ) {
+    return ERROR;
+  }
+  if( first >= FRAME_TABLE_SIZE ) {
+    return 0;
+  }
+  // Clamp before checking the buffer, so count * sizeof(frame_map_t) cannot overflow.
+  if( count > FRAME_TABLE_SIZE - first ) {
+    count = FRAME_TABLE_SIZE - first;
+  }
+  if( !CheckUserBuffer(map, count * sizeof(frame_map_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  int n;
+  for(n = 0; n < count; n++) {
+    fte_t* fte  = &frame_table[first + n];
+    map[n].pid  = fte->owner;
+    map[n].kind = fte->valid ? fte->kind : FRAME_FREE;
+    map[n].refs = fte->refs < 255 ? fte->refs : 255;
+    map[n].vpn  = fte->vpn;
+  }
+  return n;
+}
+
 int HandleBrk(void* requested_addr){
   int pt_request_index = r1_addr_to_id(requested_addr);
   pcb_t* cur_pcb = RUNNING.head;
@@ -229,19 +472,25 @@ int HandleBrk(void* requested_addr){
 
   // if the user process already "owns" that memory, simply return the current break
   if (pt_request_index  <  pt_br_cur_index) {
-    TracePrintf(TRACE_VERBOSE, "HandleBrk(): program already has %p.\n", requested_addr);
+    KTRACE(TRACE_VERBOSE, "HandleBrk(): program already has %p.\n", requested_addr);
     return SUCCESS;
   }
   
   // cannot grow heap into, or within one page of, the stack
   else if (pt_request_index >= cur_pcb -> r1_stack_base_index - 1) {
-    TracePrintf(TRACE_COMMENT, "HandleBrk(): cannot heap in stack, at %p.\n", requested_addr);
+    KTRACE(TRACE_COMMENT, "HandleBrk(): cannot heap in stack, at %p.\n", requested_addr);
+    return ERROR;
+  }
+
+  // likewise for an attached shared memory segment (which always sits above the heap)
+  else if (cur_pcb->shm_id != 0 && pt_request_index >= cur_pcb->r1_shm_base_index - 1) {
+    KTRACE(TRACE_COMMENT, "HandleBrk(): cannot heap in shared memory, at %p.\n", requested_addr);
     return ERROR;
   }
 
   // if we've gotten to this point, it's a valid request and we need to grow the stack
-  TracePrintf(TRACE_VERBOSE, "HandleBrk(): current break is at             %p.\n", r1_id_to_addr(pt_br_cur_index));
-  TracePrintf(TRACE_VERBOSE, "HandleBrk(): will grant requested address at %p.\n", requested_addr);
+  KTRACE(TRACE_VERBOSE, "HandleBrk(): current break is at             %p.\n", r1_id_to_addr(pt_br_cur_index));
+  KTRACE(TRACE_VERBOSE, "HandleBrk(): will grant requested address at %p.\n", requested_addr);
 
   // step 1: gather necessary free frames
   int frames_required = pt_request_index - pt_br_cur_index;
@@ -266,7 +515,7 @@ int HandleBrk(void* requested_addr){
     num_acquired_frames++;
   }
 
-  TracePrintf(TRACE_VERBOSE, "HandleBrk(): %d frames found for %p.\n", num_acquired_frames, requested_addr);
+  KTRACE(TRACE_VERBOSE, "HandleBrk(): %d frames found for %p.\n", num_acquired_frames, requested_addr);
 
   //step 2: arrange ptes
   int i;
@@ -274,18 +523,96 @@ int HandleBrk(void* requested_addr){
     cur_pcb->r1_page_table[i + pt_br_cur_index + 1].valid = 1;
     cur_pcb->r1_page_table[i + pt_br_cur_index + 1].prot  = PROT_READ | PROT_WRITE;
     cur_pcb->r1_page_table[i + pt_br_cur_index + 1].pfn   = acquired_frames[i];
+    SetFrameOwner(acquired_frames[i], cur_pcb->pid, r1_id_to_addr(i + pt_br_cur_index + 1),
+		  FRAME_HEAP);
   }
 
   // set new break and return to user
   cur_pcb -> r1_break_limit_index = pt_br_cur_index + frames_required;
-  TracePrintf(TRACE_VERBOSE, "HandleBrk(): new break at index %d, max addr %p.\n", 
+  KTRACE(TRACE_VERBOSE, "HandleBrk(): new break at index %d, max addr %p.\n", 
 	      cur_pcb->r1_break_limit_index,
 	      UP_TO_PAGE((r1_id_to_addr(cur_pcb->r1_break_limit_index))));
   return SUCCESS;
 }
 
-int HandleTtyWrite(int tty_id, void* buffer, int length) {
-  TracePrintf(TRACE_VERBOSE, "HandleTtyWrite() called with tty_id:%d, buffer:%p of length: %d.\n", tty_id, buffer, length);
+// Helper method for I/O calls with flags.
+//
+// Turns (buffer, length) into kiov[0], or, with IO_VECTOR, copies the user's iovec_t
+// array (buffer, length==iovcnt) into kiov[0..(YALNIX_IOV_MAX-1)]. Every buffer is
+// checked for desired_protection up front. Returns the number of entries, or ERROR.
+int GetIovec(void* buffer, int length, int flags, int desired_protection, iovec_t* kiov) {
+  if( !(flags & IO_VECTOR) ) {
+    if( length < 0 || !CheckUserBuffer(buffer, length, desired_protection) ) {
+      return ERROR;
+    }
+    kiov[0].base = buffer;
+    kiov[0].len  = length;
+    return 1;
+  }
+
+  int iovcnt = length;
+  if( iovcnt <= 0 || iovcnt > YALNIX_IOV_MAX ) {
+    WARN_USER("GetIovec(): cannot take %d iovecs.\n", iovcnt);
+    return ERROR;
+  }
+  if( !CheckUserBuffer(buffer, iovcnt * sizeof(iovec_t), PROT_READ) ) {
+    return ERROR;
+  }
+  memcpy(kiov, buffer, iovcnt * sizeof(iovec_t));
+
+  { int i;
+    for(i = 0; i < iovcnt; i++) {
+      if( kiov[i].len < 0 || !CheckUserBuffer(kiov[i].base, kiov[i].len, desired_protection) ) {
+	return ERROR;
+      }
+    }
+  }
+  return iovcnt;
+}
+
+int IovecLength(iovec_t* iov, int iovcnt) {
+  int length = 0;
+  int i;
+  for(i = 0; i < iovcnt; i++) {
+    length += iov[i].len;
+  }
+  return length;
+}
+
+// Copies length bytes, starting offset bytes into the concatenation of iov[], to dest.
+void IovecGather(iovec_t* iov, int iovcnt, int offset, char* dest, int length) {
+  int i;
+  for(i = 0; i < iovcnt && length > 0; i++) {
+    if( offset >= iov[i].len ) {
+      offset -= iov[i].len;
+      continue;
+    }
+    int n = iov[i].len - offset;
+    if( n > length ) {
+      n = length;
+    }
+    memcpy(dest, (char*) iov[i].base + offset, n);
+    WORK(BYTES_COPIED, n);
+    dest   += n;
+    length -= n;
+    offset  = 0;
+  }
+}
+
+// Copies length bytes from src over the concatenation of iov[].
+void IovecScatter(iovec_t* iov, int iovcnt, char* src, int length) {
+  int i;
+  for(i = 0; i < iovcnt && length > 0; i++) {
+    int n = iov[i].len < length ? iov[i].len : length;
+    memcpy(iov[i].base, src, n);
+    WORK(BYTES_COPIED, n);
+    src    += n;
+    length -= n;
+  }
+}
+
+int HandleTtyWrite(int tty_id, void* buffer, int length, int flags) {
+  KTRACE(TRACE_VERBOSE, "HandleTtyWrite() called with tty_id:%d, buffer:%p of length: %d.\n", tty_id, buffer, length);
   pcb_t* proc = RUNNING.head;
 
   if( tty_id < 0 || tty_id >= NUM_TERMINALS ) {
@@ -298,100 +625,384 @@ int HandleTtyWrite(int tty_id, void* buffer, int length) {
     return ERROR;
   }
 
-  // Check the validity of buffer.
-  if(!CheckUserBuffer(buffer, length, PROT_READ)) {
+  // Check the validity of buffer(s).
+  iovec_t iov[YALNIX_IOV_MAX];
+  int     iovcnt = GetIovec(buffer, length, flags, PROT_READ, iov);
+  if( ERROR == iovcnt ) {
+    return ERROR;
+  }
+  length = IovecLength(iov, iovcnt);
+
+  // A small write goes in as one record, so that it reaches the terminal in one piece.
+  // A large one goes in as room frees up; the scheduler interleaves it with others
+  // at line boundaries (see tty_output_t).
+  int large   = length > TERMINAL_MAX_LINE;
+  int written = 0;
+  while( written < length ) {
+    int room = TtyOutputRoom(tty_id, proc->pid);
+    if( (!large && room < length) || room <= 0 ) {
+      TtyStartTransmit(tty_id);
+      if( flags & IO_NONBLOCK ) {
+	break;
+      }
+      ContextSwitch(READY.head, &READY, &WRITING[tty_id]);
+      continue;
+    }
+
+    int n = length - written;
+    if( n > room ) {
+      n = room;
+    }
+    char* data = (char*)malloc(n);
+    assert(data);
+    // Entries of a vectored write end up in one record.
+    IovecGather(iov, iovcnt, written, data, n);
+    TtyOutputPut(tty_id, proc->pid, data, n, large);
+    written += n;
+  }
+  TtyStartTransmit(tty_id);
+
+  if( written == 0 && length > 0 ) { // Only possible with IO_NONBLOCK.
+    return WOULDBLOCK;
+  }
+
+  KTRACE(TRACE_VERBOSE, "HandleTtyWrite(): Process #%d buffered %d bytes for tty #%d.\n",
+	      proc->pid, written, tty_id);
+
+  return written;
+}
+
+int HandleTtyRead(int tty_id, void* buffer, int length, int flags) {
+  pcb_t* proc = RUNNING.head;
+
+  if( tty_id < 0 || tty_id >= NUM_TERMINALS ) {
+    TracePrintf(TRACE_USER_WARNING, "HandleTtyRead(): Tty #%d does not exist.\n", tty_id);
     return ERROR;
   }
 
-  // Wait until my time comes.
-  while( WRITING[tty_id].head != NULL ) {
-    // i.e., while someone is in queue and I'm not the first in queue,
-    
-    here();
-    ContextSwitch(READY.head, &READY, &WRITING_WAIT[tty_id]);
-    here();
-    // Stand in line and wait.
+  if( length < 0 || (length > TERMINAL_MAX_LINE && !(flags & IO_VECTOR)) ) {
+    TracePrintf(TRACE_USER_WARNING, "HandleTtyRead(): Cannot read %d bytes.\n", length);
+    return ERROR;
   }
 
-  int transmitted = 0;
+  // Check the validity of buffer(s).
+  iovec_t iov[YALNIX_IOV_MAX];
+  int     iovcnt = GetIovec(buffer, length, flags, PROT_READ | PROT_WRITE, iov);
+  if( ERROR == iovcnt ) {
+    return ERROR;
+  }
+  length = IovecLength(iov, iovcnt);
 
-  while( transmitted < length ) {
-    int requested;
-    if( /*remaining*/ length - transmitted > TERMINAL_MAX_LINE ) {
-      requested = TERMINAL_MAX_LINE;
-    } else {
-      requested = length - transmitted;
+  // Lines are buffered by HandleTrapTtyReceive(); wait only if there are none.
+  while( tty_in[tty_id].lines == 0 ) {
+    if( flags & IO_NONBLOCK ) {
+      return WOULDBLOCK;
     }
+    ContextSwitch(READY.head, &READY, &READING[tty_id]);
+  }
+
+  // A line is at most TERMINAL_MAX_LINE bytes, so it fits in tty_read_buffer.
+  char* line = tty_read_buffer[tty_id];
+  int actual_length = TtyInputGet(tty_id, line, length);
+  IovecScatter(iov, iovcnt, line, actual_length);
 
-    memcpy(tty_write_buffer[tty_id], buffer + transmitted, requested);
+  // Pass leftover lines on to the next reader.
+  if( tty_in[tty_id].lines > 0 && READING[tty_id].head != NULL ) {
+    pcb_t* reader = READING[tty_id].head;
+    RemoveFromQueue(reader, &READING[tty_id]);
+    AddToQueue(reader, &READY);
+  }
 
-    //    { // Print for catching the bug about malloc()-TtyWrite()-TtyWrite() sequence.
-    //      here();
-    //      tty_write_buffer[tty_id][requested] = '\0';
-    //      TracePrintf(TRACE_VERBOSE, "HandleTtyWrite(): calling TtyTransmit():\n"
-    //		  TRACE_N "  pid    : #%d\n"
-    //		  TRACE_N "  tty    : #%d\n"
-    //		  TRACE_N "  length : %d\n"
-    //		  , proc->pid, tty_id, requested
-    //		  );
-    //      TracePrintf(TRACE_VERBOSE, "  user buffer  : %s\n"
-    //		  TRACE_N "  kernel_buffer: %s\n",
-    //		  buffer + transmitted, tty_write_buffer[tty_id]
-    //		  );
-    //      here();
-    //    }
+  KTRACE(TRACE_VERBOSE, "HandleTtyRead(): process #%d read %d bytes from tty #%d.\n",
+	      proc->pid, actual_length, tty_id);
+  return actual_length;
+}
 
-    TtyTransmit(tty_id, tty_write_buffer[tty_id], requested);
-    //    here();
-    //    TracePrintf(TRACE_VERBOSE, "HandleTtyWrite(): TtyTransmit() returns.\n"
-    //		TRACE_N        "                  Calling ContextSwitch().\n");
-    //    here();
-    ContextSwitch(READY.head, &READY, &WRITING[tty_id]);
-    //    here();
-    //    TracePrintf(TRACE_VERBOSE, "HandleTtyWrite(): ContextSwitch() returns.\n");
-    //    here();
+int HandleTtyStats(int tty_id, tty_stats_t* stats) {
+  if( tty_id < 0 || tty_id >= NUM_TERMINALS ) {
+    return ERROR;
+  }
+  if( !CheckUserBuffer(stats, sizeof(tty_stats_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  stats->input_buffered = tty_in[tty_id].count;
+  stats->input_lines    = tty_in[tty_id].lines;
+  stats->bytes_buffered = tty_in[tty_id].bytes_buffered;
+  stats->overruns       = tty_in[tty_id].overruns;
+  stats->output_buffered  = tty_out[tty_id].count;
+  stats->output_transmits = tty_out[tty_id].transmits;
+  stats->bytes_sent       = tty_out[tty_id].bytes_sent;
+  return SUCCESS;
+}
 
-    transmitted += requested;
+int HandleReadSector(int sector, void* buffer) {
+  if( sector < 0 || sector >= NUMSECTORS ) {
+    WARN_USER("HandleReadSector(): sector %d does not exist.\n", sector);
+    return ERROR;
+  }
+  if( !CheckUserBuffer(buffer, SECTORSIZE, PROT_READ | PROT_WRITE) ) {
+    return ERROR;
   }
 
-  here();
-  TracePrintf(TRACE_VERBOSE, "HandleTtyWrite(): Process #%d finishes writing %d bytes to tty #%d.\n",
-	      proc->pid, transmitted, tty_id);
-  here();
+  // CacheGet() may block; I am back in my address space when it returns.
+  buf_t* buf = CacheGet(sector, 1);
+  if( buf == NULL ) {
+    return ERROR;
+  }
+  memcpy(buffer, buf->data, SECTORSIZE);
+  WORK(BYTES_COPIED, SECTORSIZE);
+  CacheRelease(buf, 0);
 
+  // Read ahead of a process going through the disk in order.
+  int first;
+  int count = CacheReadAhead(&RUNNING.head->sector_ra, sector, 1, &first);
+  int i;
+  for(i = first; i < first + count && i < NUMSECTORS; i++) {
+    CachePrefetch(i);
+  }
   return SUCCESS;
 }
 
-int HandleTtyRead(int tty_id, void* buffer, int length) {
-  pcb_t* proc = RUNNING.head;
+int HandleWriteSector(int sector, void* buffer) {
+  if( sector < 0 || sector >= NUMSECTORS ) {
+    WARN_USER("HandleWriteSector(): sector %d does not exist.\n", sector);
+    return ERROR;
+  }
+  if( !CheckUserBuffer(buffer, SECTORSIZE, PROT_READ) ) {
+    return ERROR;
+  }
 
-  if( tty_id < 0 || tty_id >= NUM_TERMINALS ) {
-    TracePrintf(TRACE_USER_WARNING, "HandleTtyRead(): Tty #%d does not exist.\n", tty_id);
+  // The whole sector is overwritten, so a miss need not read it first.
+  buf_t* buf = CacheGet(sector, 0);
+  memcpy(buf->data, buffer, SECTORSIZE);
+  WORK(BYTES_COPIED, SECTORSIZE);
+  CacheRelease(buf, 1);
+  return SUCCESS;
+}
+
+int HandleSync(void) {
+  CacheSync();
+  return SUCCESS;
+}
+
+// Helper method for the file system calls. Copies the path at user_path into path,
+// which has room for MAXPATHNAMELEN bytes.
+int GetPath(char* user_path, char* path) {
+  if( !CheckUserString(user_path, PROT_READ, MAXPATHNAMELEN) ) {
+    WARN_USER("GetPath(): bad path.\n");
     return ERROR;
   }
+  strncpy(path, user_path, MAXPATHNAMELEN - 1);
+  path[MAXPATHNAMELEN - 1] = '\0';
+  return SUCCESS;
+}
 
-  if( length < 0 || length > TERMINAL_MAX_LINE ) {
-    TracePrintf(TRACE_USER_WARNING, "HandleTtyRead(): Cannot read %d bytes.\n", length);
+// Helper method for the file system calls. Returns the running process's open file fd,
+// or NULL.
+open_file_t* GetFile(int fd) {
+  if( fd < 0 || fd >= MAX_OPEN_FILES ) {
+    return NULL;
+  }
+  return RUNNING.head->files[fd];
+}
+
+// Helper method for HandleOpen() and HandleCreate(). Gives the running process a
+// descriptor for inum, or returns ERROR if it has MAX_OPEN_FILES already.
+int NewFd(int inum) {
+  int fd;
+  for(fd = 0; fd < MAX_OPEN_FILES; fd++) {
+    if( RUNNING.head->files[fd] == NULL ) {
+      RUNNING.head->files[fd] = FsOpenFile(inum);
+      return fd;
+    }
+  }
+  WARN_USER("NewFd(): process #%d has too many open files.\n", RUNNING.head->pid);
+  return ERROR;
+}
+
+int HandleOpen(char* user_path) {
+  char path[MAXPATHNAMELEN];
+  if( GetPath(user_path, path) != SUCCESS ) {
     return ERROR;
   }
+  int inum = ERROR;
+  if( FsLock() == SUCCESS ) {
+    inum = FsLookup(path);
+  }
+  FsUnlock();
+  return inum == ERROR ? ERROR : NewFd(inum);
+}
 
-  // Check the validity of buffer.
-  if(!CheckUserBuffer(buffer, length, PROT_READ | PROT_WRITE)) {
+int HandleClose(int fd) {
+  open_file_t* file = GetFile(fd);
+  if( file == NULL ) {
     return ERROR;
   }
+  FsCloseFile(file);
+  RUNNING.head->files[fd] = NULL;
+  return SUCCESS;
+}
 
-  ContextSwitch(READY.head, &READY, &READING[tty_id]);
+int HandleCreate(char* user_path, int type) {
+  char path[MAXPATHNAMELEN];
+  if( GetPath(user_path, path) != SUCCESS ) {
+    return ERROR;
+  }
+  int inum = ERROR;
+  if( FsLock() == SUCCESS ) {
+    inum = FsCreate(path, type);
+  }
+  FsUnlock();
+  if( inum == ERROR ) {
+    return ERROR;
+  }
+  // MkDir() opens nothing.
+  return type == INODE_DIRECTORY ? SUCCESS : NewFd(inum);
+}
 
-  int rv = TtyReceive(tty_id, tty_read_buffer[tty_id], TERMINAL_MAX_LINE);
+int HandleRead(int fd, void* buffer, int length) {
+  open_file_t* file = GetFile(fd);
+  if( file == NULL || length < 0 || !CheckUserBuffer(buffer, length, PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  // FsRead() copies straight into buffer; I am in my own address space whenever it runs.
+  int result = ERROR;
+  if( FsLock() == SUCCESS ) {
+    result = FsRead(file->inum, buffer, file->pos, length, &file->ra);
+  }
+  if( result > 0 ) {
+    file->pos += result;
+  }
+  FsUnlock();
+  return result;
+}
 
-  here();
-  TracePrintf(0, "%d.\n", rv);
-  here();
+int HandleWrite(int fd, void* buffer, int length) {
+  open_file_t* file = GetFile(fd);
+  if( file == NULL || length < 0 || !CheckUserBuffer(buffer, length, PROT_READ) ) {
+    return ERROR;
+  }
+  int result = ERROR;
+  if( FsLock() == SUCCESS ) {
+    result = FsWrite(file->inum, buffer, file->pos, length);
+  }
+  if( result > 0 ) {
+    file->pos += result;
+  } else if( result == 0 && length > 0 ) {
+    result = ERROR; // The disk or the file is full.
+  }
+  FsUnlock();
+  return result;
+}
 
-  int actual_length = length > rv ? rv : length;
-  memcpy(buffer, tty_read_buffer[tty_id], actual_length * sizeof(char));
+int HandleSeek(int fd, int offset, int whence) {
+  open_file_t* file = GetFile(fd);
+  if( file == NULL ) {
+    return ERROR;
+  }
+  int type;
+  int size = 0;
+  if( whence == FS_SEEK_END ) {
+    int result = FsLock();
+    if( result == SUCCESS ) {
+      result = FsStat(file->inum, &type, &size);
+    }
+    FsUnlock();
+    if( result != SUCCESS ) {
+      return ERROR;
+    }
+  }
 
-  return actual_length;
+  int pos;
+  switch( whence ) {
+  case FS_SEEK_SET: pos = offset;             break;
+  case FS_SEEK_CUR: pos = file->pos + offset; break;
+  case FS_SEEK_END: pos = size + offset;      break;
+  default:
+    return ERROR;
+  }
+  if( pos < 0 ) {
+    return ERROR;
+  }
+  file->pos = pos;
+  return pos;
+}
+
+int HandleUnlink(char* user_path) {
+  char path[MAXPATHNAMELEN];
+  if( GetPath(user_path, path) != SUCCESS ) {
+    return ERROR;
+  }
+  int result = ERROR;
+  if( FsLock() == SUCCESS ) {
+    result = FsUnlink(path);
+  }
+  FsUnlock();
+  return result;
+}
+
+int HandleReadDir(int fd, struct dir_entry* entry) {
+  open_file_t* file = GetFile(fd);
+  if( file == NULL || !CheckUserBuffer(entry, sizeof(struct dir_entry), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  int type, size;
+  int result = FsLock();
+  if( result == SUCCESS ) {
+    result = FsStat(file->inum, &type, &size);
+  }
+  if( result == SUCCESS && type != INODE_DIRECTORY ) {
+    result = ERROR;
+  }
+  // Skip free entries.
+  while( result == SUCCESS ) {
+    struct dir_entry next;
+    int length = FsRead(file->inum, &next, file->pos, sizeof(struct dir_entry), NULL);
+    if( length != sizeof(struct dir_entry) ) {
+      result = length == 0 ? 0 : ERROR;
+      break;
+    }
+    file->pos += length;
+    if( next.inum != 0 ) {
+      memcpy(entry, &next, sizeof(struct dir_entry));
+      result = 1;
+    }
+  }
+  FsUnlock();
+  return result;
+}
+
+int HandleInstall(char* user_linux_name, char* user_path) {
+  char path[MAXPATHNAMELEN];
+  if( GetPath(user_path, path) != SUCCESS ) {
+    return ERROR;
+  }
+  if( !CheckUserString(user_linux_name, PROT_READ, MAX_PROGRAM_NAME_LENGTH) ) {
+    WARN_USER("HandleInstall(): bad program name.\n");
+    return ERROR;
+  }
+  char linux_name[MAX_PROGRAM_NAME_LENGTH];
+  strncpy(linux_name, user_linux_name, MAX_PROGRAM_NAME_LENGTH - 1);
+  linux_name[MAX_PROGRAM_NAME_LENGTH - 1] = '\0';
+  return InstallProgram(linux_name, path);
+}
+
+int HandleCacheStats(cache_stats_t* stats) {
+  if( !CheckUserBuffer(stats, sizeof(cache_stats_t), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+  stats->hits       = cache_hits;
+  stats->misses     = cache_misses;
+  stats->writebacks = cache_writebacks;
+  stats->readaheads = cache_readaheads;
+  stats->ra_hits    = cache_ra_hits;
+  stats->ra_wasted  = cache_ra_wasted;
+  stats->dirty      = 0;
+  int i;
+  for(i = 0; i < BLOCK_CACHESIZE; i++) {
+    stats->dirty += bufs[i].dirty;
+  }
+  return SUCCESS;
 }
 
 int HandleLockInit(int* id) {
@@ -420,7 +1031,7 @@ int HandleLockInit(int* id) {
   return SUCCESS;
 }
 
-int HandleAcquire(int lock_id) {
+int HandleAcquire(int lock_id, int timeout) {
 
   // Invalid ID.
   if( IsInvalidIID(lock_id) ) {
@@ -447,7 +1058,9 @@ int HandleAcquire(int lock_id) {
   }
   // At this point, some other process has the lock.
 
-  ContextSwitch(READY.head, &READY, &lock->QUEUE);
+  if( TIMEOUT == BlockOn(&lock->QUEUE, timeout) ) {
+    return TIMEOUT;
+  }
   // At this point, I can have this lock.
 
   lock->haver = RUNNING.head;
@@ -480,16 +1093,111 @@ int HandleRelease(int lock_id) {
   // At this point, process's call is valid.
 
   // If someone is waiting, wake him/her up.
-  if( lock->QUEUE.head != NULL ) {
-    pcb_t* acquire_lock_next = lock->QUEUE.head;
-    RemoveFromQueue(acquire_lock_next, &lock->QUEUE);
-    AddToQueue(acquire_lock_next, &READY);
-    lock->haver = acquire_lock_next;
+  // JBB: only set no haver if no one was waiting
+  LockHandOff(lock);
+  return SUCCESS;  
+}
+
+int HandleRWLockInit(int* id) {
+  if( !CheckUserPointer(id, PROT_READ | PROT_WRITE)) {
+    return ERROR;
   }
-  else{
-    lock->haver = NULL; // JBB: only set no haver if no one was waiting
+
+  *id = NEXT_IID;
+  interp_t* interp = (interp_t*)malloc(sizeof(interp_t));
+  assert(interp);
+  rwlock_t* rwlock = (rwlock_t*)malloc(sizeof(rwlock_t));
+  assert(rwlock);
+
+  interp->type       = RWLOCK;
+  interp->ptr.rwlock = rwlock;
+
+  rwlock->owner       = RUNNING.head;
+  rwlock->writer      = NULL;
+  rwlock->readers     = NULL;
+  rwlock->num_readers = 0;
+  InitQueue(&rwlock->READERS);
+  InitQueue(&rwlock->WRITERS);
+
+  RegisterInterp(*id, interp);
+
+  return SUCCESS;
+}
+
+// Helper method for the reader-writer lock calls.
+// Returns the lock at id, or NULL if id is not a reader-writer lock.
+rwlock_t* GetRWLock(int id) {
+  if( IsInvalidIID(id) ) {
+    return NULL;
   }
-  return SUCCESS;  
+  if( RWLOCK != interp_array[id]->type ) {
+    WARN_USER("GetRWLock(): interp #%d is not a reader-writer lock.\n", id);
+    return NULL;
+  }
+  return interp_array[id]->ptr.rwlock;
+}
+
+int HandleAcquireRead(int id) {
+  rwlock_t* rwlock = GetRWLock(id);
+  if( NULL == rwlock ) {
+    return ERROR;
+  }
+
+  // I have the lock.
+  if( rwlock->writer == RUNNING.head || RWLockIsReader(rwlock, RUNNING.head) ) {
+    return ERROR;
+  }
+  // At this point, the call is legitimate.
+
+  // I can read right away unless someone writes or wants to write.
+  if( NULL == rwlock->writer && NULL == rwlock->WRITERS.head ) {
+    RWLockAddReader(rwlock, RUNNING.head);
+    return SUCCESS;
+  }
+
+  ContextSwitch(READY.head, &READY, &rwlock->READERS);
+
+  // If the lock was destroyed while I was waiting, return ERROR.
+  if( IsInvalidIID(id) ) {
+    return ERROR;
+  }
+  // At this point, RWLockHandOff() has made me a reader.
+  return SUCCESS;
+}
+
+int HandleAcquireWrite(int id) {
+  rwlock_t* rwlock = GetRWLock(id);
+  if( NULL == rwlock ) {
+    return ERROR;
+  }
+
+  // I have the lock.
+  if( rwlock->writer == RUNNING.head || RWLockIsReader(rwlock, RUNNING.head) ) {
+    return ERROR;
+  }
+  // At this point, the call is legitimate.
+
+  if( NULL == rwlock->writer && 0 == rwlock->num_readers ) {
+    rwlock->writer = RUNNING.head;
+    return SUCCESS;
+  }
+
+  ContextSwitch(READY.head, &READY, &rwlock->WRITERS);
+
+  // If the lock was destroyed while I was waiting, return ERROR.
+  if( IsInvalidIID(id) ) {
+    return ERROR;
+  }
+  // At this point, RWLockHandOff() has made me the writer.
+  return SUCCESS;
+}
+
+int HandleReleaseRW(int id) {
+  rwlock_t* rwlock = GetRWLock(id);
+  if( NULL == rwlock ) {
+    return ERROR;
+  }
+  return RWLockRelease(rwlock, RUNNING.head);
 }
 
 int HandleCvarInit(int* id) {
@@ -515,7 +1223,7 @@ int HandleCvarInit(int* id) {
   return SUCCESS;
 }
 
-int HandleCvarWait(int id, int lock_id) {
+int HandleCvarWait(int id, int lock_id, int timeout) {
 
   if( IsInvalidIID(id) ) {
     WARN_USER("HandleCvarWait: Invalid Cvar Id %d\n", id);
@@ -548,7 +1256,7 @@ int HandleCvarWait(int id, int lock_id) {
   cvar_t* cvar = interp_array[id]->ptr.cvar;
 
   // Wait on the cvar.
-  ContextSwitch(READY.head, &READY, &cvar->QUEUE);
+  int result = BlockOn(&cvar->QUEUE, timeout);
 
   // If cvar or lock was destroyed while I was waiting, return ERROR.
   if( IsInvalidIID(id) || IsInvalidIID(lock_id) ) {
@@ -556,13 +1264,13 @@ int HandleCvarWait(int id, int lock_id) {
     return ERROR;
   }
 
-  // Upon waking up, re-acquire the lock.
-  if( ERROR == HandleAcquire(lock_id) ) {
+  // Upon waking up (or timing out), re-acquire the lock.
+  if( ERROR == HandleAcquire(lock_id, NO_TIMEOUT) ) {
     WARN_USER("HandleCvarWait: Could not reacquire lock #%d!\n", lock_id);
     return ERROR;
   }
 
-  return SUCCESS;  
+  return result;  
 }
 
 int HandleCvarSignal(int id) {
@@ -632,6 +1340,7 @@ int HandlePipeInit(int* id) {
   pipe->buffer = NULL;
   pipe->length = 0;
   InitQueue(&pipe->QUEUE);
+  pipe->pollers = NULL;
 
   RegisterInterp(*id, interp);
 
@@ -681,10 +1390,20 @@ int IsInvalidPipe(int id, void* buffer, int length) {
   return SUCCESS;
 }
 
-int HandlePipeRead(int id, void* buffer, int length) {
-  if( IsInvalidPipe(id, buffer, length) ) {
+int HandlePipeRead(int id, void* buffer, int length, int timeout, int flags) {
+  if( IsInvalidPipe(id, NULL, 0) ) {
     return ERROR;
   }
+  iovec_t iov[YALNIX_IOV_MAX];
+  int     iovcnt = GetIovec(buffer, length, flags, PROT_READ | PROT_WRITE, iov);
+  if( ERROR == iovcnt ) {
+    return ERROR;
+  }
+  length = IovecLength(iov, iovcnt);
+
+  if( flags & IO_NONBLOCK ) {
+    timeout = 0;
+  }
 
   pipe_t* pipe = interp_array[id]->ptr.pipe;
 
@@ -694,8 +1413,20 @@ int HandlePipeRead(int id, void* buffer, int length) {
   //
   // No synchronization techniques are necessary because no one can write to pipe->empty
   // or to pipe->buffer while I am reading pipe->empty.
+  //
+  // A timed read may wake up several times, so it keeps a deadline rather than a budget.
+  int deadline = ticks + timeout;
   while( 0 == pipe->length /*i.e., pipe is empty */ ) {
-    ContextSwitch(READY.head, &READY, &pipe->QUEUE);
+    int remaining = NO_TIMEOUT;
+    if( timeout != NO_TIMEOUT ) {
+      remaining = deadline - ticks;
+      if( remaining < 0 ) {
+	remaining = 0;
+      }
+    }
+    if( TIMEOUT == BlockOn(&pipe->QUEUE, remaining) ) {
+      return (flags & IO_NONBLOCK) ? WOULDBLOCK : TIMEOUT;
+    }
 
     // If pipe is destroyed while I was waiting, return ERROR.
     if( IsInvalidIID(id) ) {
@@ -710,15 +1441,21 @@ int HandlePipeRead(int id, void* buffer, int length) {
   } else {
     actual_length = pipe->length;
   }
-  memcpy(buffer, pipe->buffer, sizeof(char) * actual_length);
+  IovecScatter(iov, iovcnt, pipe->buffer, actual_length);
 
   return actual_length;
 }
 
-int HandlePipeWrite(int id, void* buffer, int length) {
-  if( IsInvalidPipe(id, buffer, length) ) {
+int HandlePipeWrite(int id, void* buffer, int length, int flags) {
+  if( IsInvalidPipe(id, NULL, 0) ) {
+    return ERROR;
+  }
+  iovec_t iov[YALNIX_IOV_MAX];
+  int     iovcnt = GetIovec(buffer, length, flags, PROT_READ, iov);
+  if( ERROR == iovcnt ) {
     return ERROR;
   }
+  length = IovecLength(iov, iovcnt);
   // At this point, call is legitimate.
 
   pipe_t* pipe = interp_array[id]->ptr.pipe;
@@ -726,6 +1463,8 @@ int HandlePipeWrite(int id, void* buffer, int length) {
   // If pipe->buffer is already populated, clear the buffer.
   if( NULL != pipe->buffer ) {
     free(pipe->buffer);
+    pipe->buffer = NULL;
+    pipe->length = 0;
   }
 
   // If writing 0 bytes, clearing the buffer suffices.
@@ -736,7 +1475,7 @@ int HandlePipeWrite(int id, void* buffer, int length) {
   // Write to buffer.
   pipe->buffer = (char*)malloc(sizeof(char) * length);
   assert(pipe->buffer);
-  memcpy(pipe->buffer, buffer, sizeof(char) * length);
+  IovecGather(iov, iovcnt, 0, pipe->buffer, length);
   pipe->length = length;
 
   // Wake up anyone waiting for buffer.
@@ -745,10 +1484,249 @@ int HandlePipeWrite(int id, void* buffer, int length) {
     RemoveFromQueue(proc, &pipe->QUEUE);
     AddToQueue(proc, &READY);
   }
+  WakePollers(pipe->pollers);
 
   return length;
 }
 
+// Helper method for HandlePoll(). Marks the ready sources and returns how many there are.
+int PollCheck(int* ids, int* events, int n) {
+  int ready = 0;
+  int i;
+  for(i = 0; i < n; i++) {
+    int is_ready = 0;
+    events[i] &= ~POLL_READY;
+    switch( events[i] ) {
+    case POLL_PIPE:
+      is_ready = interp_array[ids[i]]->ptr.pipe->length > 0;
+      break;
+    case POLL_TTY:
+      is_ready = tty_in[ids[i]].lines > 0;
+      break;
+    case POLL_CHILD:
+      // With no children at all, Wait() returns ERROR right away.
+      is_ready = RUNNING.head->dead_children_head != NULL || RUNNING.head->num_children == 0;
+      break;
+    }
+    if( is_ready ) {
+      events[i] |= POLL_READY;
+      ready++;
+    }
+  }
+  return ready;
+}
+
+// Helper method for HandlePoll(). Returns ERROR if a source is (no longer) valid.
+int PollValidate(int* ids, int* events, int n) {
+  int i;
+  for(i = 0; i < n; i++) {
+    switch( events[i] & ~POLL_READY ) {
+    case POLL_PIPE:
+      if( IsInvalidPipe(ids[i], NULL, 0) ) {
+	return ERROR;
+      }
+      break;
+    case POLL_TTY:
+      if( ids[i] < 0 || ids[i] >= NUM_TERMINALS ) {
+	return ERROR;
+      }
+      break;
+    case POLL_CHILD:
+      break;
+    default:
+      return ERROR;
+    }
+  }
+  return SUCCESS;
+}
+
+int HandlePoll(int* ids, int* events, int n, int timeout) {
+  pcb_t* proc = RUNNING.head;
+
+  if( n < 0 || n > POLL_MAX ) {
+    WARN_USER("HandlePoll(): cannot poll %d sources.\n", n);
+    return ERROR;
+  }
+  if( n == 0 && timeout == POLL_FOREVER ) {
+    WARN_USER("HandlePoll(): nothing could ever wake me.\n");
+    return ERROR;
+  }
+  if( !CheckUserBuffer(ids,    n * sizeof(int), PROT_READ) ||
+      !CheckUserBuffer(events, n * sizeof(int), PROT_READ | PROT_WRITE) ) {
+    return ERROR;
+  }
+
+  int deadline = ticks + timeout;
+  while( 1 ) {
+    // Pipes may be reclaimed while I wait.
+    if( ERROR == PollValidate(ids, events, n) ) {
+      return ERROR;
+    }
+
+    int ready = PollCheck(ids, events, n);
+    if( ready > 0 ) {
+      return ready;
+    }
+
+    int remaining = NO_TIMEOUT;
+    if( timeout != POLL_FOREVER ) {
+      remaining = deadline - ticks;
+      if( remaining <= 0 ) {
+	return TIMEOUT;
+      }
+    }
+
+    // List myself with every source; whichever becomes ready first wakes me up.
+    int i;
+    for(i = 0; i < n; i++) {
+      if( events[i] == POLL_PIPE ) {
+	PollerAdd(&interp_array[ids[i]]->ptr.pipe->pollers, proc);
+      } else if( events[i] == POLL_TTY ) {
+	PollerAdd(&tty_pollers[ids[i]], proc);
+      }
+      // POLL_CHILD: WakeUpWaitingParent() finds me through ppid.
+    }
+
+    BlockOn(&POLLING, remaining);
+
+    for(i = 0; i < n; i++) {
+      if( events[i] == POLL_PIPE ) {
+	// A reclaimed pipe has already dropped its pollers.
+	if( !IsInvalidIID(ids[i]) && PIPE == interp_array[ids[i]]->type ) {
+	  PollerRemove(&interp_array[ids[i]]->ptr.pipe->pollers, proc);
+	}
+      } else if( events[i] == POLL_TTY ) {
+	PollerRemove(&tty_pollers[ids[i]], proc);
+      }
+    }
+  }
+}
+
+int HandleShmCreate(int size) {
+  if( size <= 0 ) {
+    WARN_USER("HandleShmCreate(): cannot create a segment of %d bytes.\n", size);
+    return ERROR;
+  }
+
+  int npg = UP_TO_PAGE(size) >> PAGESHIFT;
+  if( npg >= R1_PAGE_TABLE_SIZE ) {
+    WARN_USER("HandleShmCreate(): segment of %d bytes does not fit in Region 1.\n", size);
+    return ERROR;
+  }
+
+  shm_t* shm  = (shm_t*)malloc(sizeof(shm_t));
+  assert(shm);
+  shm->frames = (int*)malloc(sizeof(int) * npg);
+  assert(shm->frames);
+
+  // Gather the frames. Give back what we got on failure.
+  { int i;
+    for(i = 0; i < npg; i++) {
+      shm->frames[i] = FindFreeFrame(PROT_READ | PROT_WRITE);
+      if( ERROR == shm->frames[i] ) {
+	TracePrintf(TRACE_CRITICAL, "HandleShmCreate(): insufficient memory for %d pages.\n", npg);
+	int j;
+	for(j = 0; j < i; j++) {
+	  FreeFrame(shm->frames[j]);
+	}
+	free(shm->frames);
+	free(shm);
+	return ERROR;
+      }
+      SetFrameOwner(shm->frames[i], RUNNING.head->pid, (void*) (i * PAGESIZE), FRAME_SHARED);
+    }
+  }
+
+  shm->owner    = RUNNING.head;
+  shm->npg      = npg;
+  shm->attached = 0;
+  shm->zeroed   = 0;
+
+  interp_t* interp = (interp_t*)malloc(sizeof(interp_t));
+  assert(interp);
+  interp->type    = SHM;
+  interp->ptr.shm = shm;
+
+  int id = NEXT_IID;
+  RegisterInterp(id, interp);
+
+  KTRACE(TRACE_VERBOSE, "HandleShmCreate(): process #%d created segment #%d of %d pages.\n",
+	      RUNNING.head->pid, id, npg);
+  return id;
+}
+
+int HandleShmAttach(int id, void* addr) {
+  pcb_t* proc = RUNNING.head;
+
+  if( IsInvalidIID(id) || SHM != interp_array[id]->type ) {
+    WARN_USER("HandleShmAttach(): %d is not a shared memory segment.\n", id);
+    return ERROR;
+  }
+
+  if( proc->shm_id != 0 ) {
+    WARN_USER("HandleShmAttach(): process #%d already has segment #%d attached.\n", proc->pid, proc->shm_id);
+    return ERROR;
+  }
+
+  if( addr < (void*) VMEM_1_BASE || addr >= (void*) VMEM_1_LIMIT || (long) addr != DOWN_TO_PAGE(addr) ) {
+    WARN_USER("HandleShmAttach(): %p is not a page in Region 1.\n", addr);
+    return ERROR;
+  }
+
+  shm_t* shm  = interp_array[id]->ptr.shm;
+  int    base = r1_addr_to_id(addr);
+
+  // Leave one unmapped page between heap and segment, and between segment and stack.
+  if( base <= proc->r1_break_limit_index + 1 || base + shm->npg >= proc->r1_stack_base_index - 1 ) {
+    WARN_USER("HandleShmAttach(): pages %d..%d are not between heap (%d) and stack (%d).\n",
+	      base, base + shm->npg - 1, proc->r1_break_limit_index, proc->r1_stack_base_index);
+    return ERROR;
+  }
+  { int i;
+    for(i = base; i < base + shm->npg; i++) {
+      if( proc->r1_page_table[i].valid ) {
+	WARN_USER("HandleShmAttach(): page %d is already in use.\n", i);
+	return ERROR;
+      }
+    }
+  }
+  // At this point, the call is legitimate.
+
+  { int i;
+    for(i = 0; i < shm->npg; i++) {
+      ShareFrame(shm->frames[i]);
+      proc->r1_page_table[base + i].valid = 1;
+      proc->r1_page_table[base + i].prot  = PROT_READ | PROT_WRITE;
+      proc->r1_page_table[base + i].pfn   = shm->frames[i];
+    }
+  }
+  proc->shm_id            = id;
+  proc->r1_shm_base_index = base;
+  shm->attached++;
+  FlushTLB(TLB_FLUSH_1);
+
+  // Frames are only reachable through a mapping, so the first attacher clears them.
+  if( !shm->zeroed ) {
+    memset(addr, 0, shm->npg * PAGESIZE);
+    shm->zeroed = 1;
+  }
+
+  KTRACE(TRACE_VERBOSE, "HandleShmAttach(): process #%d attached segment #%d at page %d.\n",
+	      proc->pid, id, base);
+  return SUCCESS;
+}
+
+int HandleShmDetach(void) {
+  if( RUNNING.head->shm_id == 0 ) {
+    WARN_USER("HandleShmDetach(): process #%d has no segment attached.\n", RUNNING.head->pid);
+    return ERROR;
+  }
+
+  ShmDetachProcess(RUNNING.head);
+  FlushTLB(TLB_FLUSH_1);
+  return SUCCESS;
+}
+
 int HandleReclaim(int id) {
   if( IsInvalidIID(id) ) {
     return ERROR;
@@ -798,6 +1776,11 @@ int HandleReclaim(int id) {
 	RemoveFromQueue(proc, &pipe->QUEUE);
 	AddToQueue(proc, &READY);
       }
+      // Pollers find the pipe gone and return ERROR.
+      WakePollers(pipe->pollers);
+      while( NULL != pipe->pollers ) {
+	PollerRemove(&pipe->pollers, pipe->pollers->proc);
+      }
       if( NULL != pipe->buffer ) {
 	free(pipe->buffer);
       }
@@ -806,10 +1789,58 @@ int HandleReclaim(int id) {
       interp_array[id] = NULL;
     }
     return SUCCESS;
+  case RWLOCK:
+    {
+      rwlock_t* rwlock = interp_array[id]->ptr.rwlock;
+      if( rwlock->owner->pid != RUNNING.head->pid ) {
+	return ERROR;
+      }
+      while( NULL != rwlock->READERS.head ) {
+	pcb_t* proc = rwlock->READERS.head;
+	RemoveFromQueue(proc, &rwlock->READERS);
+	AddToQueue(proc, &READY);
+      }
+      while( NULL != rwlock->WRITERS.head ) {
+	pcb_t* proc = rwlock->WRITERS.head;
+	RemoveFromQueue(proc, &rwlock->WRITERS);
+	AddToQueue(proc, &READY);
+      }
+      while( NULL != rwlock->readers ) {
+	holder_t* h = rwlock->readers;
+	rwlock->readers = h->next;
+	free(h);
+      }
+      free(rwlock);
+      free(interp_array[id]);
+      interp_array[id] = NULL;
+    }
+    return SUCCESS;
+  case SHM:
+    {
+      shm_t* shm = interp_array[id]->ptr.shm;
+      if( shm->owner->pid != RUNNING.head->pid ) {
+	return ERROR;
+      }
+      // Attached segments go away with their last attacher.
+      if( shm->attached > 0 ) {
+	return ERROR;
+      }
+      { int i;
+	for(i = 0; i < shm->npg; i++) {
+	  FreeFrame(shm->frames[i]);
+	}
+      }
+      free(shm->frames);
+      free(shm);
+      free(interp_array[id]);
+      interp_array[id] = NULL;
+    }
+    return SUCCESS;
   default:
     TracePrintf(TRACE_WRONG, "HandleReclaim(): unidentified interp variable type %d.\n", interp_array[id]->type);
     Halt();
   }
+  return ERROR;
 }
 
 // End fof SystemCalls.c
@@ -0,0 +1,70 @@
+// Timeline.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Scheduler timeline: how long every queue was, tick by tick.
+//
+// At each TRAP_CLOCK, the kernel records one timeline_sample_t into a ring of the last
+// TIMELINE_RING_SIZE ticks, with TimelineSample(): the running process, and the size
+// of each queue in TIMELINE_LIST below. Interps are summed by type, since there can
+// be any number of them; the longest single interp queue, and its id, are recorded
+// too. The ring is written to the Linux file TIMELINE_FILE when the kernel halts, and
+// whenever a process calls DumpTimeline(). The file is a timeline_header_t followed by
+// its samples, oldest first.
+//
+// tools/TimelineDecode turns the file into CSV, one row per tick, for a spreadsheet or
+// a plotting script; or prints the peak of each column.
+//
+// This header is shared by the kernel and tools/; samples are 16-bit, so the layout is
+// the same for the -m32 kernel and a 64-bit host.
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#define TIMELINE_FILE      "TIMELINE"
+#define TIMELINE_MAGIC     0x59544c4e // "YTLN"
+#define TIMELINE_RING_SIZE 1024       // Must be a power of 2.
+
+// X(id, name): column TL_id is headed name. READY counts the idle process when it is
+// waiting to run.
+#define TIMELINE_LIST				\
+  X(READY,       "ready")			\
+  X(SLEEPING,    "sleeping")			\
+  X(WAITING,     "waiting")			\
+  X(POLLING,     "polling")			\
+  X(READING_0,   "reading0")			\
+  X(READING_1,   "reading1")			\
+  X(READING_2,   "reading2")			\
+  X(READING_3,   "reading3")			\
+  X(WRITING_0,   "writing0")			\
+  X(WRITING_1,   "writing1")			\
+  X(WRITING_2,   "writing2")			\
+  X(WRITING_3,   "writing3")			\
+  X(LOCKS,       "locks")			\
+  X(CVARS,       "cvars")			\
+  X(PIPES,       "pipes")			\
+  X(RWLOCKS,     "rwlocks")			\
+  X(BUF_WAITING, "buf_waiting")			\
+  X(FS_WAITING,  "fs_waiting")			\
+  X(INTERP_MAX,  "interp_max")			\
+  X(INTERP_ID,   "interp_max_id")
+
+#define X(id, name) TL_##id,
+enum { TIMELINE_LIST TIMELINE_COLUMNS };
+#undef X
+
+typedef struct {
+  int   tick;
+  short pid;                       // Running process (-1 if none).
+  short sizes[TIMELINE_COLUMNS];   // Indexed by TL_*.
+} timeline_sample_t;
+
+typedef struct {
+  int magic;   // TIMELINE_MAGIC.
+  int count;   // Samples that follow.
+  int dropped; // Older samples overwritten in the ring before the dump.
+  int columns; // TIMELINE_COLUMNS, as the kernel was built.
+} timeline_header_t;
+
+#endif
+// End of Timeline.h
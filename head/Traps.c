@@ -11,6 +11,7 @@
 
 // Helper method for TRAP_KERNEL:YALNIX_EXIT.
 int ParentIsWAITING(pcb_t* parent, pcb_t* current) {
+  WORK(NODES_WALKED, 1);
   if( current == WAITING.head ) {
     return 0;
   }
@@ -33,10 +34,14 @@ void WakeUpWaitingParent(int ppid) {
       AddToQueue(parent, &READY);
     }
   }
+  // Parent may be in Poll() with POLL_CHILD.
+  if( parent != NULL ) {
+    WakePoller(parent);
+  }
 }
 
-void HandleTrapKernel     (UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "TRAP_KERNEL(0x%x)\n", u_context->code & 0xff);
+// Helper method for HandleTrapKernel().
+void HandleSystemCall(UserContext* u_context) {
   //TraceUserContext(TRACE_TRAP, u_context);
 
   switch( u_context->code ) {
@@ -86,7 +91,7 @@ void HandleTrapKernel     (UserContext* u_context) {
         return;
       }
       
-      TracePrintf(TRACE_VERBOSE, "HandleTrapKernel(): Exec() called with '%s'\n", progName);
+      KTRACE(TRACE_VERBOSE, "HandleTrapKernel(): Exec() called with '%s'\n", progName);
       
       char** ptr = (char**)u_context->regs[1];
       if (ptr != NULL){
@@ -96,13 +101,13 @@ void HandleTrapKernel     (UserContext* u_context) {
         }
         for(; *ptr != NULL; ptr++) {
             // check argument strings
-            TracePrintf(TRACE_VERBOSE, "HandleTrapKernel(): Exec checking argument pointer %p pointing to %p\n", ptr, *ptr);
+            KTRACE(TRACE_VERBOSE, "HandleTrapKernel(): Exec checking argument pointer %p pointing to %p\n", ptr, *ptr);
             if (!CheckUserString(*ptr, PROT_READ, MAX_PROGRAM_NAME_LENGTH)){
                 TracePrintf(TRACE_USER_ERROR, "UserProgram passed invalid pointer as Exec argument\n");
                 KillRunningProcess();
                 return;
             }
-            TracePrintf(TRACE_VERBOSE, "  - Arg '%s'\n", *ptr);
+            KTRACE(TRACE_VERBOSE, "  - Arg '%s'\n", *ptr);
         }
       }
       int rv = HandleExec((char*) u_context->regs[0], (char**) u_context->regs[1]);
@@ -124,9 +129,15 @@ void HandleTrapKernel     (UserContext* u_context) {
     }
 
   case YALNIX_EXIT:
-    // TracePrintf(TRACE_VERBOSE, "===============================================\n");
-    TracePrintf(TRACE_VERBOSE, "HandleTrapKernel(): Exit(%d) called for process #%d.\n",
+    // KTRACE(TRACE_VERBOSE, "===============================================\n");
+    KTRACE(TRACE_VERBOSE, "HandleTrapKernel(): Exit(%d) called for process #%d.\n",
 	    (int) u_context->regs[0], RUNNING.head->pid);
+    // The OS halts when the initial process exits; let the disk and the terminals
+    // finish first.
+    if( RUNNING.head->pid == 1 ) {
+      CacheSync();
+      TtyDrain();
+    }
     KillProcess(RUNNING.head, &RUNNING, u_context->regs[0]);
     return;
 
@@ -138,7 +149,7 @@ void HandleTrapKernel     (UserContext* u_context) {
       int   tty_id = (int)   u_context->regs[0];
       void* buffer = (void*) u_context->regs[1];
       int   length = (int)   u_context->regs[2];
-      u_context->regs[0] = HandleTtyRead(tty_id, buffer, length);
+      u_context->regs[0] = HandleTtyRead(tty_id, buffer, length, 0);
     }
     return;
   case YALNIX_TTY_WRITE:
@@ -147,15 +158,11 @@ void HandleTrapKernel     (UserContext* u_context) {
       int   tty_id = (int)   u_context->regs[0];
       void* buffer = (void*) u_context->regs[1];
       int   length = (int)   u_context->regs[2];
-      here();
-      if( HandleTtyWrite(tty_id, buffer, length) == ERROR ) {
+      if( HandleTtyWrite(tty_id, buffer, length, 0) == ERROR ) {
         u_context->regs[0] = ERROR;
       } else {
         u_context->regs[0] = length;
       }
-      here();
-      PrintAllQueues();
-      here();
     }
     return;
   case YALNIX_SEM_INIT:
@@ -177,7 +184,7 @@ void HandleTrapKernel     (UserContext* u_context) {
     u_context->regs[0] = HandleLockInit((int*) u_context->regs[0]);
     return;
   case YALNIX_LOCK_ACQUIRE:
-    u_context->regs[0] = HandleAcquire((int) u_context->regs[0]);
+    u_context->regs[0] = HandleAcquire((int) u_context->regs[0], NO_TIMEOUT);
     return;
   case YALNIX_LOCK_RELEASE:
     u_context->regs[0] = HandleRelease((int) u_context->regs[0]);
@@ -186,7 +193,7 @@ void HandleTrapKernel     (UserContext* u_context) {
     u_context->regs[0] = HandleCvarInit((int*) u_context->regs[0]);
     return;
   case YALNIX_CVAR_WAIT:
-    u_context->regs[0] = HandleCvarWait((int) u_context->regs[0], (int) u_context->regs[1]);
+    u_context->regs[0] = HandleCvarWait((int) u_context->regs[0], (int) u_context->regs[1], NO_TIMEOUT);
     return;
   case YALNIX_CVAR_SIGNAL:
     u_context->regs[0] = HandleCvarSignal((int) u_context->regs[0]);
@@ -200,16 +207,27 @@ void HandleTrapKernel     (UserContext* u_context) {
   case YALNIX_PIPE_READ:
     u_context->regs[0] = HandlePipeRead((int)   u_context->regs[0] /* id */    ,
 					(void*) u_context->regs[1] /* buffer */,
-					(int)   u_context->regs[2] /* length */);
+					(int)   u_context->regs[2] /* length */,
+					NO_TIMEOUT, 0);
     return;
   case YALNIX_PIPE_WRITE:
     u_context->regs[0] = HandlePipeWrite((int)   u_context->regs[0] /* id */    ,
 					 (void*) u_context->regs[1] /* buffer */,
-					 (int)   u_context->regs[2] /* length */);
+					 (int)   u_context->regs[2] /* length */,
+					 0);
     return;
   case YALNIX_RECLAIM:
     u_context->regs[0] = HandleReclaim((int) u_context->regs[0]);
     return;
+  case YALNIX_READ_SECTOR:
+    u_context->regs[0] = HandleReadSector ((int) u_context->regs[0], (void*) u_context->regs[1]);
+    return;
+  case YALNIX_WRITE_SECTOR:
+    u_context->regs[0] = HandleWriteSector((int) u_context->regs[0], (void*) u_context->regs[1]);
+    return;
+  case YALNIX_CUSTOM_0:
+    HandleTrapCustom(u_context);
+    return;
   case YALNIX_NOP:
     TracePrintf(TRACE_UNIMPLEMENTED_CRITICAL, "HandleTrapKernel(): NOP.\n");
     TraceUserContext(TRACE_UNIMPLEMENTED_CRITICAL, u_context);
@@ -222,6 +240,229 @@ void HandleTrapKernel     (UserContext* u_context) {
   }
 }
 
+void HandleTrapKernel(UserContext* u_context) {
+  KTRACE(TRACE_TRAP, "TRAP_KERNEL(0x%x)\n", u_context->code & 0xff);
+
+  // u_context is the process's again by the time the call returns, even if it blocked.
+  int code   = u_context->code;
+  int custom = code == YALNIX_CUSTOM_0 ? (u_context->regs[0] & CUSTOM_CODE_MASK) : 0;
+  EVENT(EV_SYSCALL, code, custom, 0);
+  COUNT(SYSCALLS);
+  syscall_counts[code & YALNIX_MASK]++;
+  if( code == YALNIX_CUSTOM_0 && custom < CUSTOM_CODES ) {
+    custom_counts[custom]++;
+  }
+
+  // What the caller has had done so far; see HistRecord() below.
+  int pid   = RUNNING.head->pid;
+  int start = ticks;
+  int work[NUM_WORK];
+  memcpy(work, RUNNING.head->work, sizeof(work));
+
+  HandleSystemCall(u_context);
+  EVENT(EV_SYSCALL_DONE, code, custom, u_context->regs[0]);
+
+  // A Fork() child returns here too, but with its parent's start; it does not count.
+  if( RUNNING.head != NULL && RUNNING.head->pid == pid ) {
+    int i;
+    for(i = 0; i < NUM_WORK; i++) {
+      work[i] = RUNNING.head->work[i] - work[i];
+    }
+    HistRecord(code == YALNIX_CUSTOM_0 ? HIST_CUSTOM_BASE + custom : (code & YALNIX_MASK),
+	       ticks - start, work);
+  }
+}
+
+void HandleTrapCustom(UserContext* u_context) {
+  KTRACE(TRACE_TRAP, "TRAP_KERNEL(Custom0: 0x%x)\n", u_context->regs[0]);
+
+  int code  = u_context->regs[0] & CUSTOM_CODE_MASK;
+  int flags = u_context->regs[0] & CUSTOM_FLAG_MASK;
+
+  // Only I/O calls take flags.
+  if( flags != 0 ) {
+    if( (code != CUSTOM_TTY_READ  && code != CUSTOM_TTY_WRITE &&
+	 code != CUSTOM_PIPE_READ && code != CUSTOM_PIPE_WRITE) ||
+	(flags & ~(IO_NONBLOCK | IO_VECTOR)) != 0 ) {
+      TracePrintf(TRACE_USER_WARNING, "HandleTrapCustom(): invalid flags 0x%x.\n", flags);
+      u_context->regs[0] = ERROR;
+      return;
+    }
+  }
+
+  switch( code ) {
+  case CUSTOM_SHM_CREATE:
+    u_context->regs[0] = HandleShmCreate((int) u_context->regs[1]);
+    return;
+  case CUSTOM_SHM_ATTACH:
+    u_context->regs[0] = HandleShmAttach((int)   u_context->regs[1] /* id */  ,
+					 (void*) u_context->regs[2] /* addr */);
+    return;
+  case CUSTOM_SHM_DETACH:
+    u_context->regs[0] = HandleShmDetach();
+    return;
+  case CUSTOM_RWLOCK_INIT:
+    u_context->regs[0] = HandleRWLockInit((int*) u_context->regs[1]);
+    return;
+  case CUSTOM_RWLOCK_READ:
+    u_context->regs[0] = HandleAcquireRead((int) u_context->regs[1]);
+    return;
+  case CUSTOM_RWLOCK_WRITE:
+    u_context->regs[0] = HandleAcquireWrite((int) u_context->regs[1]);
+    return;
+  case CUSTOM_RWLOCK_RELEASE:
+    u_context->regs[0] = HandleReleaseRW((int) u_context->regs[1]);
+    return;
+  case CUSTOM_ACQUIRE_TIMED:
+    if( (int) u_context->regs[2] < 0 ) {
+      u_context->regs[0] = ERROR;
+      return;
+    }
+    u_context->regs[0] = HandleAcquire((int) u_context->regs[1] /* id */     ,
+				       (int) u_context->regs[2] /* timeout */);
+    return;
+  case CUSTOM_CVAR_WAIT_TIMED:
+    if( (int) u_context->regs[3] < 0 ) {
+      u_context->regs[0] = ERROR;
+      return;
+    }
+    u_context->regs[0] = HandleCvarWait((int) u_context->regs[1] /* id */     ,
+					(int) u_context->regs[2] /* lock_id */,
+					(int) u_context->regs[3] /* timeout */);
+    return;
+  case CUSTOM_PIPE_READ_TIMED: {
+    // Arguments are { id, buffer, length, timeout }.
+    int* args = (int*) u_context->regs[1];
+    if( !CheckUserBuffer(args, 4 * sizeof(int), PROT_READ) || args[3] < 0 ) {
+      u_context->regs[0] = ERROR;
+      return;
+    }
+    u_context->regs[0] = HandlePipeRead(args[0], (void*) args[1], args[2], args[3], 0);
+    return;
+  }
+  case CUSTOM_POLL: {
+    // Arguments are { ids, events, n, timeout }.
+    int* args = (int*) u_context->regs[1];
+    if( !CheckUserBuffer(args, 4 * sizeof(int), PROT_READ) || args[3] < POLL_FOREVER ) {
+      u_context->regs[0] = ERROR;
+      return;
+    }
+    u_context->regs[0] = HandlePoll((int*) args[0], (int*) args[1], args[2], args[3]);
+    return;
+  }
+  case CUSTOM_TTY_READ:
+    u_context->regs[0] = HandleTtyRead((int)   u_context->regs[1] /* tty */   ,
+				       (void*) u_context->regs[2] /* buffer */,
+				       (int)   u_context->regs[3] /* length */, flags);
+    return;
+  case CUSTOM_TTY_WRITE:
+    u_context->regs[0] = HandleTtyWrite((int)   u_context->regs[1] /* tty */   ,
+					(void*) u_context->regs[2] /* buffer */,
+					(int)   u_context->regs[3] /* length */, flags);
+    return;
+  case CUSTOM_GET_TICKS:
+    u_context->regs[0] = ticks;
+    return;
+  case CUSTOM_SET_TRACE_LEVEL:
+    {
+      int level = (int) u_context->regs[1] /* level */;
+      u_context->regs[0] = trace_level;
+      trace_level = level < 0 ? 0 : level > KTRACE_MAX ? KTRACE_MAX : level;
+    }
+    return;
+  case CUSTOM_GET_COUNTERS:
+    u_context->regs[0] = HandleGetCounters((counters_t*) u_context->regs[1] /* counters */);
+    return;
+  case CUSTOM_PROFILE:
+    u_context->regs[0] = ProfileOn(RUNNING.head, u_context->regs[1] != 0 /* on */);
+    return;
+  case CUSTOM_SYSCALL_HIST:
+    u_context->regs[0] = HandleSyscallHist((int)             u_context->regs[1] /* call */,
+					   (syscall_hist_t*) u_context->regs[2] /* hist */);
+    return;
+  case CUSTOM_DUMP_EVENTS:
+    u_context->regs[0] = EventDump();
+    return;
+  case CUSTOM_DUMP_TIMELINE:
+    u_context->regs[0] = TimelineDump();
+    return;
+  case CUSTOM_SYNC:
+    u_context->regs[0] = HandleSync();
+    return;
+  case CUSTOM_CACHE_STATS:
+    u_context->regs[0] = HandleCacheStats((cache_stats_t*) u_context->regs[1] /* stats */);
+    return;
+  case CUSTOM_OPEN:
+    u_context->regs[0] = HandleOpen((char*) u_context->regs[1] /* path */);
+    return;
+  case CUSTOM_CLOSE:
+    u_context->regs[0] = HandleClose((int) u_context->regs[1] /* fd */);
+    return;
+  case CUSTOM_CREATE:
+    u_context->regs[0] = HandleCreate((char*) u_context->regs[1] /* path */, INODE_REGULAR);
+    return;
+  case CUSTOM_MKDIR:
+    u_context->regs[0] = HandleCreate((char*) u_context->regs[1] /* path */, INODE_DIRECTORY);
+    return;
+  case CUSTOM_READ:
+    u_context->regs[0] = HandleRead((int)   u_context->regs[1] /* fd */    ,
+				    (void*) u_context->regs[2] /* buffer */,
+				    (int)   u_context->regs[3] /* length */);
+    return;
+  case CUSTOM_WRITE:
+    u_context->regs[0] = HandleWrite((int)   u_context->regs[1] /* fd */    ,
+				     (void*) u_context->regs[2] /* buffer */,
+				     (int)   u_context->regs[3] /* length */);
+    return;
+  case CUSTOM_SEEK:
+    u_context->regs[0] = HandleSeek((int) u_context->regs[1] /* fd */    ,
+				    (int) u_context->regs[2] /* offset */,
+				    (int) u_context->regs[3] /* whence */);
+    return;
+  case CUSTOM_UNLINK:
+    u_context->regs[0] = HandleUnlink((char*) u_context->regs[1] /* path */);
+    return;
+  case CUSTOM_INSTALL:
+    u_context->regs[0] = HandleInstall((char*) u_context->regs[1] /* linux_name */,
+				       (char*) u_context->regs[2] /* path */);
+    return;
+  case CUSTOM_SPAWN:
+    u_context->regs[0] = HandleSpawn((char*)  u_context->regs[1] /* name */,
+				     (char**) u_context->regs[2] /* argv */, u_context);
+    return;
+  case CUSTOM_FRAME_STATS:
+    u_context->regs[0] = HandleFrameStats((frame_stats_t*) u_context->regs[1] /* stats */);
+    return;
+  case CUSTOM_FRAME_MAP:
+    u_context->regs[0] = HandleFrameMap((frame_map_t*) u_context->regs[1] /* map */,
+					(int)          u_context->regs[2] /* first */,
+					(int)          u_context->regs[3] /* count */);
+    return;
+  case CUSTOM_READDIR:
+    u_context->regs[0] = HandleReadDir((int)               u_context->regs[1] /* fd */,
+				       (struct dir_entry*) u_context->regs[2] /* entry */);
+    return;
+  case CUSTOM_TTY_STATS:
+    u_context->regs[0] = HandleTtyStats((int)          u_context->regs[1] /* tty */,
+					(tty_stats_t*) u_context->regs[2] /* stats */);
+    return;
+  case CUSTOM_PIPE_READ:
+    u_context->regs[0] = HandlePipeRead((int)   u_context->regs[1] /* id */    ,
+					(void*) u_context->regs[2] /* buffer */,
+					(int)   u_context->regs[3] /* length */, NO_TIMEOUT, flags);
+    return;
+  case CUSTOM_PIPE_WRITE:
+    u_context->regs[0] = HandlePipeWrite((int)   u_context->regs[1] /* id */    ,
+					 (void*) u_context->regs[2] /* buffer */,
+					 (int)   u_context->regs[3] /* length */, flags);
+    return;
+  default:
+    TracePrintf(TRACE_USER_WARNING, "HandleTrapCustom(): invalid custom call 0x%x.\n", u_context->regs[0]);
+    u_context->regs[0] = ERROR;
+    return;
+  }
+}
+
 // Helper method for HandleTrapClock().
 void RemoveFinishedDelays(pcb_t* head, pcb_t* current) {
   if( head == current ) { // Reached end of list.
@@ -232,7 +473,7 @@ void RemoveFinishedDelays(pcb_t* head, pcb_t* current) {
 
     RemoveFromQueue(current, &SLEEPING);
     AddToQueue(current, &READY);
-    TracePrintf(TRACE_VERBOSE, "HandleTrapClock(): waking up process #%d.\n", current->pid);
+    KTRACE(TRACE_VERBOSE, "HandleTrapClock(): waking up process #%d.\n", current->pid);
 
     RemoveFinishedDelays(head, next);
   } else {
@@ -241,7 +482,11 @@ void RemoveFinishedDelays(pcb_t* head, pcb_t* current) {
 }
 
 void HandleTrapClock(UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "\n\nTRAP_CLOCK(%d)\n", ticks);
+  KTRACE(TRACE_TRAP, "\n\nTRAP_CLOCK(%d)\n", ticks);
+  COUNT(CLOCK_TRAPS);
+  if( RUNNING.head != NULL ) {
+    ProfileSample(RUNNING.head, u_context->pc);
+  }
   // TraceUserContext(TRACE_TRAP, u_context);
 
   pcb_t* head = SLEEPING.head;
@@ -250,11 +495,20 @@ void HandleTrapClock(UserContext* u_context) {
     if( ticks >= head->wakeup_time ) {
       RemoveFromQueue(head, &SLEEPING);
       AddToQueue(head, &READY);
-      TracePrintf(TRACE_VERBOSE, "HandleTrapClock(): waking up process #%d.\n", head->pid);
+      KTRACE(TRACE_VERBOSE, "HandleTrapClock(): waking up process #%d.\n", head->pid);
     }
   }
+
+  // Give up timed waits (AcquireTimed() etc.) that ran out of time.
+  ExpireTimeouts();
+
+  // Write back dirty buffers now and then, so that they do not wait for eviction.
+  if( ticks % CACHE_WRITEBACK_TICKS == 0 ) {
+    CacheWriteBack();
+  }
   
   ticks++;
+  TimelineSample();
 
   // Round-robin scheduling.
 
@@ -271,7 +525,7 @@ void HandleTrapClock(UserContext* u_context) {
   }
   // (2) If idle is still the first, then don't call ContextSwitch().
   if( READY.head != NULL && READY.head->pid == 2 ) {
-    TracePrintf(TRACE_VERBOSE, "HandleTrapClock(): I will skip a turn for idle.\n");
+    KTRACE(TRACE_VERBOSE, "HandleTrapClock(): I will skip a turn for idle.\n");
     return;
   }
   // JHL. End.
@@ -291,15 +545,17 @@ void HandleTrapClock(UserContext* u_context) {
 }
 
 void HandleTrapIllegal    (UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "TRAP_ILLEGAL\n");
+  KTRACE(TRACE_TRAP, "TRAP_ILLEGAL\n");
   TraceUserContext(TRACE_CRITICAL, u_context);
   KillRunningProcess();
 }
 
 void HandleTrapMemory(UserContext* u_context) {
   int pte_index = r1_addr_to_id(u_context->addr);
+  EVENT(EV_FAULT, u_context->addr, u_context->code, 0);
+  COUNT(MEMORY_TRAPS);
   {
-    TracePrintf(TRACE_VERBOSE, "TRAP_MEMORY:\n"
+    KTRACE(TRACE_VERBOSE, "TRAP_MEMORY:\n"
 		TRACE_N "  Code      : %d (%d=MAPERR, %d=ACCERR)\n"
 		TRACE_N "  Address   : index %d\t(%p) (valid? %d)\n"
 		TRACE_N "  Stack Base: index %d\t(%p)\n"
@@ -313,7 +569,7 @@ void HandleTrapMemory(UserContext* u_context) {
   }
 
   /*
-  TracePrintf(TRACE_TRAP, 
+  KTRACE(TRACE_TRAP, 
               "TRAP_MEMORY(type %d at %p) cur-stack:%d, req-stack:%d, heap:%d\n",          
               u_context->code,  
               u_context->addr, 
@@ -327,6 +583,7 @@ void HandleTrapMemory(UserContext* u_context) {
     if( u_context->addr == NULL ) {
       TracePrintf(TRACE_SEVERE, "HandleTrapMemory(): process #%d commits NULL pointer exception.\n",
 		  RUNNING.head->pid);
+      COUNT(MEMORY_KILLS);
       KillRunningProcess();
       return;
     }
@@ -344,6 +601,24 @@ void HandleTrapMemory(UserContext* u_context) {
       Halt();
     }
     
+    // detect if trying to grow stack into shared memory (which sits between heap and stack)
+    if( RUNNING.head->shm_id != 0 ) {
+      shm_t* shm = interp_array[RUNNING.head->shm_id]->ptr.shm;
+      if( pte_index - 1 /* leave 1 unmapped page */ < RUNNING.head->r1_shm_base_index + shm->npg ) {
+	TracePrintf(TRACE_SEVERE, "HandleTrapMemory(): process #%d attempting"
+		    " to grow stack into shared memory. cur-stack:%d, "
+		    "req-stack:%d, shm:%d..%d\n",
+		    RUNNING.head->pid,
+		    RUNNING.head->r1_stack_base_index,
+		    pte_index,
+		    RUNNING.head->r1_shm_base_index,
+		    RUNNING.head->r1_shm_base_index + shm->npg - 1);
+	COUNT(MEMORY_KILLS);
+	KillRunningProcess();
+	return;
+      }
+    }
+
     // detect if trying to grow stack into heap
     {
       int i = RUNNING.head->r1_stack_base_index - 1;
@@ -359,6 +634,7 @@ void HandleTrapMemory(UserContext* u_context) {
 		      RUNNING.head->r1_stack_base_index, 
 		      pte_index, 
 		      RUNNING.head->r1_break_limit_index);
+	  COUNT(MEMORY_KILLS);
 	  KillRunningProcess();
 	  return;
 	}
@@ -370,7 +646,7 @@ void HandleTrapMemory(UserContext* u_context) {
     {
       int i = RUNNING.head->r1_stack_base_index - 1;
       for(;i >= pte_index; i--){
-	TracePrintf(TRACE_VERBOSE, "HandleTrapMemory(): mapping page %d to stack\n", i);
+	KTRACE(TRACE_VERBOSE, "HandleTrapMemory(): mapping page %d to stack\n", i);
         
 	// if we can find a free frame, give it to stack
 	int frame_i = FindFreeFrame(PROT_READ | PROT_WRITE);
@@ -378,22 +654,26 @@ void HandleTrapMemory(UserContext* u_context) {
 	  RUNNING.head->r1_page_table[i].valid = 1;
 	  RUNNING.head->r1_page_table[i].prot = PROT_READ | PROT_WRITE;
 	  RUNNING.head->r1_page_table[i].pfn = frame_i;
+	  SetFrameOwner(frame_i, RUNNING.head->pid, r1_id_to_addr(i), FRAME_STACK);
 	}
 	// no frames available: kill process
 	else{
 	  TracePrintf(TRACE_SEVERE, "HandleTrapMemory(): no memory available to grow stack of process #%d\n", RUNNING.head->pid);
+	  COUNT(MEMORY_KILLS);
 	  KillRunningProcess();
 	  return;
 	}
       }
       RUNNING.head->r1_stack_base_index = pte_index;
     }
-    TracePrintf(TRACE_VERBOSE, "HandleTrapMemory(): grew stack for process #%d.\n", RUNNING.head->pid);
+    KTRACE(TRACE_VERBOSE, "HandleTrapMemory(): grew stack for process #%d.\n", RUNNING.head->pid);
+    COUNT(STACK_GROWTHS);
     return;
     
   case YALNIX_ACCERR: // Invalid permissions.
     TracePrintf(TRACE_SEVERE, "HandleTrapMemory(): fatal memory access error for process #%d.\n",
 		RUNNING.head->pid);
+    COUNT(MEMORY_KILLS);
     KillRunningProcess();
     return;
   default:
@@ -403,46 +683,60 @@ void HandleTrapMemory(UserContext* u_context) {
 }
 
 void HandleTrapMath       (UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "TRAP_MATH\n");
+  KTRACE(TRACE_TRAP, "TRAP_MATH\n");
   TraceUserContext(TRACE_CRITICAL, u_context);
   KillRunningProcess();
 }
 
 void HandleTrapTtyReceive (UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "TRAP_TTY_RECEIVE\n");
+  KTRACE(TRACE_TRAP, "TRAP_TTY_RECEIVE\n");
 
   int tty_id = u_context->code;
 
+  // Pull the line off the terminal now, whether or not someone is reading.
+  int length = TtyReceive(tty_id, tty_read_buffer[tty_id], TERMINAL_MAX_LINE);
+  EVENT(EV_TTY_RECEIVE, tty_id, length, 0);
+  COUNT(TTY_RECEIVE_TRAPS);
+  if( ERROR == TtyInputPut(tty_id, tty_read_buffer[tty_id], length) ) {
+    return;
+  }
+
+  // The first reader gets it; others keep waiting (HandleTtyRead() checks again).
   if( READING[tty_id].head != NULL ) {
-    ContextSwitch(READING[tty_id].head, &READING[tty_id], &READY);
+    pcb_t* reader = READING[tty_id].head;
+    RemoveFromQueue(reader, &READING[tty_id]);
+    AddToQueue(reader, &READY);
   } else {
-    TracePrintf(TRACE_COMMENT, "HandleTrapTtyReceive(): no process was reading tty #%d.\n", tty_id);
+    KTRACE(TRACE_COMMENT, "HandleTrapTtyReceive(): no process was reading tty #%d.\n", tty_id);
   }
+  WakePollers(tty_pollers[tty_id]);
 }
 
-// WRITING[tty_id].head is always the process which has been writing to the tty[tty_id].
+// The chunk in flight on tty_out[tty_id] has been sent. Send the next one right away;
+// no writing process is involved.
 void HandleTrapTtyTransmit(UserContext* u_context) {
-  TracePrintf(TRACE_TRAP, "TRAP_TTY_TRANSMIT\n");  
+  KTRACE(TRACE_TRAP, "TRAP_TTY_TRANSMIT\n");  
 
   // TraceUserContext(TRACE_TRAP, u_context);
 
   int tty_id = u_context->code;
-
-  // Clear buffer (not necessary).
-  // memset(tty_write_buffer[tty_id], '\0', TERMINAL_MAX_LINE);
-
-  //  here();
-  //  PrintAllQueues();
-  ContextSwitch(WRITING[tty_id].head, &WRITING[tty_id], &READY);
-  //  here();
-  //  PrintAllQueues();
-
-  // Make sure that, upon completing TtyTransmit() for one proess,
-  // another process writing to the same tty gets a chance to run.
-  if( WRITING_WAIT[tty_id].head != NULL ) {
-    TracePrintf(TRACE_VERBOSE, "HandleTtyTransmit(): process #%d was waiting to write to tty #%d.\n",
-		WRITING_WAIT[tty_id].head->pid, tty_id);
-    ContextSwitch(WRITING_WAIT[tty_id].head, &WRITING_WAIT[tty_id], &READY);
+  tty_output_t* out = &tty_out[tty_id];
+  EVENT(EV_TTY_TRANSMIT, tty_id, out->in_flight, 0);
+  COUNT(TTY_TRANSMIT_TRAPS);
+
+  out->count      -= out->in_flight;
+  out->bytes_sent += out->in_flight;
+  out->transmits++;
+  KTRACE(TRACE_VERBOSE, "HandleTrapTtyTransmit(): tty #%d sent %d bytes (%d bytes per transmit so far).\n",
+	      tty_id, out->in_flight, out->bytes_sent / out->transmits);
+  out->in_flight   = 0;
+  TtyStartTransmit(tty_id);
+
+  // Those waiting for room (or for the ring to empty) check again.
+  while( WRITING[tty_id].head != NULL ) {
+    pcb_t* proc = WRITING[tty_id].head;
+    RemoveFromQueue(proc, &WRITING[tty_id]);
+    AddToQueue(proc, &READY);
   }
 }
 
@@ -10,6 +10,10 @@
 #include "include/hardware.h"
 #include "KernelGlobals.h"
 #include "Utility.h"
+#include "ContextSwitch.h"
+#include "Disk.h"
+#include "Cache.h"
+#include "Fs.h"
 
 // -------- -------- -------- -------- -------- -------- -------- --------
 // Trap handlers.
@@ -22,6 +26,12 @@ void HandleTrapTtyReceive (UserContext*);
 void HandleTrapTtyTransmit(UserContext*);
 void HandleTrapUndefined  (UserContext*);
 
+// Custom system calls (CustomCalls.h), i.e., TRAP_KERNEL with YALNIX_CUSTOM_0.
+void HandleTrapCustom     (UserContext*);
+
+// Wakes process ppid if it waits for a child, in Wait() or in Poll() with POLL_CHILD.
+void WakeUpWaitingParent(int ppid);
+
 // -------- -------- -------- -------- -------- -------- -------- --------
 // System call handlers.
 
@@ -38,6 +48,22 @@ pcb_t* HandleFork(void);
 // By convention argv[0] is equal to filename, but this is not required.
 int HandleExec(char* filename, char** argv);
 
+// Spawn() (CustomCalls.h).
+//
+// Creates a child which loads filename with argv into a new address space; the
+// caller's Region 1 is not copied. Returns the child's pid to the caller once the
+// child has loaded, or ERROR. In the child, loads its u_context into u_context and
+// returns 0.
+int HandleSpawn(char* filename, char** argv, UserContext* u_context);
+int HandleFrameStats(frame_stats_t* stats);
+
+// FrameMap() (CustomCalls.h). Returns the number of entries copied, or ERROR.
+int HandleFrameMap(frame_map_t* map, int first, int count);
+
+// GetCounters(), SyscallHist().
+int HandleGetCounters(counters_t* counters);
+int HandleSyscallHist(int call, syscall_hist_t* hist);
+
 // Delay().
 //
 // Sleeps for ticks number of TRAP_CLOCK interrupts (ticks).
@@ -52,26 +78,59 @@ int HandleBrk(void* addr);
 // Wait().
 int HandleWait(int* status);
 
-// TtyWrite().
-int HandleTtyWrite(int tty_id, void* buffer, int length);
+// TtyWrite() and TtyRead(). flags are IO_* in CustomCalls.h.
+int HandleTtyWrite(int tty_id, void* buffer, int length, int flags);
+int HandleTtyRead (int tty_id, void* buffer, int length, int flags);
+int HandleTtyStats(int tty_id, tty_stats_t* stats);
+
+// ReadSector() and WriteSector().
+int HandleReadSector (int sector, void* buffer);
+int HandleWriteSector(int sector, void* buffer);
+int HandleSync(void);
+int HandleCacheStats(cache_stats_t* stats);
+
+// File system.
+int HandleOpen   (char* path);
+int HandleClose  (int fd);
+int HandleCreate (char* path, int type); // INODE_REGULAR (Create()) or INODE_DIRECTORY (MkDir()).
+int HandleRead   (int fd, void* buffer, int length);
+int HandleWrite  (int fd, void* buffer, int length);
+int HandleSeek   (int fd, int offset, int whence);
+int HandleUnlink (char* path);
+int HandleReadDir(int fd, struct dir_entry* entry);
+int HandleInstall(char* linux_name, char* path);
 
 // Locks.
 int HandleLockInit(int* id_ptr);
-int HandleAcquire (int id);
+int HandleAcquire (int id, int timeout); // timeout in ticks, or NO_TIMEOUT.
 int HandleRelease (int id);
 
 // Cvars.
 int HandleCvarInit     (int* id_ptr);
 int HandleCvarSignal   (int id);
 int HandleCvarBroadcast(int id);
-int HandleCvarWait     (int id, int lock_id);
+int HandleCvarWait     (int id, int lock_id, int timeout);
+
+// Reader-writer locks.
+int HandleRWLockInit  (int* id_ptr);
+int HandleAcquireRead (int id);
+int HandleAcquireWrite(int id);
+int HandleReleaseRW   (int id);
 
 // Pipes.
 int HandlePipeInit (int *id_ptr);
-int HandlePipeRead (int id, void* buffer, int length);
-int HandlePipeWrite(int id, void* buffer, int length);
+int HandlePipeRead (int id, void* buffer, int length, int timeout, int flags);
+int HandlePoll     (int* ids, int* events, int n, int timeout);
+int HandlePipeWrite(int id, void* buffer, int length, int flags);
 
 int HandleReclaim(int id);
 
+// Shared memory.
+//
+// HandleShmCreate() returns the new segment's id, or ERROR.
+int HandleShmCreate(int size);
+int HandleShmAttach(int id, void* addr);
+int HandleShmDetach(void);
+
 #endif
 // End of Traps.h
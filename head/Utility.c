@@ -5,6 +5,11 @@
 // Utility functions.
 
 #include "Utility.h"
+#include "Fs.h"
+#include "Traps.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // simple check to ensure that a permission field contains desired permissions
 inline int CheckProtection(int to_check, int desired_protection){
@@ -18,7 +23,7 @@ int CheckUserString(char* string, int desired_protection, int max_bytes){
     int bytes_so_far = 0;
     while(max_bytes == -1 || bytes_so_far < max_bytes){
         if (!CheckUserPointer(stringLoc, desired_protection)){
-            TracePrintf(TRACE_VERBOSE, "Invalid UserString %d bytes into string at %p, which started at %p\n", bytes_so_far, stringLoc, string);
+            KTRACE(TRACE_VERBOSE, "Invalid UserString %d bytes into string at %p, which started at %p\n", bytes_so_far, stringLoc, string);
             return 0;
         }
             
@@ -28,7 +33,7 @@ int CheckUserString(char* string, int desired_protection, int max_bytes){
         stringLoc++;
         bytes_so_far++;
     }
-    TracePrintf(TRACE_VERBOSE, "Invalid UserString at %d bytes into string at %p, which started at %p\n", bytes_so_far, stringLoc, string);
+    KTRACE(TRACE_VERBOSE, "Invalid UserString at %d bytes into string at %p, which started at %p\n", bytes_so_far, stringLoc, string);
     return 0;
 }
 int CheckUserBuffer(void* buffer, int len, int desired_protection){
@@ -72,6 +77,9 @@ int FindFreeFrame(int PROT_CODE) {
     if( frame_table[i].valid == 0 ) {
       frame_table[i].valid = 1;
       frame_table[i].prot  = PROT_CODE;
+      frame_table[i].refs  = 1;
+      SetFrameOwner(i, 0, frame_id_to_addr(i), FRAME_KERNEL_HEAP); // Until the caller says.
+      COUNT(FRAMES_ALLOCATED);
       return i;
     }
   }
@@ -87,17 +95,105 @@ int FreeFrame(int index){
     Halt();
   }
 
+  // Someone else (e.g., a shared memory segment) still uses this frame.
+  if( frame_table[index].refs > 1 ) {
+    frame_table[index].refs--;
+    return SUCCESS;
+  }
+
   frame_table[index].valid = 0;
   frame_table[index].prot  = PROT_NONE;
+  frame_table[index].refs  = 0;
+  SetFrameOwner(index, 0, 0, FRAME_FREE);
+  COUNT(FRAMES_FREED);
+  return SUCCESS;
+}
+
+void SetFrameOwner(int index, int pid, void* addr, int kind) {
+  frame_table[index].owner = pid;
+  frame_table[index].vpn   = ((unsigned int) addr) >> PAGESHIFT;
+  frame_table[index].kind  = kind;
+}
+
+int ShareFrame(int index) {
+  if (index >= FRAME_TABLE_SIZE || frame_table[index].valid == 0) {
+    TracePrintf(TRACE_WRONG, "ShareFrame(): no frame has index  %d.\n", index);
+    Halt();
+  }
+
+  frame_table[index].refs++;
   return SUCCESS;
 }
 
+int IsShmPage(pcb_t* pcb, int page) {
+  if( pcb->shm_id == 0 ) {
+    return 0;
+  }
+  shm_t* shm = interp_array[pcb->shm_id]->ptr.shm;
+  return pcb->r1_shm_base_index <= page && page < pcb->r1_shm_base_index + shm->npg;
+}
+
+void ShmDetachProcess(pcb_t* pcb) {
+  if( pcb->shm_id == 0 ) {
+    return;
+  }
+  int     id  = pcb->shm_id;
+  shm_t*  shm = interp_array[id]->ptr.shm;
+
+  // Unmap the segment from pcb's Region 1.
+  { int i;
+    for(i = 0; i < shm->npg; i++) {
+      pte_t* pte = &pcb->r1_page_table[pcb->r1_shm_base_index + i];
+      FreeFrame(pte->pfn);
+      pte->valid = 0;
+      pte->prot  = PROT_NONE;
+      pte->pfn   = 0;
+    }
+  }
+  pcb->shm_id            = 0;
+  pcb->r1_shm_base_index = 0;
+  shm->attached--;
+  KTRACE(TRACE_VERBOSE, "ShmDetachProcess(): process #%d detached from segment #%d (%d left).\n",
+	      pcb->pid, id, shm->attached);
+
+  // Last one out destroys the segment.
+  if( shm->attached == 0 ) {
+    int i;
+    for(i = 0; i < shm->npg; i++) {
+      FreeFrame(shm->frames[i]);
+    }
+    free(shm->frames);
+    free(shm);
+    free(interp_array[id]);
+    interp_array[id] = NULL;
+    KTRACE(TRACE_VERBOSE, "ShmDetachProcess(): segment #%d destroyed.\n", id);
+  }
+}
+
+void ShmForkProcess(pcb_t* parent, pcb_t* child) {
+  if( parent->shm_id == 0 ) {
+    return;
+  }
+  shm_t* shm = interp_array[parent->shm_id]->ptr.shm;
+
+  // child's page table is a copy of parent's, so it already points at the frames.
+  { int i;
+    for(i = 0; i < shm->npg; i++) {
+      ShareFrame(shm->frames[i]);
+    }
+  }
+  shm->attached++;
+}
+
 void InitQueue(queue_t* QUEUE){
   QUEUE->size = 0;
   QUEUE->head = NULL;
 }
 
 int AddToQueue(pcb_t* proc, queue_t* QUEUE) {
+  if( QUEUE == &READY ) {
+    EVENT(EV_READY, proc->pid, 0, 0);
+  }
   if( QUEUE->head == NULL ) {
     QUEUE->head = proc;
     proc->next  = proc;
@@ -108,6 +204,7 @@ int AddToQueue(pcb_t* proc, queue_t* QUEUE) {
     QUEUE->head->prev->next = proc;
     QUEUE->head->prev       = proc;
   }
+  proc->queue = QUEUE;
   
   QUEUE->size++;
   return SUCCESS;
@@ -123,6 +220,7 @@ int RemoveFromQueue(pcb_t* proc, queue_t* QUEUE) {
   } else /* ( QUEUE->head != proc ) */ {
     pcb_t* item;
     for(item = QUEUE->head->next; item != QUEUE->head; item = item->next) {
+      WORK(NODES_WALKED, 1);
       if( item == proc ) {
 	goto found;
       }
@@ -142,15 +240,321 @@ int RemoveFromQueue(pcb_t* proc, queue_t* QUEUE) {
   proc->next->prev = proc->prev;
   proc->prev->next = proc->next;
 
-  proc->next = NULL;
-  proc->prev = NULL;
+  proc->next  = NULL;
+  proc->prev  = NULL;
+  proc->queue = NULL;
 
   QUEUE->size--;
   return SUCCESS;
 }
 
+void StartTimeout(pcb_t* proc, queue_t* QUEUE, int timeout) {
+  proc->timeout_time  = ticks + timeout;
+  proc->timeout_queue = QUEUE;
+  proc->timed_out     = 0;
+
+  // Insert in order of timeout_time (after others with the same time).
+  pcb_t* prev = NULL;
+  pcb_t* next = timer_list;
+  while( next != NULL && next->timeout_time <= proc->timeout_time ) {
+    WORK(NODES_WALKED, 1);
+    prev = next;
+    next = next->timer_next;
+  }
+  proc->timer_prev = prev;
+  proc->timer_next = next;
+  if( prev == NULL ) {
+    timer_list = proc;
+  } else {
+    prev->timer_next = proc;
+  }
+  if( next != NULL ) {
+    next->timer_prev = proc;
+  }
+}
+
+// Helper method for StopTimeout() and ExpireTimeouts().
+void UnlinkTimer(pcb_t* proc) {
+  if( proc->timer_prev == NULL ) {
+    timer_list = proc->timer_next;
+  } else {
+    proc->timer_prev->timer_next = proc->timer_next;
+  }
+  if( proc->timer_next != NULL ) {
+    proc->timer_next->timer_prev = proc->timer_prev;
+  }
+  proc->timer_prev    = NULL;
+  proc->timer_next    = NULL;
+  proc->timeout_queue = NULL;
+}
+
+int StopTimeout(pcb_t* proc) {
+  // Still in timer_list, i.e., woken up by the object before the timeout.
+  if( proc->timeout_queue != NULL ) {
+    UnlinkTimer(proc);
+  }
+  return proc->timed_out;
+}
+
+void ExpireTimeouts(void) {
+  while( timer_list != NULL && ticks >= timer_list->timeout_time ) {
+    pcb_t*   proc  = timer_list;
+    queue_t* QUEUE = proc->timeout_queue;
+    UnlinkTimer(proc);
+
+    // If proc has left QUEUE, the object woke it up and it has yet to run.
+    if( proc->queue == QUEUE ) {
+      RemoveFromQueue(proc, QUEUE);
+      AddToQueue(proc, &READY);
+      proc->timed_out = 1;
+      KTRACE(TRACE_VERBOSE, "ExpireTimeouts(): process #%d timed out.\n", proc->pid);
+    }
+  }
+}
+
+void PollerAdd(poller_t** list, pcb_t* proc) {
+  poller_t* poller = (poller_t*)malloc(sizeof(poller_t));
+  assert(poller);
+  poller->proc = proc;
+  poller->next = *list;
+  *list = poller;
+}
+
+void PollerRemove(poller_t** list, pcb_t* proc) {
+  poller_t** link;
+  for(link = list; *link != NULL; link = &(*link)->next) {
+    if( (*link)->proc == proc ) {
+      poller_t* poller = *link;
+      *link = poller->next;
+      free(poller);
+      return;
+    }
+  }
+}
+
+void PollerRemoveAll(pcb_t* proc) {
+  int i;
+  for(i = 0; i < NUM_TERMINALS; i++) {
+    PollerRemove(&tty_pollers[i], proc);
+  }
+  for(i = 1; i <= iid_count && i < interp_array_size; i++) {
+    if( interp_array[i] != NULL && interp_array[i]->type == PIPE ) {
+      PollerRemove(&interp_array[i]->ptr.pipe->pollers, proc);
+    }
+  }
+}
+
+void WakePoller(pcb_t* proc) {
+  // A process polling several sources is woken up once, by whichever comes first.
+  if( proc->queue == &POLLING ) {
+    RemoveFromQueue(proc, &POLLING);
+    AddToQueue(proc, &READY);
+  }
+}
+
+void WakePollers(poller_t* list) {
+  for(; list != NULL; list = list->next) {
+    WakePoller(list->proc);
+  }
+}
+
+int TtyOutputRoom(int tty_id, int pid) {
+  tty_output_t* out  = &tty_out[tty_id];
+  int           room = TTY_OUTPUT_SIZE - out->count;
+
+  tty_stream_t* stream;
+  for(stream = out->streams; stream != NULL; stream = stream->next) {
+    if( stream->pid == pid && TTY_STREAM_MAX - stream->bytes < room ) {
+      room = TTY_STREAM_MAX - stream->bytes;
+    }
+  }
+  return room;
+}
+
+void TtyOutputPut(int tty_id, int pid, char* data, int length, int large) {
+  tty_output_t* out = &tty_out[tty_id];
+
+  tty_record_t* record = (tty_record_t*)malloc(sizeof(tty_record_t));
+  assert(record);
+  record->data   = data;
+  record->length = length;
+  record->sent   = 0;
+  record->large  = large;
+  record->next   = NULL;
+
+  // Find my stream, or start one at the end of the round.
+  tty_stream_t** link;
+  for(link = &out->streams; *link != NULL && (*link)->pid != pid; link = &(*link)->next) {
+  }
+  if( *link == NULL ) {
+    tty_stream_t* stream = (tty_stream_t*)calloc(1, sizeof(tty_stream_t));
+    assert(stream);
+    stream->pid = pid;
+    *link = stream;
+  }
+  tty_stream_t* stream = *link;
+
+  if( stream->tail == NULL ) {
+    stream->head = record;
+  } else {
+    stream->tail->next = record;
+  }
+  stream->tail   = record;
+  stream->bytes += length;
+  out->count    += length;
+}
+
+// Helper method for TtyStartTransmit(). Moves what stream may send from its records to
+// chunk (room bytes free), and returns how many bytes that was.
+int TtyServeStream(tty_stream_t* stream, char* chunk, int room, int chunk_is_empty) {
+  int taken = 0;
+  while( stream->head != NULL ) {
+    tty_record_t* record = stream->head;
+    int left = record->length - record->sent;
+    int n    = left;
+
+    if( left > room - taken ) {
+      // Small writes are atomic.
+      if( !record->large ) {
+	break;
+      }
+      // Cut large ones at the last newline which fits.
+      n = room - taken;
+      while( n > 0 && record->data[record->sent + n - 1] != '\n' ) {
+	n--;
+      }
+      // A line longer than the chunk is cut anyway, but only to start a chunk.
+      if( n == 0 && chunk_is_empty && taken == 0 ) {
+	n = room;
+      }
+      if( n == 0 ) {
+	break;
+      }
+    }
+
+    memcpy(chunk + taken, record->data + record->sent, n);
+    record->sent  += n;
+    stream->bytes -= n;
+    taken         += n;
+
+    if( record->sent < record->length ) {
+      break; // The rest goes in a later chunk, after the other streams.
+    }
+    stream->head = record->next;
+    if( stream->head == NULL ) {
+      stream->tail = NULL;
+    }
+    free(record->data);
+    free(record);
+  }
+  return taken;
+}
+
+void TtyStartTransmit(int tty_id) {
+  tty_output_t* out = &tty_out[tty_id];
+  if( out->in_flight > 0 || out->count == 0 ) {
+    return;
+  }
+
+  // One round over the streams. A stream that was served moves to the end of the
+  // list, so the next chunk starts with the streams that come after it.
+  char* chunk  = tty_write_buffer[tty_id];
+  int   length = 0;
+  int   num_streams = 0;
+  tty_stream_t* stream;
+  for(stream = out->streams; stream != NULL; stream = stream->next) {
+    num_streams++;
+  }
+  int i;
+  for(i = 0; i < num_streams && length < TERMINAL_MAX_LINE; i++) {
+    stream       = out->streams;
+    out->streams = stream->next;
+    stream->next = NULL;
+
+    int taken = TtyServeStream(stream, chunk + length, TERMINAL_MAX_LINE - length, length == 0);
+    length += taken;
+
+    if( stream->head == NULL ) {
+      free(stream);
+    } else {
+      tty_stream_t** link;
+      for(link = &out->streams; *link != NULL; link = &(*link)->next) {
+      }
+      *link = stream;
+    }
+  }
+
+  out->in_flight = length;
+  TtyTransmit(tty_id, chunk, length);
+}
+
+int TtyInputPut(int tty_id, char* src, int length) {
+  tty_input_t* in = &tty_in[tty_id];
+  if( length <= 0 ) {
+    return SUCCESS;
+  }
+  if( in->lines == TTY_INPUT_LINES || length > TTY_INPUT_SIZE - in->count ) {
+    in->overruns++;
+    TracePrintf(TRACE_USER_WARNING, "TtyInputPut(): tty #%d overrun, %d bytes dropped (%d overruns).\n",
+		tty_id, length, in->overruns);
+    return ERROR;
+  }
+
+  int tail  = (in->head + in->count) % TTY_INPUT_SIZE;
+  int first = TTY_INPUT_SIZE - tail;
+  if( first > length ) {
+    first = length;
+  }
+  memcpy(in->data + tail, src, first);
+  memcpy(in->data, src + first, length - first);
+  in->count += length;
+
+  in->line_len[(in->line_head + in->lines) % TTY_INPUT_LINES] = length;
+  in->lines++;
+  in->bytes_buffered += length;
+  return SUCCESS;
+}
+
+int TtyInputGet(int tty_id, char* dest, int length) {
+  tty_input_t* in = &tty_in[tty_id];
+  if( in->lines == 0 ) {
+    return 0;
+  }
+
+  // Never go past the end of the first line.
+  if( length > in->line_len[in->line_head] ) {
+    length = in->line_len[in->line_head];
+  }
+  int first = TTY_INPUT_SIZE - in->head;
+  if( first > length ) {
+    first = length;
+  }
+  memcpy(dest, in->data + in->head, first);
+  memcpy(dest + first, in->data, length - first);
+  in->head   = (in->head + length) % TTY_INPUT_SIZE;
+  in->count -= length;
+
+  // The rest of a partly read line stays for the next TtyRead().
+  in->line_len[in->line_head] -= length;
+  if( in->line_len[in->line_head] == 0 ) {
+    in->line_head = (in->line_head + 1) % TTY_INPUT_LINES;
+    in->lines--;
+  }
+  return length;
+}
+
+void TtyDrain(void) {
+  int i;
+  for(i = 0; i < NUM_TERMINALS; i++) {
+    while( tty_out[i].count > 0 ) {
+      ContextSwitch(READY.head, &READY, &WRITING[i]);
+    }
+  }
+}
+
 void ChangeAddressSpace(pcb_t* new_process) {
   int i;
+  COUNT(ADDRESS_SPACE_CHANGES);
   
   // Change kernel stack address space. We write new_process's page table
   // into the global page table for Region 0, for the kernel stack part.
@@ -163,7 +567,7 @@ void ChangeAddressSpace(pcb_t* new_process) {
   WriteRegister(REG_PTBR1, (unsigned int) new_process->r1_page_table);
 
   // Flush TLB to avoid confusion.
-  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_ALL);
+  FlushTLB(TLB_FLUSH_ALL);
 }
 
 void TraceRegs(int level, UserContext* u_context){
@@ -186,7 +590,7 @@ void PrintUserContextHelperHelper(UserContext* c, char* s_vector, char* s_code)
 #endif
   { int i;
     for(i = 0; i < GREGS; i++) {
-      printf("  regs[%i]=%x\t%d\n", i, c->regs[i], c->regs[i]);
+      printf("  regs[%i]=%lx\t%ld\n", i, c->regs[i], c->regs[i]);
     }
   }  
 }
@@ -214,7 +618,7 @@ void TraceUserContextHelperHelper(UserContext* c, char* s_vector, char* s_code,
 }
 void PrintUserContextHelper(UserContext* c, int TracePrintf, int level) {
   char* s_vector;
-  char* s_code;
+  char* s_code = "";
   switch( c->vector ) {
   case TRAP_KERNEL:
     s_vector = "TRAP_KERNEL";
@@ -249,6 +653,9 @@ void PrintUserContextHelper(UserContext* c, int TracePrintf, int level) {
     case YALNIX_TTY_READ:
       s_code = "TtyRead()";
       break;
+    case YALNIX_CUSTOM_0:
+      s_code = "Custom0()";
+      break;
     default:
       s_code = "Undefined";
       break;
@@ -310,12 +717,12 @@ void TraceUserContext(int level, UserContext* c) {
 
 void PrintQueueHelper(queue_t* QUEUE) {
   if( QUEUE->head == NULL ) {
-    TracePrintf(TRACE_VERBOSE, "  (Empty queue).\n");
+    KTRACE(TRACE_VERBOSE, "  (Empty queue).\n");
   } else {
-    TracePrintf(TRACE_VERBOSE, "  Head: Process #%d(ppid #%d): '%s'\n", QUEUE->head->pid, QUEUE->head->ppid, QUEUE->head->pname);
+    KTRACE(TRACE_VERBOSE, "  Head: Process #%d(ppid #%d): '%s'\n", QUEUE->head->pid, QUEUE->head->ppid, QUEUE->head->pname);
     pcb_t* pcb;
     for(pcb = QUEUE->head->next; pcb != QUEUE->head; pcb = pcb->next) {
-      TracePrintf(TRACE_VERBOSE, "        Process #%d(ppid #%d): '%s'\n", pcb->pid, pcb->ppid, pcb->pname);
+      KTRACE(TRACE_VERBOSE, "        Process #%d(ppid #%d): '%s'\n", pcb->pid, pcb->ppid, pcb->pname);
     }
   }
 }
@@ -325,6 +732,7 @@ void PrintAllQueues(void) {
   PrintQueue(&READY);
   PrintQueue(&SLEEPING);
   PrintQueue(&WAITING);
+  PrintQueue(&POLLING);
   //  { int i;
   //    for(i = 0; i < NUM_TERMINALS; i++) {
   //      PrintQueue(&WRITING[i]);
@@ -341,18 +749,20 @@ void PrintAllQueues(void) {
   PrintQueue(&READING[1]);
   PrintQueue(&READING[2]);
   PrintQueue(&READING[3]);
-  PrintQueue(&WRITING_WAIT[0]);
-  PrintQueue(&WRITING_WAIT[1]);
-  PrintQueue(&WRITING_WAIT[2]);
-  PrintQueue(&WRITING_WAIT[3]);
 }
 
 void RegisterPCB(pcb_t* pcb) {
+  COUNT(PROCESSES_CREATED);
   if( pcb->pid >= pcb_array_size ) {
-    TracePrintf(TRACE_VERBOSE, "pcb_array expands to accomodtate new process # %d.\n", pcb->pid);
-    pcb_array_size += PCB_ARRAY_INITIAL_SIZE;
-    pcb_array = (pcb_t**)realloc(pcb_array, pcb_array_size);
+    KTRACE(TRACE_VERBOSE, "pcb_array expands to accomodtate new process # %d.\n", pcb->pid);
+    int old_size = pcb_array_size;
+    while( pcb->pid >= pcb_array_size ) {
+      pcb_array_size += PCB_ARRAY_INITIAL_SIZE;
+    }
+    pcb_array = (pcb_t**)realloc(pcb_array, pcb_array_size * sizeof(pcb_t*));
     assert(pcb_array);
+    // Scans of the whole array take NULL for no process.
+    memset(pcb_array + old_size, 0, (pcb_array_size - old_size) * sizeof(pcb_t*));
   }
   pcb_array[pcb->pid] = pcb;  
 }
@@ -360,10 +770,15 @@ void RegisterPCB(pcb_t* pcb) {
 
 void RegisterInterp(int id, interp_t* interp) {
   if( id >= interp_array_size ) {
-    TracePrintf(TRACE_VERBOSE, "interp_array expands to accomodtate new interp # %d.\n", id);
-    interp_array_size += INTERP_ARRAY_INITIAL_SIZE;
-    interp_array       = (interp_t**)realloc(interp_array, interp_array_size);
+    KTRACE(TRACE_VERBOSE, "interp_array expands to accomodtate new interp # %d.\n", id);
+    int old_size = interp_array_size;
+    while( id >= interp_array_size ) {
+      interp_array_size += INTERP_ARRAY_INITIAL_SIZE;
+    }
+    interp_array = (interp_t**)realloc(interp_array, interp_array_size * sizeof(interp_t*));
     assert(interp_array);
+    // Scans of the whole array take NULL for a reclaimed (or never used) id.
+    memset(interp_array + old_size, 0, (interp_array_size - old_size) * sizeof(interp_t*));
   }
   interp_array[id] = interp;
 }
@@ -418,6 +833,14 @@ soul_t* KillPCB(pcb_t* pcb, int status) {
 
   pcb_array[pcb->pid] = NULL;
 
+  StopTimeout(pcb);
+  PollerRemoveAll(pcb);
+
+  // Leave shared memory first, so that the loop below only sees private pages.
+  ShmDetachProcess(pcb);
+  FsCloseAll(pcb);
+  ProfileFree(pcb);
+
   // Free frames assigned for this process.
   int i;
   for(i = 0; i < R0_STACK_PAGE_TABLE_SIZE; i++) {
@@ -459,8 +882,13 @@ int KillProcess(pcb_t* proc, queue_t* QUEUE_ptr, int exit_status) {
     Halt();
   } else {
     TracePrintf(TRACE_CRITICAL, "KillProcess(): killing process #%d.\n", proc->pid);
+    EVENT(EV_EXIT, proc->pid, exit_status, 0);
+    COUNT(PROCESSES_KILLED);
     // Is my parent waiting for me?
     WakeUpWaitingParent(proc->ppid);
+
+    // Let others have the locks I hold.
+    ReleaseHeldLocks(proc);
     
     RemoveFromQueue(proc, QUEUE_ptr);
     KillPCB(proc, exit_status);
@@ -478,6 +906,107 @@ int KillProcess(pcb_t* proc, queue_t* QUEUE_ptr, int exit_status) {
   return SUCCESS;
 }
 
+void LockHandOff(lock_t* lock) {
+  if( lock->QUEUE.head != NULL ) {
+    pcb_t* acquire_lock_next = lock->QUEUE.head;
+    RemoveFromQueue(acquire_lock_next, &lock->QUEUE);
+    AddToQueue(acquire_lock_next, &READY);
+    lock->haver = acquire_lock_next;
+  } else {
+    lock->haver = NULL;
+  }
+}
+
+int RWLockIsReader(rwlock_t* rwlock, pcb_t* proc) {
+  holder_t* h;
+  for(h = rwlock->readers; h != NULL; h = h->next) {
+    if( h->proc == proc ) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void RWLockAddReader(rwlock_t* rwlock, pcb_t* proc) {
+  holder_t* h = (holder_t*)malloc(sizeof(holder_t));
+  assert(h);
+  h->proc = proc;
+  h->next = rwlock->readers;
+  rwlock->readers = h;
+  rwlock->num_readers++;
+}
+
+// Hands the lock to whoever should get it next.
+// writer_released is 1 if the last holder was a writer.
+void RWLockHandOff(rwlock_t* rwlock, int writer_released) {
+  // A writer or some readers still hold the lock.
+  if( rwlock->writer != NULL || rwlock->num_readers > 0 ) {
+    return;
+  }
+
+  // After a write, readers which queued up behind the writer go in one batch.
+  if( writer_released || rwlock->WRITERS.head == NULL ) {
+    while( rwlock->READERS.head != NULL ) {
+      pcb_t* reader = rwlock->READERS.head;
+      RemoveFromQueue(reader, &rwlock->READERS);
+      AddToQueue(reader, &READY);
+      RWLockAddReader(rwlock, reader);
+    }
+    if( rwlock->num_readers > 0 ) {
+      return;
+    }
+  }
+
+  if( rwlock->WRITERS.head != NULL ) {
+    pcb_t* writer = rwlock->WRITERS.head;
+    RemoveFromQueue(writer, &rwlock->WRITERS);
+    AddToQueue(writer, &READY);
+    rwlock->writer = writer;
+  }
+}
+
+int RWLockRelease(rwlock_t* rwlock, pcb_t* proc) {
+  if( rwlock->writer == proc ) {
+    rwlock->writer = NULL;
+    RWLockHandOff(rwlock, 1);
+    return SUCCESS;
+  }
+
+  holder_t** h;
+  for(h = &rwlock->readers; *h != NULL; h = &(*h)->next) {
+    if( (*h)->proc == proc ) {
+      holder_t* found = *h;
+      *h = found->next;
+      free(found);
+      rwlock->num_readers--;
+      RWLockHandOff(rwlock, 0);
+      return SUCCESS;
+    }
+  }
+
+  // proc does not hold this lock.
+  return ERROR;
+}
+
+void ReleaseHeldLocks(pcb_t* proc) {
+  int id;
+  for(id = 1; id <= iid_count && id < interp_array_size; id++) {
+    interp_t* interp = interp_array[id];
+    if( interp == NULL ) {
+      continue;
+    }
+    if( interp->type == LOCK && interp->ptr.lock->haver == proc ) {
+      KTRACE(TRACE_VERBOSE, "ReleaseHeldLocks(): process #%d dies holding lock #%d.\n", proc->pid, id);
+      LockHandOff(interp->ptr.lock);
+    } else if( interp->type == RWLOCK ) {
+      // A process holds a reader-writer lock at most once.
+      if( SUCCESS == RWLockRelease(interp->ptr.rwlock, proc) ) {
+	KTRACE(TRACE_VERBOSE, "ReleaseHeldLocks(): process #%d dies holding rwlock #%d.\n", proc->pid, id);
+      }
+    }
+  }
+}
+
 int IsInvalidIID(int id) {
   // Invalid iid.
   if( id < 0 ) {
@@ -499,4 +1028,269 @@ int IsInvalidIID(int id) {
   return 0;
 }
 
+int EventDump(void) {
+  events_header_t header;
+  header.magic   = EVENT_MAGIC;
+  header.count   = event_count < EVENT_RING_SIZE ? event_count : EVENT_RING_SIZE;
+  header.dropped = event_count - header.count;
+
+  int fd = open(EVENT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if( fd < 0 ) {
+    TracePrintf(TRACE_SEVERE, "EventDump(): cannot open %s.\n", EVENT_FILE);
+    return ERROR;
+  }
+  // Oldest first: once the ring is full, the oldest event is the next to be overwritten.
+  int oldest = header.dropped == 0 ? 0 : (event_count & (EVENT_RING_SIZE - 1));
+  int tail   = (header.count - oldest) * sizeof(event_t);
+  int head   = oldest * sizeof(event_t);
+  int ok = write(fd, &header, sizeof(header)) == sizeof(header) &&
+           write(fd, &event_ring[oldest], tail) == tail &&
+           write(fd, &event_ring[0], head) == head;
+  close(fd);
+  if( !ok ) {
+    TracePrintf(TRACE_SEVERE, "EventDump(): cannot write %s.\n", EVENT_FILE);
+    return ERROR;
+  }
+  return header.count;
+}
+
+void TimelineSample(void) {
+  timeline_sample_t* sample = &timeline_ring[timeline_count++ & (TIMELINE_RING_SIZE - 1)];
+  short* sizes = sample->sizes;
+  memset(sample, 0, sizeof(timeline_sample_t));
+  sample->tick = ticks;
+  sample->pid  = RUNNING.head != NULL ? RUNNING.head->pid : -1;
+
+  sizes[TL_READY]       = READY.size;
+  sizes[TL_SLEEPING]    = SLEEPING.size;
+  sizes[TL_WAITING]     = WAITING.size;
+  sizes[TL_POLLING]     = POLLING.size;
+  sizes[TL_BUF_WAITING] = BUF_WAITING.size;
+  sizes[TL_FS_WAITING]  = FS_WAITING.size;
+  int i;
+  for(i = 0; i < NUM_TERMINALS && i < 4; i++) {
+    sizes[TL_READING_0 + i] = READING[i].size;
+    sizes[TL_WRITING_0 + i] = WRITING[i].size;
+  }
+
+  // Interps, by type.
+  for(i = 1; i <= iid_count && i < interp_array_size; i++) {
+    interp_t* interp = interp_array[i];
+    if( interp == NULL ) {
+      continue;
+    }
+    int size;
+    switch( interp->type ) {
+    case LOCK:   size = interp->ptr.lock->QUEUE.size; sizes[TL_LOCKS] += size; break;
+    case CVAR:   size = interp->ptr.cvar->QUEUE.size; sizes[TL_CVARS] += size; break;
+    case PIPE:   size = interp->ptr.pipe->QUEUE.size; sizes[TL_PIPES] += size; break;
+    case RWLOCK:
+      size = interp->ptr.rwlock->READERS.size + interp->ptr.rwlock->WRITERS.size;
+      sizes[TL_RWLOCKS] += size;
+      break;
+    default:     size = 0;
+    }
+    if( size > sizes[TL_INTERP_MAX] ) {
+      sizes[TL_INTERP_MAX] = size;
+      sizes[TL_INTERP_ID]  = i;
+    }
+  }
+}
+
+int TimelineDump(void) {
+  timeline_header_t header;
+  header.magic   = TIMELINE_MAGIC;
+  header.count   = timeline_count < TIMELINE_RING_SIZE ? timeline_count : TIMELINE_RING_SIZE;
+  header.dropped = timeline_count - header.count;
+  header.columns = TIMELINE_COLUMNS;
+
+  int fd = open(TIMELINE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if( fd < 0 ) {
+    TracePrintf(TRACE_SEVERE, "TimelineDump(): cannot open %s.\n", TIMELINE_FILE);
+    return ERROR;
+  }
+  // Oldest first, as in EventDump().
+  int oldest = header.dropped == 0 ? 0 : (timeline_count & (TIMELINE_RING_SIZE - 1));
+  int tail   = (header.count - oldest) * sizeof(timeline_sample_t);
+  int head   = oldest * sizeof(timeline_sample_t);
+  int ok = write(fd, &header, sizeof(header)) == sizeof(header) &&
+           write(fd, &timeline_ring[oldest], tail) == tail &&
+           write(fd, &timeline_ring[0], head) == head;
+  close(fd);
+  if( !ok ) {
+    TracePrintf(TRACE_SEVERE, "TimelineDump(): cannot write %s.\n", TIMELINE_FILE);
+    return ERROR;
+  }
+  return header.count;
+}
+
+int ProfileOn(pcb_t* proc, int on) {
+  if( proc->profile == NULL ) {
+    if( !on ) {
+      return 0;
+    }
+    proc->profile = (profile_t*)calloc(1, sizeof(profile_t));
+    assert(proc->profile);
+  }
+  proc->profile->on = on;
+  return proc->profile->samples;
+}
+
+void ProfileSample(pcb_t* proc, void* pc) {
+  profile_t* profile = proc->profile;
+  if( profile == NULL || !profile->on || pc == NULL ) {
+    return;
+  }
+  profile->samples++;
+  // Open addressing; instructions are at least a byte apart, so hash all of the pc.
+  int slot = ((unsigned int) pc * 2654435761u) >> 22; // 10 bits: PROFILE_SLOTS.
+  int i;
+  for(i = 0; i < PROFILE_SLOTS; i++) {
+    profile_sample_t* sample = &profile->table[(slot + i) & (PROFILE_SLOTS - 1)];
+    if( sample->pc == (int) pc || sample->pc == 0 ) {
+      sample->pc = (int) pc;
+      sample->samples++;
+      return;
+    }
+  }
+  profile->dropped++;
+}
+
+int ProfileWrite(pcb_t* proc) {
+  profile_t* profile = proc->profile;
+  if( profile == NULL || profile->samples == 0 ) {
+    return SUCCESS;
+  }
+  profile_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic   = PROFILE_MAGIC;
+  header.pid     = proc->pid;
+  header.samples = profile->samples;
+  header.dropped = profile->dropped;
+  memcpy(header.name, proc->pname, PROFILE_NAME - 1); // pname is '\0'-padded.
+
+  // Packs the samples to the front of the table, which is cleared below anyway.
+  int i;
+  for(i = 0; i < PROFILE_SLOTS; i++) {
+    if( profile->table[i].pc != 0 ) {
+      profile->table[header.count++] = profile->table[i];
+    }
+  }
+
+  int fd = open(PROFILE_FILE, O_WRONLY | O_CREAT | O_APPEND | (profile_started ? 0 : O_TRUNC), 0644);
+  if( fd < 0 ) {
+    TracePrintf(TRACE_SEVERE, "ProfileWrite(): cannot open %s.\n", PROFILE_FILE);
+    return ERROR;
+  }
+  profile_started = 1;
+  int size = header.count * sizeof(profile_sample_t);
+  int ok = write(fd, &header, sizeof(header)) == sizeof(header) &&
+           write(fd, profile->table, size) == size;
+  close(fd);
+
+  memset(profile->table, 0, sizeof(profile->table));
+  profile->samples = 0;
+  profile->dropped = 0;
+  if( !ok ) {
+    TracePrintf(TRACE_SEVERE, "ProfileWrite(): cannot write %s.\n", PROFILE_FILE);
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+void ProfileFork(pcb_t* parent, pcb_t* child) {
+  child->profile = NULL;
+  if( parent->profile != NULL && parent->profile->on ) {
+    ProfileOn(child, 1);
+  }
+}
+
+void ProfileFree(pcb_t* proc) {
+  if( proc->profile != NULL ) {
+    ProfileWrite(proc);
+    free(proc->profile);
+    proc->profile = NULL;
+  }
+}
+
+void ProfileWriteAll(void) {
+  int pid;
+  for(pid = 0; pid <= pid_count && pid < pcb_array_size; pid++) {
+    if( pcb_array[pid] != NULL ) {
+      ProfileWrite(pcb_array[pid]);
+    }
+  }
+}
+
+// Helper method for HistRecord().
+int HistBucket(int value) {
+  int bucket = 0;
+  while( value > 0 && bucket < HIST_BUCKETS - 1 ) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void HistRecord(int call, int ticks, int* work) {
+  if( call < 0 || call >= HIST_CALLS ) {
+    return;
+  }
+  syscall_hist_t* hist = syscall_hists[call];
+  if( hist == NULL ) {
+    hist = (syscall_hist_t*)calloc(1, sizeof(syscall_hist_t));
+    assert(hist);
+    syscall_hists[call] = hist;
+  }
+  hist->calls++;
+  hist->ticks[HistBucket(ticks)]++;
+  int i;
+  for(i = 0; i < NUM_WORK; i++) {
+    hist->work[i][HistBucket(work[i])]++;
+  }
+}
+
+// Helper method for CountersPrint().
+char* CodeName(code_name_t* names, int code) {
+  for(; names->name != NULL; names++) {
+    if( names->code == code ) {
+      return names->name;
+    }
+  }
+  return "?";
+}
+
+void CountersPrint(void) {
+  static code_name_t syscall_names[] = { SYSCALL_NAMES, { 0, NULL } };
+  static code_name_t custom_names[]  = { CUSTOM_NAMES,  { 0, NULL } };
+#define X(id, name) name,
+  static char* counter_names[] = { COUNTER_LIST };
+#undef X
+
+  TracePrintf(TRACE_CRITICAL, "Counters at tick %d:\n", ticks);
+  int i;
+  for(i = 0; i < NUM_COUNTERS; i++) {
+    TracePrintf(TRACE_CRITICAL, "  %-32s %10d\n", counter_names[i], counters[i]);
+  }
+  TracePrintf(TRACE_CRITICAL, "System calls:\n");
+  for(i = 0; i < SYSCALL_CODES; i++) {
+    if( syscall_counts[i] != 0 ) {
+      TracePrintf(TRACE_CRITICAL, "  %-32s %10d\n", CodeName(syscall_names, i | YALNIX_PREFIX), syscall_counts[i]);
+    }
+  }
+  for(i = 0; i < CUSTOM_CODES; i++) {
+    if( custom_counts[i] != 0 ) {
+      TracePrintf(TRACE_CRITICAL, "  Custom0: %-23s %10d\n", CodeName(custom_names, i), custom_counts[i]);
+    }
+  }
+}
+
+void KernelHalt(void) {
+  CountersPrint();
+  EventDump();
+  TimelineDump();
+  ProfileWriteAll();
+  (Halt)(); // The hardware's, not the macro.
+}
+
 // End of Utility.c
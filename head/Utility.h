@@ -24,9 +24,51 @@
   }
 
 #define here() { \
-  TracePrintf(TRACE_COMMENT, "******** %s:%d ********\n", __FILE__, __LINE__); \
+  KTRACE(TRACE_COMMENT, "******** %s:%d ********\n", __FILE__, __LINE__); \
   }
   
+// Flushes the TLB (TLB_FLUSH_ALL, TLB_FLUSH_0, TLB_FLUSH_1 or an address), counting it.
+#define FlushTLB(what) do {				\
+    COUNT(TLB_FLUSHES);					\
+    WriteRegister(REG_TLB_FLUSH, (unsigned int)(what));	\
+  } while(0)
+
+// Halt() prints the counters, dumps the event log (Events.h) and writes the profiles
+// (Profile.h) before it halts the machine.
+void KernelHalt(void);
+#define Halt() KernelHalt()
+
+// Records one call of system call call (see syscall_hist_t) that took ticks and did
+// work[0..(NUM_WORK-1)].
+void HistRecord(int call, int ticks, int* work);
+
+// Prints the performance counters (Counters.h) as a table, at TRACE_CRITICAL.
+void CountersPrint(void);
+
+// Writes the event log to EVENT_FILE. Returns the number of events written, or ERROR.
+int EventDump(void);
+
+// Scheduler timeline (see Timeline.h).
+// TimelineSample() records the size of every queue now, for HandleTrapClock().
+// TimelineDump() writes the ring to TIMELINE_FILE. Returns the number of samples
+// written, or ERROR.
+void TimelineSample(void);
+int  TimelineDump(void);
+
+// Profiler (see Profile.h).
+// ProfileOn() turns sampling of proc on or off, and returns the samples it has so far.
+// ProfileSample() counts one sample of proc at pc, if it is profiled.
+// ProfileWrite() appends proc's samples (if any) to PROFILE_FILE, and clears them.
+// ProfileFork() profiles child if parent is profiled.
+// ProfileFree() writes proc's samples and frees its profile, for KillPCB().
+// ProfileWriteAll() writes every process's samples, for KernelHalt().
+int  ProfileOn(pcb_t* proc, int on);
+void ProfileSample(pcb_t* proc, void* pc);
+int  ProfileWrite(pcb_t* proc);
+void ProfileFork(pcb_t* parent, pcb_t* child);
+void ProfileFree(pcb_t* proc);
+void ProfileWriteAll(void);
+
 #define WARN_USER(...) ({\
   TracePrintf(TRACE_USER_WARNING, __VA_ARGS__); \
 })
@@ -46,6 +88,20 @@ int FindFreeFrame(int PROT_CODE /*3-bit protection type code in fte_t*/);
 // return ERROR if the given index is invalid for freeing
 int FreeFrame(int index);
 
+// Add a reference to a frame which is already in use.
+// FreeFrame() only releases the frame when the last reference is dropped.
+int ShareFrame(int index);
+
+// Records who frame index was allocated for: process pid (0 for the kernel), to hold
+// its page at addr, as kind (FRAME_* in CustomCalls.h). FindFreeFrame() marks a new
+// frame as the kernel's heap until its caller says otherwise; FreeFrame() clears it.
+void SetFrameOwner(int index, int pid, void* addr, int kind);
+
+// Shared memory helpers.
+int  IsShmPage(pcb_t*, int page);          // Returns 1 if Region 1 page belongs to pcb's segment.
+void ShmDetachProcess(pcb_t*);             // Unmaps pcb's segment (if any). Destroys it if last.
+void ShmForkProcess(pcb_t* parent, pcb_t* child); // child inherits parent's mapping.
+
 // Check to make sure pointer is mapped to valid memory in region 1 and has desired PROTECTION
 int CheckUserPointer(void* ptr, int PROTECTION);
 
@@ -61,12 +117,51 @@ void InitQueue(queue_t* QUEUE);
 int AddToQueue(pcb_t*, queue_t*);
 int RemoveFromQueue(pcb_t*, queue_t*);
 
+// Timed waits.
+//
+// StartTimeout() puts proc in timer_list, to be taken out of QUEUE (and put in READY)
+// after timeout ticks. The caller then blocks on QUEUE as usual.
+// StopTimeout() must be called once proc runs again. It returns 1 if the wait timed
+// out, 0 if the object woke proc up first (in which case proc leaves timer_list).
+// ExpireTimeouts() is called by HandleTrapClock().
+void StartTimeout(pcb_t* proc, queue_t* QUEUE, int timeout);
+int  StopTimeout(pcb_t* proc);
+void ExpireTimeouts(void);
+
+// Terminal output (tty_out[]).
+//
+// TtyOutputRoom() is the number of bytes process pid may still buffer.
+// TtyOutputPut() appends a record of length bytes to pid's stream; data must be
+// malloc()-ed, and is freed once sent. TtyStartTransmit() sends the next chunk if the
+// terminal is idle. TtyDrain() blocks the running process until all output is sent.
+int  TtyOutputRoom(int tty_id, int pid);
+void TtyOutputPut(int tty_id, int pid, char* data, int length, int large);
+void TtyStartTransmit(int tty_id);
+void TtyDrain(void);
+
+// Terminal input rings (tty_in[]).
+//
+// TtyInputPut() appends a received line, or drops it and returns ERROR if it does not
+// fit. TtyInputGet() takes up to length bytes from the first line and returns how many.
+int TtyInputPut(int tty_id, char* src, int length);
+int TtyInputGet(int tty_id, char* dest, int length);
+
+// Poll().
+//
+// PollerAdd() and PollerRemove() list and unlist proc as a poller of a source.
+// WakePollers() moves every listed process still blocked in Poll() to READY.
+void PollerAdd   (poller_t** list, pcb_t* proc);
+void PollerRemove(poller_t** list, pcb_t* proc);
+void PollerRemoveAll(pcb_t* proc); // From every source, for KillPCB().
+void WakePoller  (pcb_t* proc);
+void WakePollers (poller_t* list);
+
 void PrintQueueHelper(queue_t* QUEUE);
 void PrintAllQueues(void);
 
 #define PrintQueue(QUEUE_ptr) {					\
     if( (QUEUE_ptr)->head != NULL ) {				\
-      TracePrintf(TRACE_VERBOSE, "QUEUE '%s':\n", #QUEUE_ptr);	\
+      KTRACE(TRACE_VERBOSE, "QUEUE '%s':\n", #QUEUE_ptr);	\
       PrintQueueHelper(QUEUE_ptr);				\
     }								\
   }
@@ -81,5 +176,22 @@ int KillProcess(pcb_t* process, queue_t* FROM_QUEUE, int exit_status);
 void RegisterInterp(int id, interp_t* interp); // interp_array[id] is set to interp.
 int IsInvalidIID(int id); // Returns 1 if id is invalid iid, 0 otherwise.
 
+// LoadProgram.c.
+//
+// With from_disk set, a name which is no Linux file is looked up in the file system;
+// this may block, so it is only for Exec(). InstallProgram() writes the Linux program
+// linux_name into the file system as path, for Exec() to find. If that fails partway,
+// a path it made is removed, and one it replaced is left holding no image; if path is
+// open (being loaded), it is left alone and ERROR returned.
+int LoadProgram(char* name, char* args[], pcb_t* proc, int from_disk);
+int InstallProgram(char* linux_name, char* path);
+
+// Lock helpers.
+void LockHandOff(lock_t*);                  // Gives lock to next waiter (or no one).
+int  RWLockIsReader(rwlock_t*, pcb_t*);     // Returns 1 if process holds lock for reading.
+void RWLockAddReader(rwlock_t*, pcb_t*);
+int  RWLockRelease(rwlock_t*, pcb_t*);      // Returns ERROR if process does not hold lock.
+void ReleaseHeldLocks(pcb_t*);              // Releases all locks held by a dying process.
+
 #endif
 // End of Utility.h
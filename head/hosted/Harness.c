@@ -0,0 +1,407 @@
+// Harness.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Runs the kernel on the hosted machine (see Machine.h), on Linux, without the DCS 58
+// libraries, and reports how long it spends in each trap and system call:
+//
+//   make hosted
+//   hosted/Harness [options] [scenario ...]
+//
+//   -n iterations   times each scenario's loop runs (default 1000)
+//   -c cycles       cycles per clock tick (default 100)
+//   -d cycles       cycles per disk access (default 50)
+//   -t cycles       cycles per byte sent to a terminal (default 1)
+//   -m bytes        physical memory (default 4MB)
+//   -lk level       kernel TracePrintf() level kept in TRACE (default 0)
+//   -b              print "BENCH metric value unit" lines, as ./bench does
+//   -r              record every trap in TRAPS
+//   -p              replay the interrupts recorded in TRAPS (with the same -n, -c, -d, -t
+//                   and -m), and report where the run diverges from the recording and
+//                   how the kernel's counters differ
+//   -l              list the scenarios
+//
+// Each scenario boots a kernel of its own, in a Linux process of its own, in the
+// directory hosted-<scenario>, where its TRACE, TTYLOG.n, DISK, EVENTS, TIMELINE and
+// TRAPS are left. The harness fails (exits with 1) if any scenario does: a step that
+// checks a result, a kernel Halt() other than for init's Exit(0), or a crash.
+//
+// Timings are host nanoseconds, MMU emulation included (see the TLB counts in the
+// report), so compare them with each other rather than with the emulator's.
+//
+// To compare two kernels on the same interleaving of interrupts, record with one and
+// replay with the other:
+//
+//   make hosted && hosted/Harness -r
+//   (change the kernel)
+//   make hosted && hosted/Harness -p
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "hosted/Machine.h"
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Steps (see Machine.h).
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+#define CALL(code, a, b, c)   { STEP_CALL,   { code, a, b, c, 0 } }
+#define CUSTOM(code, a, b, c) { STEP_CALL,   { YALNIX_CUSTOM_0, code, a, b, c } }
+#define EXEC(name)            { STEP_CALL,   { YALNIX_EXEC, ARG_STR, ARG_ARGV }, name }
+#define SAVE(var)             { STEP_SAVE,   { var } }
+#define EXPECT(value)         { STEP_EXPECT, { value } }
+#define OK                    { STEP_OK }
+#define REPEAT(n)             { STEP_REPEAT, { n } }
+#define END                   { STEP_END }
+#define FORK                  { STEP_FORK }
+#define PARENT                { STEP_PARENT }
+#define JOIN                  { STEP_JOIN }
+#define EXIT(status)          { STEP_EXIT,   { status } }
+#define SPIN(cycles)          { STEP_SPIN,   { cycles } }
+#define GROW(pages)           { STEP_GROW,   { pages } }
+#define TRAP(vector, code)    { STEP_TRAP,   { vector, code } }
+#define INPUT(tty, delay, s)  { STEP_INPUT,  { tty, delay }, s }
+#define PAUSE                 { STEP_PAUSE }
+#define DONE                  { 0 }
+
+#define VAR(n)  (ARG_VAR | (n))
+#define ADDR(n) (ARG_ADDR | (n))
+#define BUF     ARG_BUF
+#define ITERS   ARG_ITERS
+
+#define WAIT    CALL(YALNIX_WAIT, ADDR(15), 0, 0), OK
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Scenarios.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+step_t idle_steps[] = {
+  REPEAT(0), PAUSE, END, DONE
+};
+
+step_t exit0_steps[] = {
+  EXIT(0), DONE
+};
+
+step_t getpid_steps[] = {
+  REPEAT(ITERS), CALL(YALNIX_GETPID, 0, 0, 0), END,
+  EXIT(0), DONE
+};
+
+step_t fork_steps[] = {
+  REPEAT(ITERS),
+    FORK,
+      EXIT(0),
+    PARENT,
+      WAIT,
+    JOIN,
+  END,
+  EXIT(0), DONE
+};
+
+step_t exec_steps[] = {
+  REPEAT(ITERS),
+    FORK,
+      EXEC("exit0"), EXIT(1),
+    PARENT,
+      WAIT, EXPECT(0),
+    JOIN,
+  END,
+  EXIT(0), DONE
+};
+
+step_t pipe_steps[] = {
+  CALL(YALNIX_PIPE_INIT, ADDR(0), 0, 0), OK,
+  REPEAT(ITERS),
+    CALL(YALNIX_PIPE_WRITE, VAR(0), BUF, 1024), EXPECT(1024),
+    CALL(YALNIX_PIPE_READ,  VAR(0), BUF, 1024), EXPECT(1024),
+  END,
+  EXIT(0), DONE
+};
+
+// As in programs/bench/SyncBench.c: each Release() hands the lock to the other.
+step_t lock_steps[] = {
+  CALL(YALNIX_LOCK_INIT, ADDR(0), 0, 0), OK,
+  CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0),
+  FORK,
+    REPEAT(ITERS),
+      CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0), OK,
+      CALL(YALNIX_LOCK_RELEASE, VAR(0), 0, 0), OK,
+    END,
+    EXIT(0),
+  PARENT,
+    CALL(YALNIX_DELAY, 1, 0, 0), // The child blocks in Acquire().
+    REPEAT(ITERS),
+      CALL(YALNIX_LOCK_RELEASE, VAR(0), 0, 0), OK,
+      CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0), OK,
+    END,
+    CALL(YALNIX_LOCK_RELEASE, VAR(0), 0, 0),
+    WAIT,
+  JOIN,
+  EXIT(0), DONE
+};
+
+step_t cvar_steps[] = {
+  CALL(YALNIX_LOCK_INIT, ADDR(0), 0, 0), OK,
+  CALL(YALNIX_CVAR_INIT, ADDR(1), 0, 0), OK,
+  CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0),
+  FORK,
+    CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0),
+    REPEAT(ITERS),
+      CALL(YALNIX_CVAR_SIGNAL, VAR(1), 0, 0), OK,
+      CALL(YALNIX_CVAR_WAIT, VAR(1), VAR(0), 0), OK,
+    END,
+    CALL(YALNIX_LOCK_RELEASE, VAR(0), 0, 0),
+    EXIT(0),
+  PARENT,
+    CALL(YALNIX_DELAY, 1, 0, 0),
+    REPEAT(ITERS),
+      CALL(YALNIX_CVAR_WAIT, VAR(1), VAR(0), 0), OK,
+      CALL(YALNIX_CVAR_SIGNAL, VAR(1), 0, 0), OK,
+    END,
+    CALL(YALNIX_LOCK_RELEASE, VAR(0), 0, 0),
+    WAIT,
+  JOIN,
+  EXIT(0), DONE
+};
+
+// Four processes that compute, for the clock to preempt.
+step_t sched_steps[] = {
+  REPEAT(4),
+    FORK,
+      SPIN(ITERS), EXIT(0),
+    PARENT,
+    JOIN,
+  END,
+  REPEAT(4), WAIT, END,
+  CALL(YALNIX_WAIT, ADDR(15), 0, 0), EXPECT(ERROR),
+  EXIT(0), DONE
+};
+
+step_t delay_steps[] = {
+  REPEAT(ITERS), CALL(YALNIX_DELAY, 1, 0, 0), EXPECT(0), END,
+  EXIT(0), DONE
+};
+
+step_t ttywrite_steps[] = {
+  REPEAT(ITERS), CALL(YALNIX_TTY_WRITE, 1, BUF, 256), EXPECT(256), END,
+  EXIT(0), DONE
+};
+
+step_t ttyread_steps[] = {
+  REPEAT(ITERS),
+    INPUT(1, 10, "a line\n"),
+    CALL(YALNIX_TTY_READ, 1, BUF, 100), EXPECT(7),
+  END,
+  EXIT(0), DONE
+};
+
+// Children that grow their stacks by a page at a time (TRAP_MEMORY).
+step_t stack_steps[] = {
+  REPEAT(ITERS),
+    FORK,
+      GROW(16), EXIT(0),
+    PARENT,
+      WAIT,
+    JOIN,
+  END,
+  EXIT(0), DONE
+};
+
+// Children killed for an illegal instruction.
+step_t illegal_steps[] = {
+  REPEAT(ITERS),
+    FORK,
+      TRAP(TRAP_ILLEGAL, 0), EXIT(0),
+    PARENT,
+      WAIT,
+    JOIN,
+  END,
+  EXIT(0), DONE
+};
+
+step_t disk_steps[] = {
+  REPEAT(ITERS),
+    CALL(YALNIX_WRITE_SECTOR, 7, BUF, 0), OK,
+    CALL(YALNIX_READ_SECTOR,  7, BUF, 0), OK,
+    CUSTOM(CUSTOM_SYNC, 0, 0, 0), OK,
+  END,
+  EXIT(0), DONE
+};
+
+// A lock and a pipe per iteration, each reclaimed after a child dies holding the lock
+// (ReleaseHeldLocks()); ids are never reused, so interp_array grows past its first
+// 128 while the clock samples it (TimelineSample()).
+step_t interps_steps[] = {
+  REPEAT(ITERS),
+    CALL(YALNIX_LOCK_INIT, ADDR(0), 0, 0), OK,
+    CALL(YALNIX_PIPE_INIT, ADDR(1), 0, 0), OK,
+    FORK,
+      CALL(YALNIX_LOCK_ACQUIRE, VAR(0), 0, 0), OK,
+      EXIT(0),
+    PARENT,
+      WAIT,
+    JOIN,
+    CALL(YALNIX_RECLAIM, VAR(0), 0, 0), OK,
+    CALL(YALNIX_RECLAIM, VAR(1), 0, 0), OK,
+  END,
+  EXIT(0), DONE
+};
+
+typedef struct {
+  char*   name;
+  char*   description;
+  step_t* steps;
+} scenario_t;
+
+scenario_t scenarios[] = {
+  { "getpid",   "GetPid(): the cost of a trap",                   getpid_steps },
+  { "fork",     "Fork(), Exit() and Wait()",                      fork_steps },
+  { "exec",     "Fork(), Exec(), Exit() and Wait()",              exec_steps },
+  { "pipe",     "PipeWrite() and PipeRead() of 1KB",              pipe_steps },
+  { "lock",     "lock ping-pong between two processes",           lock_steps },
+  { "cvar",     "condition variable ping-pong",                   cvar_steps },
+  { "sched",    "four processes preempted by the clock",          sched_steps },
+  { "delay",    "Delay(1)",                                       delay_steps },
+  { "ttywrite", "TtyWrite() of 256 bytes",                        ttywrite_steps },
+  { "ttyread",  "TtyRead() of a line typed while it waits",       ttyread_steps },
+  { "stack",    "children that grow their stacks by 16 pages",    stack_steps },
+  { "illegal",  "children killed by TRAP_ILLEGAL",                illegal_steps },
+  { "disk",     "WriteSector(), ReadSector() and Sync()",         disk_steps },
+  { "interps",  "locks and pipes made, held by the dead, reclaimed", interps_steps },
+  { NULL, NULL, NULL }
+};
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Running them.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// Runs scenario in a Linux process of its own. Returns its exit status.
+int RunScenario(scenario_t* scenario, machine_config_t* config) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if( pid < 0 ) {
+    perror("fork");
+    return 1;
+  }
+  if( pid == 0 ) {
+    char dir[64];
+    snprintf(dir, sizeof(dir), "hosted-%s", scenario->name);
+    mkdir(dir, 0755);
+    if( chdir(dir) != 0 ) {
+      perror(dir);
+      exit(1);
+    }
+    hosted_program_t programs[] = {
+      { scenario->name, scenario->steps },
+      { "IdleProcess",  idle_steps },
+      { "exit0",        exit0_steps },
+      { NULL, NULL }
+    };
+    char* args[] = { scenario->name, NULL };
+    config->name = scenario->name;
+    MachineWritePrograms(programs);
+    MachineRun(config, programs, args); // Does not return.
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  if( WIFSIGNALED(status) ) {
+    fprintf(stderr, "hosted %s: FAIL: %s\n", scenario->name, strsignal(WTERMSIG(status)));
+    return 1;
+  }
+  return WEXITSTATUS(status);
+}
+
+void Usage(void) {
+  fprintf(stderr, "usage: hosted/Harness [-n iterations] [-c cycles per tick] [-d disk cycles]\n"
+	  "                      [-t tty cycles per byte] [-m bytes] [-lk level] [-b]\n"
+	  "                      [-r | -p] [-l]\n"
+	  "                      [scenario ...]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  machine_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.pmem_size       = 4 * 1024 * 1024;
+  config.tick_cycles     = 100;
+  config.disk_cycles     = 50;
+  config.tty_byte_cycles = 1;
+  config.iterations      = 1000;
+  config.max_ticks       = 1000000;
+
+  int i;
+  for(i = 1; i < argc && argv[i][0] == '-'; i++) {
+    char* option = argv[i];
+    if( strcmp(option, "-b") == 0 ) {
+      config.bench = 1;
+      continue;
+    }
+    if( strcmp(option, "-r") == 0 ) {
+      config.record = 1;
+      continue;
+    }
+    if( strcmp(option, "-p") == 0 ) {
+      config.replay = 1;
+      continue;
+    }
+    if( strcmp(option, "-l") == 0 ) {
+      scenario_t* s;
+      for(s = scenarios; s->name != NULL; s++) {
+	printf("%-10s %s\n", s->name, s->description);
+      }
+      return 0;
+    }
+    if( i + 1 == argc ) {
+      Usage();
+    }
+    int value = atoi(argv[++i]);
+    if( strcmp(option, "-n") == 0 && value > 0 ) {
+      config.iterations = value;
+    } else if( strcmp(option, "-c") == 0 && value > 0 ) {
+      config.tick_cycles = value;
+    } else if( strcmp(option, "-d") == 0 && value > 0 ) {
+      config.disk_cycles = value;
+    } else if( strcmp(option, "-t") == 0 && value > 0 ) {
+      config.tty_byte_cycles = value;
+    } else if( strcmp(option, "-m") == 0 && value >= 2 * VMEM_REGION_SIZE ) {
+      config.pmem_size = value;
+    } else if( strcmp(option, "-lk") == 0 ) {
+      config.trace_level = value;
+    } else {
+      Usage();
+    }
+  }
+
+  if( config.record && config.replay ) {
+    Usage(); // Both would use TRAPS.
+  }
+
+  int failures = 0;
+  scenario_t* s;
+  for(s = scenarios; s->name != NULL; s++) {
+    int chosen = i == argc;
+    int j;
+    for(j = i; j < argc; j++) {
+      chosen |= strcmp(argv[j], s->name) == 0;
+    }
+    if( chosen && RunScenario(s, &config) != 0 ) {
+      failures++;
+    }
+  }
+  for(; i < argc; i++) {
+    for(s = scenarios; s->name != NULL && strcmp(argv[i], s->name) != 0; s++) {
+    }
+    if( s->name == NULL ) {
+      fprintf(stderr, "hosted: no scenario %s (-l lists them)\n", argv[i]);
+      failures++;
+    }
+  }
+  return failures > 0 ? 1 : 0;
+}
+
+// End of Harness.c
@@ -0,0 +1,1115 @@
+// Machine.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// The hosted machine (see Machine.h): hardware.h's functions, for a kernel linked into
+// an ordinary Linux program.
+//
+//   Memory     Physical memory is a memfd of pmem_size bytes. The kernel stack and
+//              region 1 are real addresses, which the MMU maps, a page at a time, to
+//              the frames the page tables name. A page is mapped when first touched
+//              (SIGSEGV is the TLB miss), and unmapped when the TLB is flushed. The
+//              kernel's own text, data and heap are the Linux program's, so they must
+//              sit below 4GB (REG_PTBR0 and the like are 32 bits): build with -no-pie.
+//   Traps      A trap runs the handler from REG_VECTOR_BASE on the kernel stack, with
+//              the UserContext at its top, as the hardware does.
+//   Time       The clock counts cycles: one per user step, one per trap. TRAP_CLOCK
+//              comes every tick_cycles cycles; the disk and the terminals finish
+//              after a number of cycles too. Pause() skips to the next interrupt.
+//   Timings    Host nanoseconds from each trap until the machine is back in user mode,
+//              for any process. So a call that blocks is charged for the switch away
+//              from it, and the one back to it is charged to whatever trap made it.
+//   Replay     With config.record, every trap is written to TRAPS as it is taken:
+//              cycle, tick, vector and code, and the interrupted program, pc and
+//              regs[0..3] (a system call's arguments). The kernel's counters follow
+//              when it halts. With config.replay, the interrupts come from TRAPS
+//              instead, at the recorded cycles, whatever the devices' timing; each
+//              trap taken is checked against the one recorded. At the first that
+//              differs (the run has diverged, say because a new scheduler picked
+//              another process), the devices take over again. The report says where
+//              that was, and how the kernel's counters differ from the recording's.
+//
+// As in the emulator, a TLB flush leaves the kernel stack alone while the kernel runs
+// on it; a KernelContextSwitch() reloads it. (HandleFork() counts on that: it changes
+// address spaces, kernel stack included, in the middle of a system call.)
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <malloc.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "hosted/Machine.h"
+#include "include/load_info.h"
+#include "Counters.h"
+
+// What SetKernelData() is told: the kernel's text and data fill the bottom of region
+// 0, so that their frames stay out of use as they would in the emulator.
+#define KERNEL_TEXT_FRAMES 8
+#define KERNEL_DATA_FRAMES 8
+
+#define WINDOW_BASE  (KERNEL_STACK_BASE - PAGESIZE) // A guard page, to catch overflows.
+#define WINDOW_LIMIT VMEM_1_LIMIT
+#define KCS_STACK    (256 * 1024)
+#define MAX_INPUTS   64
+#define SUCCESS      0 // As in KernelGlobals.h.
+#define TRAPS_MAGIC  0x59545250 // "YTRP"
+
+#define USER_IMAGE ((hosted_image_t*) VMEM_1_BASE)
+#define USER_DATA  ((hosted_data_t*) (VMEM_1_BASE + PAGESIZE))
+
+// The kernel's UserContext, at the top of the kernel stack.
+#define TRAP_CONTEXT \
+  ((UserContext*) (KERNEL_STACK_LIMIT - ((sizeof(UserContext) + 15) & ~15)))
+
+typedef void trap_handler_t(UserContext*);
+
+typedef struct {
+  long      calls;
+  long long ns;
+  long long max_ns;
+} trap_time_t;
+
+// TRAPS is a trap_log_t, then its records.
+typedef struct {
+  int magic;                    // TRAPS_MAGIC once the kernel has halted.
+  int records;
+  int pmem_size, tick_cycles, disk_cycles, tty_byte_cycles, iterations;
+  int counters[NUM_COUNTERS];   // The kernel's, when it halted.
+} trap_log_t;
+
+typedef struct {
+  long          cycle;
+  long          tick;
+  int           vector;
+  int           code;
+  char          program[HOSTED_NAME]; // The current process's.
+  unsigned long pc;
+  unsigned long regs[4];
+} trap_record_t;
+
+typedef struct {
+  long when;
+  int  tty;
+  int  length;
+  char line[TERMINAL_MAX_LINE];
+} tty_input_t;
+
+static machine_config_t   config;
+static hosted_program_t*  programs;
+static int                failed;
+
+// Memory.
+static int  pmem_fd;
+static char tlb[NUM_VPN];       // Pages mapped on the host.
+static int  on_kernel_stack;    // Flushes spare the kernel stack while set.
+static unsigned int regs[REG_PTLR1 + 1];
+
+// CPU.
+static UserContext user;        // Registers, in user mode.
+static ucontext_t  cpu_context; // Where the kernel returns to user mode.
+static ucontext_t  trap_context;
+static ucontext_t  kcs_context;
+static KernelContext kcs_saved;
+static char        kcs_stack[KCS_STACK];
+static KCSFunc_t*  kcs_func;
+static void*       kcs_args[2];
+static char**      boot_args;
+
+// Time and devices.
+static long        now;
+static long        next_tick;
+static long        ticks;
+static long        tty_done[NUM_TERMINALS];  // Cycle a transmit finishes, or 0.
+static int         tty_log[NUM_TERMINALS];
+static tty_input_t inputs[MAX_INPUTS];
+static int         num_inputs;
+static tty_input_t tty_line[NUM_TERMINALS];  // Lines TtyReceive() will hand over.
+static long        disk_done;
+static int         disk_op, disk_sector;
+static void*       disk_buffer;
+static int         disk_fd;
+static FILE*       trace;
+
+// Statistics.
+static trap_time_t call_times[HIST_CALLS];      // TRAP_KERNEL, by syscall_hist_t index.
+static trap_time_t trap_times[TRAP_VECTOR_SIZE];
+static long        refills, flushes, switches;
+static struct timespec run_start;
+
+// Recording and replay.
+extern int         counters[NUM_COUNTERS];      // The kernel's (KernelGlobals.h).
+static FILE*       trap_file;                   // Being recorded.
+static int         traps_taken;
+static trap_log_t  replay_log;                  // Being replayed, and its records.
+static trap_record_t* recorded;
+static int         replaying;                   // Until the run diverges.
+static int         replayed;                    // Records matched so far.
+static char        divergence[512];
+
+static void Fatal(char* format, ...);
+static void Report(void);
+static int  Interrupt(void);
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Memory.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// The page table entry for vpn, or NULL if it is past the table's limit.
+static struct pte* PageTableEntry(int vpn) {
+  int r1_vpn = vpn - (VMEM_1_BASE >> PAGESHIFT);
+  if( r1_vpn < 0 ) {
+    return (unsigned int) vpn < regs[REG_PTLR0] ? (struct pte*) (uintptr_t) regs[REG_PTBR0] + vpn : NULL;
+  }
+  return (unsigned int) r1_vpn < regs[REG_PTLR1] ? (struct pte*) (uintptr_t) regs[REG_PTBR1] + r1_vpn : NULL;
+}
+
+static int HostProt(int prot) {
+  if( prot & PROT_WRITE ) {
+    return PROT_READ | PROT_WRITE;
+  }
+  return prot & (PROT_READ | PROT_EXEC) ? PROT_READ : PROT_NONE;
+}
+
+// Maps page vpn as its page table entry says (or one to one, before virtual memory is
+// enabled). Returns SUCCESS, or ERROR if it is invalid.
+static int Refill(int vpn) {
+  int pfn  = vpn;
+  int prot = PROT_READ | PROT_WRITE;
+  if( regs[REG_VM_ENABLE] ) {
+    struct pte* pte = PageTableEntry(vpn);
+    if( pte == NULL || !pte->valid ) {
+      return ERROR;
+    }
+    pfn  = pte->pfn;
+    prot = pte->prot;
+  }
+  if( ((long) pfn << PAGESHIFT) >= config.pmem_size ) {
+    return ERROR;
+  }
+  if( MAP_FAILED == mmap((void*) ((long) vpn << PAGESHIFT), PAGESIZE, HostProt(prot),
+			 MAP_SHARED | MAP_FIXED, pmem_fd, (off_t) pfn << PAGESHIFT) ) {
+    return ERROR;
+  }
+  tlb[vpn] = 1;
+  refills++;
+  return SUCCESS;
+}
+
+// Unmaps pages [first, limit).
+static void Drop(int first, int limit) {
+  int vpn;
+  for(vpn = first; vpn < limit && !tlb[vpn]; vpn++) {
+  }
+  if( vpn == limit ) {
+    return;
+  }
+  mmap((void*) ((long) first << PAGESHIFT), (long) (limit - first) << PAGESHIFT, PROT_NONE,
+       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+  memset(tlb + first, 0, limit - first);
+}
+
+#define STACK_FIRST (KERNEL_STACK_BASE >> PAGESHIFT)
+#define STACK_LIMIT (KERNEL_STACK_LIMIT >> PAGESHIFT)
+#define R1_FIRST    (VMEM_1_BASE >> PAGESHIFT)
+#define R1_LIMIT    (VMEM_1_LIMIT >> PAGESHIFT)
+
+static void FlushTLB(int what) {
+  flushes++;
+  if( what == TLB_FLUSH_ALL || what == TLB_FLUSH_0 ) {
+    if( !on_kernel_stack ) {
+      Drop(STACK_FIRST, STACK_LIMIT);
+    }
+  }
+  if( what == TLB_FLUSH_ALL || what == TLB_FLUSH_1 ) {
+    Drop(R1_FIRST, R1_LIMIT);
+  }
+  if( what >= 0 ) {
+    int vpn = (unsigned int) what >> PAGESHIFT;
+    if( vpn >= STACK_FIRST && vpn < R1_LIMIT && !(vpn < STACK_LIMIT && on_kernel_stack) ) {
+      Drop(vpn, vpn + 1);
+    }
+  }
+}
+
+// The TLB miss handler. Anything else is a crash: of the kernel if it is in the
+// window, of the Linux program if not.
+static void Fault(int signal_number, siginfo_t* info, void* context) {
+  (void) signal_number;
+  (void) context;
+  unsigned long addr = (unsigned long) info->si_addr;
+  if( addr >= KERNEL_STACK_BASE && addr < WINDOW_LIMIT && !tlb[addr >> PAGESHIFT] &&
+      Refill(addr >> PAGESHIFT) == SUCCESS ) {
+    return;
+  }
+  if( addr >= WINDOW_BASE && addr < KERNEL_STACK_BASE ) {
+    Fatal("kernel stack overflow (at %p)", (void*) addr);
+  }
+  if( addr >= WINDOW_BASE && addr < WINDOW_LIMIT ) {
+    Fatal("kernel touched %p, which is %s", (void*) addr,
+	  tlb[addr >> PAGESHIFT] ? "read-only" : "not mapped");
+  }
+  signal(SIGSEGV, SIG_DFL); // Crash where it happened.
+}
+
+// Whether user mode may touch addr (for writing, if write).
+static int UserMay(unsigned long addr, int write) {
+  if( addr < VMEM_1_BASE || addr >= VMEM_1_LIMIT ) {
+    return 0;
+  }
+  struct pte* pte = PageTableEntry(addr >> PAGESHIFT);
+  return pte != NULL && pte->valid && (pte->prot & (write ? PROT_WRITE : PROT_READ));
+}
+
+// read() does not fault, so LoadProgram()'s reads into region 1 would fail with EFAULT
+// where the TLB has yet to see the page. Links with -Wl,--wrap=read.
+ssize_t __real_read(int fd, void* buffer, size_t count);
+ssize_t __wrap_read(int fd, void* buffer, size_t count) {
+  unsigned long page;
+  for(page = DOWN_TO_PAGE(buffer); page < (unsigned long) buffer + count; page += PAGESIZE) {
+    if( page >= KERNEL_STACK_BASE && page < WINDOW_LIMIT && !tlb[page >> PAGESHIFT] &&
+	Refill(page >> PAGESHIFT) != SUCCESS ) {
+      errno = EFAULT;
+      return -1;
+    }
+  }
+  return __real_read(fd, buffer, count);
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Recording and replay.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+static code_name_t syscall_names[] = { SYSCALL_NAMES, { 0, NULL } };
+static code_name_t custom_names[]  = { CUSTOM_NAMES,  { 0, NULL } };
+static char* trap_names[TRAP_VECTOR_SIZE] = {
+  "TRAP_KERNEL", "TRAP_CLOCK", "TRAP_ILLEGAL", "TRAP_MEMORY", "TRAP_MATH",
+  "TRAP_TTY_RECEIVE", "TRAP_TTY_TRANSMIT", "TRAP_DISK"
+};
+
+static char* Lookup(code_name_t* names, int code) {
+  for(; names->name != NULL; names++) {
+    if( names->code == code ) {
+      return names->name;
+    }
+  }
+  return "?";
+}
+
+// Whether vector is an interrupt (which replay delivers) rather than something the
+// current process did.
+static int IsInterrupt(int vector) {
+  return vector == TRAP_CLOCK || vector == TRAP_TTY_RECEIVE || vector == TRAP_TTY_TRANSMIT ||
+    vector == TRAP_DISK;
+}
+
+static void Describe(char* text, int size, trap_record_t* r) {
+  char* name = r->vector >= 0 && r->vector < TRAP_VECTOR_SIZE && trap_names[r->vector] != NULL ?
+    trap_names[r->vector] : "TRAP_?";
+  if( r->vector == TRAP_KERNEL ) {
+    name = (r->code == (int) YALNIX_CUSTOM_0 && (r->regs[0] & CUSTOM_CODE_MASK) < CUSTOM_CODES) ?
+      Lookup(custom_names, r->regs[0] & CUSTOM_CODE_MASK) : Lookup(syscall_names, r->code);
+  }
+  snprintf(text, size, "%s (code 0x%x) at cycle %ld, tick %ld, in %s at step %ld, "
+	   "regs 0x%lx 0x%lx 0x%lx 0x%lx", name, r->code, r->cycle, r->tick, r->program,
+	   (r->pc - VMEM_1_BASE) / STEP_SIZE, r->regs[0], r->regs[1], r->regs[2], r->regs[3]);
+}
+
+static void MakeRecord(trap_record_t* r, int vector, int code) {
+  memset(r, 0, sizeof(*r));
+  r->cycle  = now;
+  r->tick   = ticks;
+  r->vector = vector;
+  r->code   = code;
+  strcpy(r->program, "?");
+  if( UserMay(VMEM_1_BASE, 0) && USER_IMAGE->magic == HOSTED_MAGIC ) {
+    strncpy(r->program, USER_IMAGE->name, HOSTED_NAME - 1);
+  }
+  r->pc = (unsigned long) user.pc;
+  int i;
+  for(i = 0; i < 4; i++) {
+    r->regs[i] = user.regs[i];
+  }
+}
+
+// The run no longer follows the recording: say where, and let the devices take over.
+static void Diverged(trap_record_t* got) {
+  char expected[256], taken[256];
+  if( replayed < replay_log.records ) {
+    Describe(expected, sizeof(expected), &recorded[replayed]);
+  } else {
+    strcpy(expected, "the kernel's halt");
+  }
+  if( got != NULL ) {
+    Describe(taken, sizeof(taken), got);
+  } else {
+    snprintf(taken, sizeof(taken), "the kernel's halt at cycle %ld, tick %ld", now, ticks);
+  }
+  snprintf(divergence, sizeof(divergence), "diverged at trap %d of %d:\n    recorded %s\n"
+	   "    taken    %s", replayed + 1, replay_log.records, expected, taken);
+  replaying = 0;
+  next_tick = (now / config.tick_cycles + 1) * config.tick_cycles;
+}
+
+// Called for every trap, before the kernel sees it.
+static void TrapTaken(int vector, int code) {
+  trap_record_t r;
+  if( trap_file == NULL && !replaying ) {
+    return;
+  }
+  MakeRecord(&r, vector, code);
+  if( trap_file != NULL && fwrite(&r, sizeof(r), 1, trap_file) != 1 ) {
+    Fatal("cannot write TRAPS");
+  }
+  traps_taken++;
+  if( replaying ) {
+    trap_record_t* want = &recorded[replayed];
+    if( replayed == replay_log.records || want->cycle != r.cycle || want->vector != r.vector ||
+	want->code != r.code || want->pc != r.pc || strcmp(want->program, r.program) != 0 ||
+	memcmp(want->regs, r.regs, sizeof(r.regs)) != 0 ) {
+      Diverged(&r);
+    } else {
+      replayed++;
+    }
+  }
+}
+
+// Opens TRAPS for config.record, or reads it for config.replay.
+static void TrapsOpen(void) {
+  trap_log_t want = { 0, 0, config.pmem_size, config.tick_cycles, config.disk_cycles,
+		      config.tty_byte_cycles, config.iterations };
+  if( config.replay ) {
+    FILE* file = fopen("TRAPS", "r");
+    if( file == NULL || fread(&replay_log, sizeof(replay_log), 1, file) != 1 ||
+	replay_log.magic != TRAPS_MAGIC ) {
+      Fatal("no complete recording in TRAPS (record one with -r)");
+    }
+    if( replay_log.pmem_size != want.pmem_size || replay_log.tick_cycles != want.tick_cycles ||
+	replay_log.disk_cycles != want.disk_cycles ||
+	replay_log.tty_byte_cycles != want.tty_byte_cycles || replay_log.iterations != want.iterations ) {
+      Fatal("TRAPS was recorded with other options (-n %d -c %d -d %d -t %d -m %d)",
+	    replay_log.iterations, replay_log.tick_cycles, replay_log.disk_cycles,
+	    replay_log.tty_byte_cycles, replay_log.pmem_size);
+    }
+    recorded = (trap_record_t*) malloc((replay_log.records + 1) * sizeof(trap_record_t));
+    assert(recorded);
+    if( fread(recorded, sizeof(trap_record_t), replay_log.records, file) != (size_t) replay_log.records ) {
+      Fatal("TRAPS is cut short");
+    }
+    fclose(file);
+    replaying = 1;
+  }
+  if( config.record ) {
+    // The header is rewritten, with the magic number, when the kernel halts.
+    trap_file = fopen("TRAPS", "w");
+    if( trap_file == NULL || fwrite(&want, sizeof(want), 1, trap_file) != 1 ) {
+      Fatal("cannot write TRAPS");
+    }
+  }
+}
+
+// Called when the kernel halts: finishes TRAPS, or reports on the replay.
+static void TrapsClose(void) {
+  if( trap_file != NULL ) {
+    trap_log_t log = { TRAPS_MAGIC, traps_taken, config.pmem_size, config.tick_cycles,
+		       config.disk_cycles, config.tty_byte_cycles, config.iterations };
+    memcpy(log.counters, counters, sizeof(log.counters));
+    if( fseek(trap_file, 0, SEEK_SET) != 0 || fwrite(&log, sizeof(log), 1, trap_file) != 1 ||
+	fclose(trap_file) != 0 ) {
+      Fatal("cannot write TRAPS");
+    }
+    trap_file = NULL;
+  }
+  if( !config.replay ) {
+    return;
+  }
+  if( replaying && replayed < replay_log.records ) {
+    Diverged(NULL);
+  }
+  if( divergence[0] != '\0' ) {
+    printf("hosted %s: replay %s\n", config.name, divergence);
+  } else {
+    printf("hosted %s: replay matched all %d traps\n", config.name, replay_log.records);
+  }
+  printf("  %-32s %10s %10s %10s\n", "counter", "recorded", "replayed", "delta");
+  int differ = 0;
+#define X(id, name)							\
+  if( counters[COUNTER_##id] != replay_log.counters[COUNTER_##id] ) {	\
+    printf("  %-32s %10d %10d %+10d\n", name, replay_log.counters[COUNTER_##id], \
+	   counters[COUNTER_##id], counters[COUNTER_##id] - replay_log.counters[COUNTER_##id]); \
+    differ = 1;								\
+  }
+  COUNTER_LIST
+#undef X
+  if( !differ ) {
+    printf("  (no counter differs)\n");
+  }
+  fflush(stdout);
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Registers, traps and context switches.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+void WriteRegister(int which, unsigned int value) {
+  if( which < REG_VECTOR_BASE || which > REG_PTLR1 ) {
+    Fatal("WriteRegister(%d): no such register", which);
+  }
+  if( which == REG_TLB_FLUSH ) {
+    FlushTLB((int) value);
+    return;
+  }
+  regs[which] = value;
+  if( which == REG_VM_ENABLE ) {
+    FlushTLB(TLB_FLUSH_ALL);
+  }
+}
+
+unsigned int ReadRegister(int which) {
+  if( which < REG_VECTOR_BASE || which > REG_PTLR1 ) {
+    Fatal("ReadRegister(%d): no such register", which);
+  }
+  return regs[which];
+}
+
+static void TrapEntry(void) {
+  trap_handler_t** vector = (trap_handler_t**) (uintptr_t) regs[REG_VECTOR_BASE];
+  vector[TRAP_CONTEXT->vector](TRAP_CONTEXT);
+}
+
+static void BootEntry(void) {
+  KernelStart(boot_args, config.pmem_size, TRAP_CONTEXT);
+}
+
+// Runs entry in kernel mode, on the kernel stack, until some process returns to user
+// mode. Returns the host nanoseconds that took.
+static long long KernelEnter(void (*entry)(void)) {
+  *TRAP_CONTEXT = user;
+  getcontext(&trap_context);
+  trap_context.uc_stack.ss_sp   = (void*) KERNEL_STACK_BASE;
+  trap_context.uc_stack.ss_size = (char*) TRAP_CONTEXT - (char*) KERNEL_STACK_BASE;
+  trap_context.uc_link          = &cpu_context;
+  makecontext(&trap_context, entry, 0);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  on_kernel_stack = 1;
+  swapcontext(&cpu_context, &trap_context);
+  on_kernel_stack = 0;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  user = *TRAP_CONTEXT;
+  now++;
+  return (end.tv_sec - start.tv_sec) * 1000000000LL + end.tv_nsec - start.tv_nsec;
+}
+
+static void Trap(int vector, int code, void* addr) {
+  user.vector = vector;
+  user.code   = code;
+  user.addr   = addr;
+  int call = -1;
+  if( vector == TRAP_KERNEL ) {
+    call = code & YALNIX_MASK;
+    if( code == (int) YALNIX_CUSTOM_0 && (user.regs[0] & CUSTOM_CODE_MASK) < CUSTOM_CODES ) {
+      call = HIST_CUSTOM_BASE + (user.regs[0] & CUSTOM_CODE_MASK);
+    }
+  }
+
+  TrapTaken(vector, code);
+  long long ns = KernelEnter(TrapEntry);
+
+  trap_time_t* t = call >= 0 ? &call_times[call] : &trap_times[vector];
+  t->calls++;
+  t->ns += ns;
+  if( ns > t->max_ns ) {
+    t->max_ns = ns;
+  }
+}
+
+static void KernelContextSwitchEntry(void) {
+  on_kernel_stack = 0;
+  KernelContext* next = kcs_func(&kcs_saved, kcs_args[0], kcs_args[1]);
+
+  // The kernel stack is now whichever one region 0's page table names.
+  Drop(STACK_FIRST, STACK_LIMIT);
+  on_kernel_stack = 1;
+  switches++;
+
+  // A copied context still points at the original's floating point state.
+  next->uc_mcontext.fpregs = &next->__fpregs_mem;
+  setcontext(next);
+}
+
+int KernelContextSwitch(KCSFunc_t* func, void* p1, void* p2) {
+  if( !on_kernel_stack ) {
+    return -1; // Only the kernel, on its stack, may switch.
+  }
+  kcs_func    = func;
+  kcs_args[0] = p1;
+  kcs_args[1] = p2;
+  getcontext(&kcs_context);
+  kcs_context.uc_stack.ss_sp   = kcs_stack;
+  kcs_context.uc_stack.ss_size = KCS_STACK;
+  kcs_context.uc_link          = NULL;
+  makecontext(&kcs_context, KernelContextSwitchEntry, 0);
+  if( swapcontext(&kcs_saved, &kcs_context) != 0 ) {
+    return -1;
+  }
+  return 0;
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Devices.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+void TtyTransmit(int tty_id, void* buffer, int length) {
+  if( tty_id < 0 || tty_id >= NUM_TERMINALS || tty_done[tty_id] != 0 ) {
+    Fatal("TtyTransmit(%d) while the terminal is busy or absent", tty_id);
+  }
+  if( tty_log[tty_id] == 0 ) {
+    char name[16];
+    snprintf(name, sizeof(name), "TTYLOG.%d", tty_id);
+    tty_log[tty_id] = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if( tty_log[tty_id] > 0 && write(tty_log[tty_id], buffer, length) != length ) {
+    Fatal("TtyTransmit(%d): cannot write TTYLOG", tty_id);
+  }
+  tty_done[tty_id] = now + (length > 0 ? length : 1) * (long) config.tty_byte_cycles;
+}
+
+int TtyReceive(int tty_id, void* buffer, int length) {
+  if( tty_id < 0 || tty_id >= NUM_TERMINALS ) {
+    return 0;
+  }
+  tty_input_t* line = &tty_line[tty_id];
+  int n = line->length < length ? line->length : length;
+  memcpy(buffer, line->line, n);
+  line->length = 0;
+  return n;
+}
+
+void DiskAccess(int op, int sector, void* buffer) {
+  if( disk_done != 0 || sector < 0 || sector >= NUMSECTORS ) {
+    Fatal("DiskAccess(%d, %d) while the disk is busy, or out of range", op, sector);
+  }
+  disk_op     = op;
+  disk_sector = sector;
+  disk_buffer = buffer;
+  disk_done   = now + config.disk_cycles;
+}
+
+// Cycle of the next interrupt.
+static long NextInterrupt(void) {
+  int i;
+  if( replaying && replayed < replay_log.records ) {
+    for(i = replayed; i < replay_log.records && !IsInterrupt(recorded[i].vector); i++) {
+    }
+    // With none left, only the current process's traps remain (and would diverge).
+    return i < replay_log.records ? recorded[i].cycle : LONG_MAX / 2;
+  }
+  long next = next_tick;
+  for(i = 0; i < NUM_TERMINALS; i++) {
+    if( tty_done[i] != 0 && tty_done[i] < next ) {
+      next = tty_done[i];
+    }
+  }
+  for(i = 0; i < num_inputs; i++) {
+    if( inputs[i].when < next && tty_line[inputs[i].tty].length == 0 ) {
+      next = inputs[i].when;
+    }
+  }
+  if( disk_done != 0 && disk_done < next ) {
+    next = disk_done;
+  }
+  return next;
+}
+
+// What the devices do as they interrupt. Each returns ERROR if the device has nothing
+// to interrupt for (which only a replay asks of it).
+
+static int DiskDone(void) {
+  if( disk_done == 0 ) {
+    return ERROR;
+  }
+  off_t offset = (off_t) disk_sector * SECTORSIZE;
+  int   done   = disk_op == DISK_READ ?
+    pread(disk_fd, disk_buffer, SECTORSIZE, offset) :
+    pwrite(disk_fd, disk_buffer, SECTORSIZE, offset);
+  if( done != SECTORSIZE ) {
+    Fatal("disk: cannot %s sector %d", disk_op == DISK_READ ? "read" : "write", disk_sector);
+  }
+  disk_done = 0;
+  return SUCCESS;
+}
+
+static int TransmitDone(int tty) {
+  if( tty < 0 || tty >= NUM_TERMINALS || tty_done[tty] == 0 ) {
+    return ERROR;
+  }
+  tty_done[tty] = 0;
+  return SUCCESS;
+}
+
+// Hands the first line typed on tty over to TtyReceive().
+static int LineTyped(int tty) {
+  int i;
+  for(i = 0; i < num_inputs && inputs[i].tty != tty; i++) {
+  }
+  if( i == num_inputs || tty_line[tty].length != 0 ) {
+    return ERROR;
+  }
+  tty_line[tty] = inputs[i];
+  inputs[i] = inputs[--num_inputs];
+  return SUCCESS;
+}
+
+static void Tick(void) {
+  if( ++ticks > config.max_ticks ) {
+    Fatal("no end after %d ticks", config.max_ticks);
+  }
+}
+
+// Raises the next recorded interrupt, if it is due. Returns 1 if it did.
+static int ReplayInterrupt(void) {
+  if( NextInterrupt() > now ) {
+    return 0;
+  }
+  int i;
+  for(i = replayed; !IsInterrupt(recorded[i].vector); i++) {
+  }
+  trap_record_t* r = &recorded[i];
+  if( i != replayed ) {
+    // The current process was to have trapped first, but has run on.
+    trap_record_t late;
+    MakeRecord(&late, r->vector, r->code);
+    Diverged(&late);
+    return Interrupt();
+  }
+  int ready = SUCCESS;
+  switch( r->vector ) {
+  case TRAP_DISK:         ready = DiskDone();          break;
+  case TRAP_TTY_TRANSMIT: ready = TransmitDone(r->code); break;
+  case TRAP_TTY_RECEIVE:  ready = LineTyped(r->code);  break;
+  case TRAP_CLOCK:        Tick();                      break;
+  }
+  if( ready != SUCCESS ) {
+    trap_record_t idle;
+    MakeRecord(&idle, r->vector, r->code);
+    Diverged(&idle);
+    strncat(divergence, " (but the device is idle)", sizeof(divergence) - strlen(divergence) - 1);
+    return Interrupt();
+  }
+  Trap(r->vector, r->code, NULL);
+  return 1;
+}
+
+// Raises one interrupt that is due, if any. Returns 1 if it did.
+static int Interrupt(void) {
+  if( replaying && replayed < replay_log.records ) {
+    return ReplayInterrupt();
+  }
+  if( NextInterrupt() > now ) {
+    return 0;
+  }
+  int i;
+  if( disk_done != 0 && disk_done <= now ) {
+    DiskDone();
+    Trap(TRAP_DISK, 0, NULL);
+    return 1;
+  }
+  for(i = 0; i < NUM_TERMINALS; i++) {
+    if( tty_done[i] != 0 && tty_done[i] <= now ) {
+      TransmitDone(i);
+      Trap(TRAP_TTY_TRANSMIT, i, NULL);
+      return 1;
+    }
+  }
+  for(i = 0; i < num_inputs; i++) {
+    if( inputs[i].when <= now && tty_line[inputs[i].tty].length == 0 ) {
+      int tty = inputs[i].tty;
+      tty_line[tty] = inputs[i];
+      inputs[i] = inputs[--num_inputs];
+      Trap(TRAP_TTY_RECEIVE, tty, NULL);
+      return 1;
+    }
+  }
+  next_tick += config.tick_cycles;
+  Tick();
+  Trap(TRAP_CLOCK, 0, NULL);
+  return 1;
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Program files.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+void MachineWritePrograms(hosted_program_t* programs) {
+  char* pages = (char*) calloc(2, PAGESIZE);
+  hosted_image_t* image = (hosted_image_t*) pages;
+  for(; programs->name != NULL; programs++) {
+    image->magic = HOSTED_MAGIC;
+    strncpy(image->name, programs->name, HOSTED_NAME - 1);
+    int fd = open(programs->name, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if( fd < 0 || write(fd, pages, 2 * PAGESIZE) != 2 * PAGESIZE ) {
+      Fatal("cannot write program %s", programs->name);
+    }
+    close(fd);
+  }
+  free(pages);
+}
+
+// The loader's stand-in: every hosted program is one page of text and one of data.
+int LoadInfo(int fd, struct load_info* li) {
+  hosted_image_t image;
+  if( pread(fd, &image, sizeof(image), 0) != sizeof(image) || image.magic != HOSTED_MAGIC ) {
+    return LI_FORMAT_ERROR;
+  }
+  memset(li, 0, sizeof(*li));
+  li->entry    = VMEM_1_BASE;
+  li->t_faddr  = 0;
+  li->t_vaddr  = VMEM_1_BASE;
+  li->t_npg    = 1;
+  li->t_end    = VMEM_1_BASE + PAGESIZE;
+  li->id_faddr = PAGESIZE;
+  li->id_vaddr = VMEM_1_BASE + PAGESIZE;
+  li->id_npg   = 1;
+  li->id_end   = VMEM_1_BASE + 2 * PAGESIZE;
+  li->ud_vaddr = li->id_end;
+  li->ud_npg   = 0;
+  li->ud_end   = li->id_end;
+  return LI_NO_ERROR;
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// User mode.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+#define RESUMED    1 // Low bit of pc: the step's trap has returned.
+
+static void StepFailed(int index, char* why) {
+  fprintf(stderr, "hosted %s: FAIL: %s, step %d of %s\n", config.name, why, index,
+	  USER_IMAGE->name);
+  failed = 1;
+}
+
+// Index of the step that matches steps[index], forward (direction 1) or back (-1):
+// open and close are the ops that nest; match is the op wanted at depth 0.
+static int Match(step_t* steps, int index, int direction, int open, int close, int match) {
+  int depth = 0;
+  int i;
+  for(i = index + direction; i >= 0 && steps[i].op != 0; i += direction) {
+    if( steps[i].op == match && depth == 0 ) {
+      return i;
+    }
+    if( steps[i].op == open ) {
+      depth++;
+    } else if( steps[i].op == close ) {
+      depth--;
+    }
+  }
+  Fatal("%s: unmatched step %d", USER_IMAGE->name, index);
+  return 0;
+}
+
+static unsigned long Arg(step_t* step, int value) {
+  hosted_data_t* data = USER_DATA;
+  int n = value & ~ARG_TAG;
+  switch( value & ARG_TAG ) {
+  case ARG_VAR:   return data->vars[n];
+  case ARG_ADDR:  return (unsigned long) &data->vars[n];
+  case ARG_BUF:   return (unsigned long) &data->buf[n];
+  case ARG_ITERS: return config.iterations;
+  case ARG_STR:
+  case ARG_ARGV:
+    strncpy(data->str, step->str, HOSTED_STR - 1);
+    data->argv[0] = data->str;
+    data->argv[1] = NULL;
+    return (value & ARG_TAG) == ARG_STR ? (unsigned long) data->str : (unsigned long) data->argv;
+  }
+  return (unsigned long) (long) value;
+}
+
+static void Goto(int index) {
+  user.pc = (void*) (VMEM_1_BASE + (long) index * STEP_SIZE);
+}
+
+// Runs one step of the current process.
+static void Step(void) {
+  if( !UserMay(VMEM_1_BASE, 0) || !UserMay(VMEM_1_BASE + PAGESIZE, 1) ||
+      USER_IMAGE->magic != HOSTED_MAGIC ) {
+    Fatal("the current process is not a hosted program");
+  }
+  hosted_program_t* program;
+  for(program = programs; program->name != NULL; program++) {
+    if( strcmp(program->name, USER_IMAGE->name) == 0 ) {
+      break;
+    }
+  }
+  if( program->name == NULL ) {
+    Fatal("no program %s", USER_IMAGE->name);
+  }
+  step_t*        steps   = program->steps;
+  hosted_data_t* data    = USER_DATA;
+  long           pc      = (long) user.pc - VMEM_1_BASE;
+  int            index   = pc / STEP_SIZE;
+  int            resumed = pc & RESUMED;
+  step_t*        step    = &steps[index];
+  now++;
+
+  if( resumed ) {
+    // Back from a trap (Fork()'s returns twice, once in each process).
+    if( step->op == STEP_FORK ) {
+      if( (int) user.regs[0] == ERROR ) {
+	StepFailed(index, "Fork() failed");
+      }
+      Goto(user.regs[0] == 0 ? index + 1 :
+	   Match(steps, index, 1, STEP_FORK, STEP_JOIN, STEP_PARENT) + 1);
+    } else {
+      Goto(index + 1);
+    }
+    return;
+  }
+
+  int i;
+  switch( step->op ) {
+  case STEP_CALL:
+    for(i = 0; i < 4; i++) {
+      user.regs[i] = Arg(step, step->a[i + 1]);
+    }
+    user.pc = (void*) (VMEM_1_BASE + pc + RESUMED);
+    Trap(TRAP_KERNEL, step->a[0], NULL);
+    return;
+  case STEP_FORK:
+    user.pc = (void*) (VMEM_1_BASE + pc + RESUMED);
+    Trap(TRAP_KERNEL, YALNIX_FORK, NULL);
+    return;
+  case STEP_EXIT:
+    user.regs[0] = Arg(step, step->a[0]);
+    Trap(TRAP_KERNEL, YALNIX_EXIT, NULL);
+    return;
+  case STEP_TRAP:
+    user.pc = (void*) (VMEM_1_BASE + pc + RESUMED);
+    Trap(step->a[0], step->a[1], NULL);
+    return;
+
+  case STEP_SAVE:
+    data->vars[step->a[0]] = user.regs[0];
+    break;
+  case STEP_EXPECT:
+    if( (int) user.regs[0] != (int) Arg(step, step->a[0]) ) {
+      StepFailed(index - 1, "unexpected result");
+    }
+    break;
+  case STEP_OK:
+    if( (int) user.regs[0] == ERROR ) {
+      StepFailed(index - 1, "ERROR");
+    }
+    break;
+  case STEP_REPEAT:
+    if( data->depth == HOSTED_LOOPS ) {
+      Fatal("%s: loops nest too deep", USER_IMAGE->name);
+    }
+    data->loop_left[data->depth++] = (int) Arg(step, step->a[0]) > 0 ? (int) Arg(step, step->a[0]) : -1;
+    break;
+  case STEP_END:
+    if( data->loop_left[data->depth - 1] < 0 || --data->loop_left[data->depth - 1] > 0 ) {
+      Goto(Match(steps, index, -1, STEP_END, STEP_REPEAT, STEP_REPEAT) + 1);
+      return;
+    }
+    data->depth--;
+    break;
+  case STEP_PARENT:
+    // The child's part is done.
+    Goto(Match(steps, index, 1, STEP_FORK, STEP_JOIN, STEP_JOIN) + 1);
+    return;
+  case STEP_JOIN:
+    break;
+  case STEP_SPIN:
+    {
+      long left = Arg(step, step->a[0]) - data->spun;
+      long run  = NextInterrupt() - now;
+      if( run < left ) {
+	now += run > 0 ? run : 0;
+	data->spun += run > 0 ? run : 0;
+	return;
+      }
+      now += left;
+      data->spun = 0;
+    }
+    break;
+  case STEP_GROW:
+    if( data->grown < (int) Arg(step, step->a[0]) ) {
+      unsigned long addr = DOWN_TO_PAGE(user.sp) - (data->grown + 1) * PAGESIZE;
+      if( !UserMay(addr, 1) ) {
+	struct pte* pte = PageTableEntry(addr >> PAGESHIFT);
+	Trap(TRAP_MEMORY, pte != NULL && pte->valid ? YALNIX_ACCERR : YALNIX_MAPERR, (void*) addr);
+	return; // And try again.
+      }
+      *(char*) addr = 1;
+      data->grown++;
+      return;
+    }
+    data->grown = 0;
+    break;
+  case STEP_INPUT:
+    if( num_inputs == MAX_INPUTS ) {
+      Fatal("too much terminal input at once");
+    }
+    inputs[num_inputs].when   = now + step->a[1];
+    inputs[num_inputs].tty    = step->a[0];
+    inputs[num_inputs].length = strlen(step->str);
+    strncpy(inputs[num_inputs].line, step->str, TERMINAL_MAX_LINE);
+    num_inputs++;
+    break;
+  case STEP_PAUSE:
+    now = NextInterrupt();
+    break;
+  default:
+    Fatal("%s: no step %d (op %d)", USER_IMAGE->name, index, step->op);
+  }
+  Goto(index + 1);
+}
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// The rest of hardware.h, and the run.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+void TracePrintf(int level, char* format, ...) {
+  if( trace != NULL && level <= config.trace_level ) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(trace, format, args);
+    va_end(args);
+  }
+}
+
+// The kernel halts when init exits. Any other halt is a failure, as is init's exiting
+// with other than 0.
+void Halt(void) {
+  // The trap init entered the kernel with is at the top of its kernel stack (the
+  // machine's last trap may be a later one, if Exit() waited for the devices).
+  if( TRAP_CONTEXT->vector != TRAP_KERNEL || TRAP_CONTEXT->code != (int) YALNIX_EXIT ) {
+    fprintf(stderr, "hosted %s: FAIL: the kernel halted in trap %d (code 0x%x); see TRACE\n",
+	    config.name, TRAP_CONTEXT->vector, TRAP_CONTEXT->code);
+    failed = 1;
+  } else if( TRAP_CONTEXT->regs[0] != 0 ) {
+    fprintf(stderr, "hosted %s: FAIL: init exited with %d\n", config.name, (int) TRAP_CONTEXT->regs[0]);
+    failed = 1;
+  }
+  Report();
+  TrapsClose();
+  exit(failed ? 1 : 0);
+}
+
+static void Fatal(char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "hosted %s: FAIL: ", config.name);
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  if( trace != NULL ) {
+    fflush(trace);
+  }
+  _exit(1);
+}
+
+static void ReportLine(char* name, trap_time_t* t) {
+  if( t->calls == 0 ) {
+    return;
+  }
+  if( config.bench ) {
+    printf("BENCH hosted_%s_%s %.0f ns\n", config.name, name, (double) t->ns / t->calls);
+  } else {
+    printf("  %-16s %10ld %10.0f %10lld\n", name, t->calls, (double) t->ns / t->calls, t->max_ns);
+  }
+}
+
+static void Report(void) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = end.tv_sec - run_start.tv_sec + (end.tv_nsec - run_start.tv_nsec) / 1e9;
+
+  if( !config.bench ) {
+    printf("hosted %s: %ld cycles, %ld ticks, %.3f s; %ld context switches, "
+	   "%ld TLB refills, %ld TLB flushes\n",
+	   config.name, now, ticks, seconds, switches, refills, flushes);
+    printf("  %-16s %10s %10s %10s\n", "trap or call", "count", "ns each", "max ns");
+  }
+  int i;
+  for(i = 0; i < HIST_CALLS; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s", i >= HIST_CUSTOM_BASE ?
+	     Lookup(custom_names, i - HIST_CUSTOM_BASE) : Lookup(syscall_names, i | YALNIX_PREFIX));
+    ReportLine(name, &call_times[i]);
+  }
+  for(i = 0; i < TRAP_VECTOR_SIZE; i++) {
+    ReportLine(trap_names[i] != NULL ? trap_names[i] : "TRAP_?", &trap_times[i]);
+  }
+  fflush(stdout);
+}
+
+void MachineRun(machine_config_t* run_config, hosted_program_t* run_programs, char** cmd_args) {
+  config    = *run_config;
+  programs  = run_programs;
+  boot_args = cmd_args;
+  clock_gettime(CLOCK_MONOTONIC, &run_start);
+
+  // The kernel keeps pointers in 32 bits, so its heap must stay off mmap().
+  mallopt(M_MMAP_MAX, 0);
+  if( (uintptr_t) sbrk(0) > 0xFFFFFFFFUL ) {
+    Fatal("the heap is above 4GB: build with -no-pie");
+  }
+
+  pmem_fd = memfd_create("pmem", 0);
+  if( pmem_fd < 0 || ftruncate(pmem_fd, config.pmem_size) != 0 ) {
+    Fatal("cannot make %d bytes of physical memory", config.pmem_size);
+  }
+  if( (void*) WINDOW_BASE != mmap((void*) WINDOW_BASE, WINDOW_LIMIT - WINDOW_BASE, PROT_NONE,
+				  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE,
+				  -1, 0) ) {
+    Fatal("cannot reserve %p-%p", (void*) WINDOW_BASE, (void*) WINDOW_LIMIT);
+  }
+
+  // The TLB miss handler runs on a stack of its own: the kernel's may be what missed.
+  stack_t alt;
+  alt.ss_sp    = malloc(SIGSTKSZ * 4);
+  alt.ss_size  = SIGSTKSZ * 4;
+  alt.ss_flags = 0;
+  sigaltstack(&alt, NULL);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = Fault;
+  action.sa_flags     = SA_SIGINFO | SA_ONSTACK;
+  sigaction(SIGSEGV, &action, NULL);
+
+  trace   = fopen("TRACE", "w");
+  disk_fd = open("DISK", O_RDWR | O_CREAT, 0644);
+  if( disk_fd < 0 || ftruncate(disk_fd, (off_t) NUMSECTORS * SECTORSIZE) != 0 ) {
+    Fatal("cannot make DISK");
+  }
+
+  SetKernelData((void*) (KERNEL_TEXT_FRAMES * PAGESIZE),
+		(void*) ((KERNEL_TEXT_FRAMES + KERNEL_DATA_FRAMES) * PAGESIZE));
+  TrapsOpen();
+  next_tick = config.tick_cycles;
+  KernelEnter(BootEntry);
+
+  for(;;) {
+    if( !Interrupt() ) {
+      Step();
+    }
+  }
+}
+
+// End of Machine.c
@@ -0,0 +1,128 @@
+// Machine.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// The hosted machine: a stand-in for the Yalnix hardware (hardware.h), so that the
+// kernel runs as an ordinary Linux process, without the DCS 58 libraries. See
+// hosted/Machine.c for how each part of the hardware is modeled, and hosted/Harness.c
+// for the scenarios it runs.
+//
+// User mode is not real code. A hosted program is a list of steps (step_t), which the
+// machine interprets, one step per cycle, for whichever process the kernel has made
+// current. Its state lives where a real program's would, so that Fork() copies it and
+// Exec() replaces it:
+//
+//   pc                  VMEM_1_BASE + STEP_SIZE * (index of the next step)
+//   regs[0]             result of the last system call
+//   page 0 of region 1  the program's text: a hosted_image_t naming it
+//   page 1 of region 1  its data: a hosted_data_t (loop counters, variables, buffers)
+//
+// A program file (written by MachineWritePrograms()) is those two pages; LoadInfo()
+// describes it to LoadProgram() as one page of text and one of data.
+
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include "include/hardware.h"
+#include "include/yalnix.h"
+#include "CustomCalls.h"
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Programs.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+// Steps.
+#define STEP_CALL   1 // System call a[0], with a[1..4] in regs[0..3].
+#define STEP_SAVE   2 // vars[a[0]] = result of the last call.
+#define STEP_EXPECT 3 // Fails the run unless the last call returned a[0].
+#define STEP_OK     4 // Fails the run if the last call returned ERROR.
+#define STEP_REPEAT 5 // Runs the steps up to the matching STEP_END a[0] times (0: forever).
+#define STEP_END    6
+#define STEP_FORK   7 // Fork(). The child runs the steps up to the matching STEP_PARENT,
+#define STEP_PARENT 8 // the parent those from there to the matching STEP_JOIN; both
+#define STEP_JOIN   9 // then go on after it.
+#define STEP_EXIT  10 // Exit(a[0]).
+#define STEP_SPIN  11 // Computes for a[0] cycles.
+#define STEP_GROW  12 // Touches a[0] pages below the stack pointer, faulting if need be.
+#define STEP_TRAP  13 // Raises trap a[0] with code a[1] (e.g., TRAP_ILLEGAL).
+#define STEP_INPUT 14 // Types str on terminal a[0]; it arrives a[1] cycles later.
+#define STEP_PAUSE 15 // Pause(): nothing happens until the next interrupt.
+
+// Arguments. Values with one of these tags are worked out when the step runs.
+#define ARG_TAG   0xFF000000
+#define ARG_VAR   0x7A000000 // ARG_VAR | n:  vars[n].
+#define ARG_ADDR  0x7B000000 // ARG_ADDR | n: &vars[n].
+#define ARG_BUF   0x7C000000 // ARG_BUF | n:  &buf[n].
+#define ARG_STR   0x7D000000 // The step's str, copied to user memory.
+#define ARG_ARGV  0x7E000000 // { str, NULL }, in user memory.
+#define ARG_ITERS 0x7F000000 // The harness's iteration count (-n).
+
+#define HOSTED_VARS  16
+#define HOSTED_BUF   4096
+#define HOSTED_STR   256
+#define HOSTED_LOOPS 8
+#define HOSTED_NAME  32
+
+typedef struct {
+  int   op;
+  int   a[5];
+  char* str;
+} step_t;
+
+typedef struct {
+  char*   name;   // File name; Exec() and the kernel's LoadProgram() use it.
+  step_t* steps;  // Ends with an op of 0.
+} hosted_program_t;
+
+#define HOSTED_MAGIC 0x59484f53 // "YHOS"
+#define STEP_SIZE    4          // pc advances this much per step (for the profiler).
+
+// Page 0 of region 1.
+typedef struct {
+  int  magic;
+  char name[HOSTED_NAME];
+} hosted_image_t;
+
+// Page 1 of region 1.
+typedef struct {
+  int   depth;              // Loops entered.
+  int   loop_left[HOSTED_LOOPS];
+  int   grown;              // Pages STEP_GROW has touched so far.
+  int   spun;               // Cycles STEP_SPIN has computed so far.
+  int   vars[HOSTED_VARS];
+  char* argv[2];
+  char  str[HOSTED_STR];
+  char  buf[HOSTED_BUF];
+} hosted_data_t;
+
+// ======== ======== ======== ======== ======== ======== ======== ========
+// Running the machine.
+// -------- -------- -------- -------- -------- -------- -------- --------
+
+typedef struct {
+  int   pmem_size;        // Bytes of physical memory.
+  int   tick_cycles;      // Cycles between clock interrupts.
+  int   disk_cycles;      // Cycles a disk access takes.
+  int   tty_byte_cycles;  // Cycles a terminal takes per byte sent.
+  int   trace_level;      // TracePrintf() level kept in TRACE.
+  int   iterations;       // Value of ARG_ITERS.
+  int   max_ticks;        // Clock interrupts after which the run fails (a hang).
+  int   bench;            // Report as "BENCH metric value unit" lines.
+  int   record;           // Write every trap to TRAPS (see Machine.c).
+  int   replay;           // Deliver the interrupts recorded in TRAPS instead, and report
+                          // where the run strays from the recording.
+  char* name;             // Of the run, for the report.
+} machine_config_t;
+
+// Writes a file for each program in programs (ending with a NULL name), in the
+// current directory.
+void MachineWritePrograms(hosted_program_t* programs);
+
+// Boots the kernel with init (cmd_args[0]) and runs it until it halts, which ends the
+// Linux process: with 0, or with 1 if a step failed or the kernel went wrong. Prints
+// the time spent in the kernel per trap and system call on the way out (and, when
+// replaying, how the run compares with the recording).
+void MachineRun(machine_config_t* config, hosted_program_t* programs, char** cmd_args);
+
+#endif
+// End of Machine.h
@@ -0,0 +1,72 @@
+// CacheTest.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests the buffer cache: sectors just written are read back without the disk,
+// Sync() leaves nothing dirty, and sectors evicted by a long scan come back intact.
+
+#include "programs/UserUtility.h"
+#include "include/filesystem.h"
+
+#define FIRST   200
+#define SECTORS 8
+
+void stats(char* when) {
+  cache_stats_t s;
+  if( SUCCESS != CacheStats(&s) ) {
+    panic("CacheTest: CacheStats() failed.\n");
+  }
+  putsArgs("CacheTest: %-12s hits %d, misses %d, writebacks %d, dirty %d.\n",
+	   when, s.hits, s.misses, s.writebacks, s.dirty);
+}
+
+// Returns the number of sectors in [FIRST, FIRST + SECTORS) which do not read back.
+int check(void) {
+  char buffer[SECTORSIZE];
+  int  bad = 0;
+  int  i;
+  for(i = 0; i < SECTORS; i++) {
+    if( SUCCESS != ReadSector(FIRST + i, buffer) ) {
+      panic("CacheTest: ReadSector() failed.\n");
+    }
+    if( buffer[0] != 'A' + i || buffer[SECTORSIZE - 1] != buffer[0] ) {
+      bad++;
+    }
+  }
+  return bad;
+}
+
+int main(void) {
+  puts("CacheTest is running...\n");
+  char buffer[SECTORSIZE];
+  int  i;
+
+  stats("at start:");
+  for(i = 0; i < SECTORS; i++) {
+    memset(buffer, 'A' + i, SECTORSIZE);
+    if( SUCCESS != WriteSector(FIRST + i, buffer) ) {
+      panic("CacheTest: WriteSector() failed.\n");
+    }
+  }
+  stats("written:");
+  putsArgs("CacheTest: %d sectors read back wrong from the cache.\n", check());
+  stats("read back:");  // Expect SECTORS more hits, no more misses.
+
+  Sync();
+  stats("synced:");     // Expect dirty 0.
+
+  // Read twice as many other sectors as the cache holds, so mine are evicted.
+  for(i = 0; i < 2 * BLOCK_CACHESIZE; i++) {
+    if( SUCCESS != ReadSector(FIRST + SECTORS + i, buffer) ) {
+      panic("CacheTest: ReadSector() failed.\n");
+    }
+  }
+  stats("scanned:");
+  putsArgs("CacheTest: %d sectors read back wrong from the disk.\n", check());
+  stats("at end:");
+
+  puts("CacheTest is exiting...\n");
+  Exit(0);
+}
+
+// End of CacheTest.c
@@ -0,0 +1,48 @@
+// CountersTest.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests the kernel's performance counters: GetPid() ROUNDS times, then Fork() and
+// Wait() once, and checks that GetCounters() saw exactly that.
+
+#include "programs/UserUtility.h"
+
+#define ROUNDS 100
+
+counters_t before, after;
+
+int main(void) {
+  puts("CountersTest is running...\n");
+
+  if( SUCCESS != GetCounters(&before) ) {
+    panic("CountersTest: GetCounters() failed.\n");
+  }
+  int i;
+  for(i = 0; i < ROUNDS; i++) {
+    GetPid();
+  }
+  if( 0 == Fork() ) {
+    Exit(0);
+  }
+  Wait(&i);
+  GetCounters(&after);
+
+#define DELTA(array, i) (after.array[i] - before.array[i])
+  putsArgs("CountersTest: %d GetPid() calls (expected %d).\n",
+	   DELTA(syscalls, YALNIX_GETPID & YALNIX_MASK), ROUNDS);
+  putsArgs("CountersTest: %d Fork() calls, %d processes created (expected 1, 1).\n",
+	   DELTA(syscalls, YALNIX_FORK & YALNIX_MASK), DELTA(counters, COUNTER_PROCESSES_CREATED));
+  putsArgs("CountersTest: %d GetCounters() calls (expected 1 so far).\n",
+	   DELTA(custom, CUSTOM_GET_COUNTERS));
+  putsArgs("CountersTest: %d pages copied by Fork(), %d context switches, %d TLB flushes.\n",
+	   DELTA(counters, COUNTER_FRAMES_COPIED), DELTA(counters, COUNTER_CONTEXT_SWITCHES),
+	   DELTA(counters, COUNTER_TLB_FLUSHES));
+  if( DELTA(counters, COUNTER_SYSCALLS) < ROUNDS + 3 ) {
+    panic("CountersTest: system calls were not all counted.\n");
+  }
+
+  puts("CountersTest is exiting...\n");
+  Exit(0);
+}
+
+// End of CountersTest.c
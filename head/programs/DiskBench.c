@@ -0,0 +1,104 @@
+// DiskBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Disk scheduling benchmark. For random, sequential and mixed sector reads, several
+// processes read at once; each read's completion time (in ticks) goes into shared
+// memory, and the average and 99th percentile are reported for each mix.
+
+#include "programs/UserUtility.h"
+
+#define NUM_CHILDREN 4
+#define REQUESTS     25
+#define NUM_SAMPLES  (NUM_CHILDREN * REQUESTS)
+
+#define RANDOM     0
+#define SEQUENTIAL 1
+#define MIXED      2
+#define NUM_MIXES  3
+
+#define SHM_ADDR ((void*) (VMEM_1_BASE + VMEM_1_SIZE / 2))
+
+typedef struct {
+  int ticks[NUM_MIXES][NUM_SAMPLES];
+} samples_t;
+
+// Linear congruential generator; good enough to scatter sectors.
+int next_random(unsigned int* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7fff;
+}
+
+void child(samples_t* samples, int mix, int n) {
+  unsigned int seed = GetPid();
+  char buffer[SECTORSIZE];
+  int  j;
+  for(j = 0; j < REQUESTS; j++) {
+    int sector;
+    if( mix == RANDOM || (mix == MIXED && n % 2 == 0) ) {
+      sector = next_random(&seed) % NUMSECTORS;
+    } else {
+      // Each mix reads its own sectors, so the buffer cache does not serve them.
+      sector = ((mix * NUM_CHILDREN + n) * REQUESTS + j) % NUMSECTORS;
+    }
+
+    int start = GetTicks();
+    if( SUCCESS != ReadSector(sector, buffer) ) {
+      panic("DiskBench-c: ReadSector() failed.\n");
+    }
+    samples->ticks[mix][n * REQUESTS + j] = GetTicks() - start;
+  }
+  Exit(0);
+}
+
+void report(char* name, int* ticks) {
+  // Insertion sort; there are only NUM_SAMPLES samples.
+  int i, j;
+  for(i = 1; i < NUM_SAMPLES; i++) {
+    int t = ticks[i];
+    for(j = i - 1; j >= 0 && ticks[j] > t; j--) {
+      ticks[j + 1] = ticks[j];
+    }
+    ticks[j + 1] = t;
+  }
+
+  int sum = 0;
+  for(i = 0; i < NUM_SAMPLES; i++) {
+    sum += ticks[i];
+  }
+  int avg100 = sum * 100 / NUM_SAMPLES;
+  int p99    = ticks[(NUM_SAMPLES * 99 + 99) / 100 - 1];
+  putsArgs("DiskBench: %-10s avg %d.%02d ticks, p99 %d ticks, max %d ticks.\n",
+	   name, avg100 / 100, avg100 % 100, p99, ticks[NUM_SAMPLES - 1]);
+}
+
+int main(void) {
+  puts("DiskBench is running...\n");
+
+  int shm = ShmCreate(sizeof(samples_t));
+  if( ERROR == shm || SUCCESS != ShmAttach(shm, SHM_ADDR) ) {
+    panic("DiskBench: I failed to set up shared memory.\n");
+  }
+  samples_t* samples = (samples_t*) SHM_ADDR;
+
+  int mix;
+  for(mix = 0; mix < NUM_MIXES; mix++) {
+    int n;
+    for(n = 0; n < NUM_CHILDREN; n++) {
+      if( 0 == Fork() ) {
+	child(samples, mix, n);
+      }
+    }
+    WaitAll();
+  }
+
+  report("random",     samples->ticks[RANDOM]);
+  report("sequential", samples->ticks[SEQUENTIAL]);
+  report("mixed",      samples->ticks[MIXED]);
+
+  ShmDetach();
+  puts("DiskBench is exiting...\n");
+  Exit(0);
+}
+
+// End of DiskBench.c
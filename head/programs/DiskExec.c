@@ -0,0 +1,45 @@
+// DiskExec.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests programs in the file system: installs itself as /bin/diskexec, then Exec()s
+// that in a child. A file which is no program image must not Exec().
+
+#include "programs/UserUtility.h"
+
+int main(int argc, char** argv) {
+  if( argc > 1 ) {
+    putsArgs("DiskExec: %s running from the file system as \"%s\".\n", argv[1], argv[0]);
+    Exit(7);
+  }
+  puts("DiskExec is running...\n");
+
+  MkDir("/bin");
+  if( SUCCESS != Install("programs/DiskExec", "/bin/diskexec") ) {
+    panic("DiskExec: Install() failed.\n");
+  }
+
+  int i;
+  for(i = 0; i < 2; i++) {
+    if( 0 == Fork() ) {
+      char* args[] = { "/bin/diskexec", "child", NULL };
+      Exec(args[0], args);
+      panic("DiskExec-c: Exec() failed.\n");
+    }
+    int status;
+    Wait(&status);
+    putsArgs("DiskExec: child exited with %d (expected 7).\n", status);
+  }
+
+  int fd = Create("/bin/junk");
+  Write(fd, "not a program", 13);
+  Close(fd);
+  char* args[] = { "/bin/junk", NULL };
+  putsArgs("DiskExec: Exec(\"/bin/junk\") returned %d (expected ERROR).\n", Exec(args[0], args));
+  Unlink("/bin/junk");
+
+  puts("DiskExec is exiting...\n");
+  Exit(0);
+}
+
+// End of DiskExec.c
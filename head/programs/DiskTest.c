@@ -0,0 +1,58 @@
+// DiskTest.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests the disk driver: several processes write and read back their own sectors
+// at the same time, so that requests queue up behind each other.
+
+#include "programs/UserUtility.h"
+
+#define NUM_CHILDREN 3
+#define SECTORS_EACH 8
+
+int main(void) {
+  puts("DiskTest is running...\n");
+
+  { int i;
+    for(i = 0; i < NUM_CHILDREN; i++) {
+      if( 0 == Fork() ) {
+	char buffer[SECTORSIZE];
+	int  bad = 0;
+	int  j;
+	for(j = 0; j < SECTORS_EACH; j++) {
+	  memset(buffer, 'a' + i * SECTORS_EACH + j, SECTORSIZE);
+	  if( SUCCESS != WriteSector(100 + i * SECTORS_EACH + j, buffer) ) {
+	    panic("DiskTest-c: WriteSector() failed.\n");
+	  }
+	}
+	for(j = 0; j < SECTORS_EACH; j++) {
+	  memset(buffer, 0, SECTORSIZE);
+	  if( SUCCESS != ReadSector(100 + i * SECTORS_EACH + j, buffer) ) {
+	    panic("DiskTest-c: ReadSector() failed.\n");
+	  }
+	  if( buffer[0] != 'a' + i * SECTORS_EACH + j || buffer[SECTORSIZE - 1] != buffer[0] ) {
+	    bad++;
+	  }
+	}
+	putsArgs("DiskTest-c%d: %d of %d sectors read back wrong.\n", i, bad, SECTORS_EACH);
+	Exit(bad);
+      }
+    }
+  }
+
+  WaitAll();
+
+  // Sectors outside the disk, and buffers outside my memory.
+  char buffer[SECTORSIZE];
+  if( ERROR != ReadSector(NUMSECTORS, buffer) ) {
+    puts("DiskTest: WARNING: ReadSector(NUMSECTORS) succeeded.\n");
+  }
+  if( ERROR != WriteSector(0, NULL) ) {
+    puts("DiskTest: WARNING: WriteSector() from NULL succeeded.\n");
+  }
+
+  puts("DiskTest is exiting...\n");
+  Exit(0);
+}
+
+// End of DiskTest.c
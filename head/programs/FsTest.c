@@ -0,0 +1,99 @@
+// FsTest.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests the file system: directories, small and large (indirect-block) files, Seek(),
+// ReadDir(), Unlink(), and a descriptor shared with a Fork() child. What it writes
+// stays on the disk: run it twice and the second run finds the first run's log.
+
+#include "programs/UserUtility.h"
+#include "include/filesystem.h"
+
+#define BIG_BLOCKS 20 // More than NUM_DIRECT, so the indirect block is used.
+
+int main(void) {
+  puts("FsTest is running...\n");
+  char buffer[BLOCKSIZE];
+  int  fd, i, length;
+
+  // Earlier runs.
+  if( (fd = Open("/fstest/log")) != ERROR ) {
+    length = Read(fd, buffer, BLOCKSIZE - 1);
+    buffer[length > 0 ? length : 0] = '\0';
+    putsArgs("FsTest: log of earlier runs: \"%s\"\n", buffer);
+    Close(fd);
+  } else if( MkDir("/fstest") != SUCCESS ) {
+    panic("FsTest: MkDir() failed.\n");
+  }
+
+  // A small file, written, rewound and read back.
+  if( (fd = Create("/fstest/hello")) == ERROR ) {
+    panic("FsTest: Create() failed.\n");
+  }
+  Write(fd, "hello, disk", 11);
+  Seek(fd, 7, FS_SEEK_SET);
+  length = Read(fd, buffer, BLOCKSIZE);
+  buffer[length > 0 ? length : 0] = '\0';
+  putsArgs("FsTest: read \"%s\" (expected \"disk\").\n", buffer);
+  putsArgs("FsTest: Unlink() of an open file returned %d (expected ERROR).\n", Unlink("/fstest/hello"));
+  Close(fd);
+
+  // A large file, one block at a time.
+  if( (fd = Create("/fstest/big")) == ERROR ) {
+    panic("FsTest: Create() failed.\n");
+  }
+  for(i = 0; i < BIG_BLOCKS; i++) {
+    memset(buffer, 'a' + i, BLOCKSIZE);
+    if( Write(fd, buffer, BLOCKSIZE) != BLOCKSIZE ) {
+      panic("FsTest: Write() failed.\n");
+    }
+  }
+  putsArgs("FsTest: big is %d bytes (expected %d).\n", Seek(fd, 0, FS_SEEK_END), BIG_BLOCKS * BLOCKSIZE);
+  int bad = 0;
+  Seek(fd, 0, FS_SEEK_SET);
+  for(i = 0; i < BIG_BLOCKS; i++) {
+    if( Read(fd, buffer, BLOCKSIZE) != BLOCKSIZE || buffer[0] != 'a' + i || buffer[BLOCKSIZE - 1] != 'a' + i ) {
+      bad++;
+    }
+  }
+  putsArgs("FsTest: %d of %d blocks read back wrong.\n", bad, BIG_BLOCKS);
+
+  // The child's reads move the offset I see.
+  Seek(fd, 0, FS_SEEK_SET);
+  if( 0 == Fork() ) {
+    Read(fd, buffer, 100);
+    Exit(0);
+  }
+  WaitAll();
+  putsArgs("FsTest: offset after the child's Read() is %d (expected 100).\n", Seek(fd, 0, FS_SEEK_CUR));
+  Close(fd);
+
+  // Directory listing.
+  struct dir_entry entry;
+  fd = Open("/fstest/");
+  while( ReadDir(fd, &entry) == 1 ) {
+    char name[DIRNAMELEN + 1];
+    memcpy(name, entry.name, DIRNAMELEN);
+    name[DIRNAMELEN] = '\0';
+    putsArgs("FsTest: /fstest/%s is inode %d.\n", name, entry.inum);
+  }
+  Close(fd);
+
+  putsArgs("FsTest: Unlink(\"/fstest/big\") returned %d.\n", Unlink("/fstest/big"));
+  putsArgs("FsTest: Open() after Unlink() returned %d (expected ERROR).\n", Open("/fstest/./big"));
+
+  // Leave a log behind for the next run.
+  fd = Open("/fstest/log");
+  if( fd == ERROR ) {
+    fd = Create("fstest/../fstest/log");
+  }
+  Seek(fd, 0, FS_SEEK_END);
+  Write(fd, "run;", 4);
+  Close(fd);
+  Sync();
+
+  puts("FsTest is exiting...\n");
+  Exit(0);
+}
+
+// End of FsTest.c
@@ -0,0 +1,105 @@
+// MemMap.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Prints who holds physical memory, from the kernel's frame map (FrameMap() in
+// CustomCalls.h):
+//
+//   programs/MemMap                  memory as it is now.
+//   programs/MemMap program args...  starts program, and looks while it runs.
+//
+// For each process (pid 0 is the kernel), its resident frames by kind; then how
+// fragmented the free frames are: how many runs of adjacent free frames they form, and
+// the longest. Frames of a shared memory segment count for the process that made it.
+
+#include "programs/UserUtility.h"
+
+#define CHUNK     128 // Frames read per FrameMap().
+#define MAX_OWNERS 64
+
+char* kind_names[FRAME_KINDS] = FRAME_KIND_NAMES;
+
+frame_map_t chunk[CHUNK];
+
+typedef struct {
+  int pid;
+  int frames[FRAME_KINDS];
+  int total;
+} owner_t;
+
+owner_t owners[MAX_OWNERS];
+int     num_owners;
+
+owner_t* owner(int pid) {
+  int i;
+  for(i = 0; i < num_owners && owners[i].pid != pid; i++) {
+  }
+  if( i == num_owners ) {
+    if( num_owners == MAX_OWNERS ) {
+      return NULL;
+    }
+    owners[num_owners++].pid = pid;
+  }
+  return &owners[i];
+}
+
+int main(int argc, char** argv) {
+  int child = 0;
+  if( argc > 1 ) {
+    child = Fork();
+    if( child == 0 ) {
+      Exec(argv[1], argv + 1);
+      panic("MemMap: Exec() failed.\n");
+    }
+    Delay(5); // Let it get going.
+  }
+
+  int frames = 0, free = 0, runs = 0, run = 0, longest = 0, shared = 0;
+  int n;
+  while( (n = FrameMap(chunk, frames, CHUNK)) > 0 ) {
+    int i;
+    for(i = 0; i < n; i++) {
+      frame_map_t* f = &chunk[i];
+      if( f->kind == FRAME_FREE ) {
+	free++;
+	runs += run == 0;
+	run++;
+	longest = run > longest ? run : longest;
+	continue;
+      }
+      run = 0;
+      shared += f->refs > 1;
+      owner_t* o = owner(f->pid);
+      if( o != NULL && f->kind < FRAME_KINDS ) {
+	o->frames[f->kind]++;
+	o->total++;
+      }
+    }
+    frames += n;
+  }
+  if( n == ERROR ) {
+    panic("MemMap: FrameMap() failed.\n");
+  }
+
+  putsArgs("MemMap: %d frames, %d in use, %d shared by more than one page\n",
+	   frames, frames - free, shared);
+  putsArgs("MemMap: %-4s %5s %6s %5s %6s %5s %5s %5s %5s %6s\n", "pid", "rss",
+	   kind_names[1], kind_names[2], kind_names[3], kind_names[4], kind_names[5],
+	   kind_names[6], kind_names[7], kind_names[8]);
+  int i;
+  for(i = 0; i < num_owners; i++) {
+    int* k = owners[i].frames;
+    putsArgs("MemMap: %-4d %5d %6d %5d %6d %5d %5d %5d %5d %6d\n", owners[i].pid,
+	     owners[i].total, k[1], k[2], k[3], k[4], k[5], k[6], k[7], k[8]);
+  }
+  putsArgs("MemMap: free %d frames in %d runs, longest %d (%d%% fragmented)\n", free, runs,
+	   longest, free == 0 ? 0 : 100 - 100 * longest / free);
+
+  if( child > 0 ) {
+    int status;
+    Wait(&status);
+  }
+  Exit(0);
+}
+
+// End of MemMap.c
@@ -0,0 +1,95 @@
+// Poller.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests Poll(): one process serves two pipes, a terminal and its children's exits
+// without forking a helper per source.
+
+#include "programs/UserUtility.h"
+
+#define NUM_SOURCES 4
+
+int main(void) {
+  puts("Poller is running...\n");
+
+  int pipes[2];
+  if( SUCCESS != PipeInit(&pipes[0]) || SUCCESS != PipeInit(&pipes[1]) ) {
+    panic("Poller: I failed to create my pipes.\n");
+  }
+
+  // Children write to the pipes at different times, then exit.
+  { int i;
+    for(i = 0; i < 2; i++) {
+      if( 0 == Fork() ) {
+	char message[] = "pipe #?";
+	message[6] = '0' + i;
+	Delay(3 + 5 * i);
+	PipeWrite(pipes[i], message, sizeof(message));
+	Exit(i);
+      }
+    }
+  }
+
+  int ids[NUM_SOURCES] = { pipes[0], pipes[1], TTY_CONSOLE, 0 };
+  int events[NUM_SOURCES];
+  int pipes_done    = 0;
+  int children_done = 0;
+
+  // Nothing is ready yet.
+  events[0] = POLL_PIPE; events[1] = POLL_PIPE; events[2] = POLL_TTY; events[3] = POLL_CHILD;
+  int ready = Poll(ids, events, NUM_SOURCES, 0);
+  putsArgs("Poller: Poll(timeout 0) returned %d (expected TIMEOUT==%d).\n", ready, TIMEOUT);
+
+  while( pipes_done < 2 || children_done < 2 ) {
+    events[0] = POLL_PIPE; events[1] = POLL_PIPE; events[2] = POLL_TTY; events[3] = POLL_CHILD;
+    ready = Poll(ids, events, NUM_SOURCES, 20);
+    if( ERROR == ready ) {
+      panic("Poller: Poll() failed.\n");
+    }
+    if( TIMEOUT == ready ) {
+      puts("Poller: nothing happened for 20 ticks.\n");
+      continue;
+    }
+    putsArgs("Poller: %d source(s) ready.\n", ready);
+
+    { int i;
+      for(i = 0; i < 2; i++) {
+	if( events[i] & POLL_READY ) {
+	  char buffer[16];
+	  int length = PipeRead(pipes[i], buffer, sizeof(buffer));
+	  putsArgs("Poller: read %d bytes from pipe: %s\n", length, buffer);
+	  PipeWrite(pipes[i], buffer, 0); // PipeRead() does not empty the pipe.
+	  pipes_done++;
+	}
+      }
+    }
+    if( events[2] & POLL_READY ) {
+      char line[TERMINAL_MAX_LINE];
+      int length = TtyRead(TTY_CONSOLE, line, sizeof(line));
+      putsArgs("Poller: read %d bytes from the console.\n", length);
+    }
+    if( events[3] & POLL_READY && children_done < 2 ) {
+      int status;
+      int pid = Wait(&status);
+      putsArgs("Poller: child #%d exited with %d.\n", pid, status);
+      children_done++;
+    }
+  }
+
+  // Bad sources.
+  events[0] = POLL_PIPE;
+  ids[0]    = -1;
+  if( ERROR != Poll(ids, events, 1, 0) ) {
+    puts("Poller: WARNING: Poll() accepted an invalid pipe.\n");
+  }
+  if( ERROR != Poll(ids, events, 0, POLL_FOREVER) ) {
+    puts("Poller: WARNING: Poll() of no sources, forever, returned.\n");
+  }
+
+  Reclaim(pipes[0]);
+  Reclaim(pipes[1]);
+  puts("Poller is exiting...\n");
+  Exit(0);
+}
+
+// End of Poller.c
@@ -0,0 +1,60 @@
+// Profiler.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Runs a program under the clock-tick profiler (see Profile.h):
+//
+//   programs/Profiler program args...  profiles program, and whatever it Fork()s.
+//   programs/Profiler                  profiles a workload of its own, which spends
+//                                      about 3/4 of its time in hot() and 1/4 in warm().
+//
+// Then run tools/ProfileDecode on the host, once yalnix halts.
+
+#include "programs/UserUtility.h"
+
+#define SPINS 200000
+
+volatile int sink;
+
+void hot(void) {
+  int i;
+  for(i = 0; i < 3 * SPINS; i++) {
+    sink ^= i;
+  }
+}
+
+void warm(void) {
+  int i;
+  for(i = 0; i < SPINS; i++) {
+    sink ^= i;
+  }
+}
+
+int main(int argc, char** argv) {
+  Profile(1);
+  int pid = Fork();
+  if( pid == 0 ) {
+    if( argc > 1 ) {
+      Exec(argv[1], argv + 1);
+      panic("Profiler: Exec() failed.\n");
+    }
+    int round;
+    for(round = 0; round < 20; round++) {
+      hot();
+      warm();
+    }
+    putsArgs("Profiler: workload took %d samples.\n", Profile(0));
+    Exit(0);
+  }
+  // The child stays profiled; waiting here takes no samples anyway.
+  Profile(0);
+  if( pid == ERROR ) {
+    panic("Profiler: Fork() failed.\n");
+  }
+  int status;
+  Wait(&status);
+  putsArgs("Profiler: child exited with %d; its samples are in " PROFILE_FILE ".\n", status);
+  Exit(0);
+}
+
+// End of Profiler.c
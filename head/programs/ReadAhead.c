@@ -0,0 +1,78 @@
+// ReadAhead.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests read-ahead: a sequential run of ReadSector()s and a sequential Read() of a file
+// should be mostly read-ahead hits; scattered ReadSector()s should read nothing ahead.
+
+#include "programs/UserUtility.h"
+#include "include/filesystem.h"
+
+#define RUN         64  // Sectors per run.
+#define FIRST       700 // Away from the file system at the start of the disk.
+#define FILE_BLOCKS 40  // More than BLOCK_CACHESIZE.
+
+cache_stats_t before;
+
+void start(void) {
+  CacheStats(&before);
+}
+
+void report(char* name, int ticks) {
+  cache_stats_t after;
+  CacheStats(&after);
+  putsArgs("ReadAhead: %-10s %d ticks, %d misses, %d read ahead, %d ra hits, %d ra wasted.\n",
+	   name, ticks, after.misses - before.misses, after.readaheads - before.readaheads,
+	   after.ra_hits - before.ra_hits, after.ra_wasted - before.ra_wasted);
+}
+
+int main(void) {
+  puts("ReadAhead is running...\n");
+  char buffer[BLOCKSIZE];
+  unsigned int seed = 58;
+  int i, t;
+
+  start();
+  t = GetTicks();
+  for(i = 0; i < RUN; i++) {
+    ReadSector(FIRST + i, buffer);
+  }
+  report("sequential", GetTicks() - t);
+
+  start();
+  t = GetTicks();
+  for(i = 0; i < RUN; i++) {
+    seed = seed * 1103515245 + 12345;
+    ReadSector(FIRST + RUN + (seed >> 16) % (NUMSECTORS - FIRST - RUN), buffer);
+  }
+  report("scattered", GetTicks() - t);
+
+  // A file bigger than the cache, so that reading it back goes to the disk.
+  int fd = Create("/readahead");
+  if( fd == ERROR ) {
+    panic("ReadAhead: Create() failed.\n");
+  }
+  for(i = 0; i < FILE_BLOCKS; i++) {
+    memset(buffer, i, BLOCKSIZE);
+    Write(fd, buffer, BLOCKSIZE);
+  }
+  Sync();
+  Seek(fd, 0, FS_SEEK_SET);
+  start();
+  t = GetTicks();
+  int bad = 0;
+  for(i = 0; i < FILE_BLOCKS; i++) {
+    if( Read(fd, buffer, BLOCKSIZE) != BLOCKSIZE || buffer[0] != i ) {
+      bad++;
+    }
+  }
+  report("file", GetTicks() - t);
+  putsArgs("ReadAhead: %d of %d file blocks read back wrong.\n", bad, FILE_BLOCKS);
+  Close(fd);
+  Unlink("/readahead");
+
+  puts("ReadAhead is exiting...\n");
+  Exit(0);
+}
+
+// End of ReadAhead.c
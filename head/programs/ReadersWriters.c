@@ -0,0 +1,89 @@
+// ReadersWriters.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests reader-writer locks: readers share the lock, writers get it alone,
+// and a process which dies holding the lock gives it up.
+
+#include "programs/UserUtility.h"
+
+#define NUM_READERS 4
+#define NUM_WRITERS 2
+
+void reader(int rwlock, int n) {
+  AcquireRead(rwlock);
+  putsArgs("ReadersWriters-r%d: reading.\n", n);
+  Delay(2);
+  putsArgs("ReadersWriters-r%d: done reading.\n", n);
+  ReleaseRW(rwlock);
+  Exit(0);
+}
+
+void writer(int rwlock, int n) {
+  AcquireWrite(rwlock);
+  putsArgs("ReadersWriters-w%d: writing alone.\n", n);
+  Delay(2);
+  putsArgs("ReadersWriters-w%d: done writing.\n", n);
+  ReleaseRW(rwlock);
+  Exit(0);
+}
+
+// Dies while holding the lock for writing.
+void careless_writer(int rwlock) {
+  AcquireWrite(rwlock);
+  puts("ReadersWriters-careless: I will exit without releasing.\n");
+  Exit(0);
+}
+
+int main(void) {
+  puts("ReadersWriters is running...\n");
+
+  int rwlock;
+  if( SUCCESS != RWLockInit(&rwlock) ) {
+    panic("ReadersWriters: I failed to create a reader-writer lock.\n");
+  }
+
+  // Releasing a lock I don't hold, and acquiring a non-lock, are errors.
+  if( ERROR != ReleaseRW(rwlock) ) {
+    puts("ReadersWriters: WARNING: ReleaseRW() without holding succeeded.\n");
+  }
+  if( ERROR != AcquireRead(rwlock + 1000) ) {
+    puts("ReadersWriters: WARNING: AcquireRead() of invalid id succeeded.\n");
+  }
+
+  // Readers and writers interleaved; readers arriving after a writer queue behind it.
+  { int i;
+    for(i = 0; i < NUM_READERS; i++) {
+      if( 0 == Fork() ) {
+	reader(rwlock, i);
+      }
+      if( i == NUM_READERS / 2 ) {
+	int j;
+	for(j = 0; j < NUM_WRITERS; j++) {
+	  if( 0 == Fork() ) {
+	    writer(rwlock, j);
+	  }
+	}
+      }
+    }
+  }
+  WaitAll();
+
+  if( 0 == Fork() ) {
+    careless_writer(rwlock);
+  }
+  WaitAll();
+
+  if( SUCCESS != AcquireWrite(rwlock) ) {
+    puts("ReadersWriters: WARNING: lock was not released by dead writer.\n");
+  } else {
+    puts("ReadersWriters: dead writer's lock was released.\n");
+    ReleaseRW(rwlock);
+  }
+
+  Reclaim(rwlock);
+  puts("ReadersWriters is exiting...\n");
+  Exit(0);
+}
+
+// End of ReadersWriters.c
@@ -0,0 +1,86 @@
+// SharedMemory.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests shared memory segments: children inherit the mapping through Fork(),
+// count into it under a lock, and the parent reads the total.
+
+#include "programs/UserUtility.h"
+
+#define NUM_CHILDREN 4
+#define INCREMENTS   10
+
+// Put the segment well above the heap, leaving room for malloc().
+#define SHM_ADDR ((void*) (VMEM_1_BASE + VMEM_1_SIZE / 2))
+
+typedef struct {
+  int counter;
+  int writers[NUM_CHILDREN + 1];
+} shared_t;
+
+int main(void) {
+  puts("SharedMemory is running...\n");
+
+  int lock;
+  if( SUCCESS != LockInit(&lock) ) {
+    panic("SharedMemory: I failed to create a lock.\n");
+  }
+
+  int shm = ShmCreate(sizeof(shared_t));
+  if( ERROR == shm ) {
+    panic("SharedMemory: I failed to create a segment.\n");
+  }
+  if( SUCCESS != ShmAttach(shm, SHM_ADDR) ) {
+    panic("SharedMemory: I failed to attach my segment.\n");
+  }
+  shared_t* shared = (shared_t*) SHM_ADDR;
+  putsArgs("SharedMemory: segment #%d attached at %p (counter==%d).\n", shm, shared, shared->counter);
+
+  // Attaching twice is an error.
+  if( ERROR != ShmAttach(shm, SHM_ADDR) ) {
+    puts("SharedMemory: WARNING: second ShmAttach() succeeded.\n");
+  }
+
+  { int i;
+    for(i = 1; i <= NUM_CHILDREN; i++) {
+      if( 0 == Fork() ) {
+	int j;
+	for(j = 0; j < INCREMENTS; j++) {
+	  Acquire(lock);
+	  shared->counter++;
+	  shared->writers[i]++;
+	  Release(lock);
+	  Pause();
+	}
+	putsArgs("SharedMemory-c%d: done, counter==%d.\n", i, shared->counter);
+	Exit(0);
+      }
+    }
+  }
+
+  WaitAll();
+
+  putsArgs("SharedMemory: counter==%d (expected %d).\n", shared->counter, NUM_CHILDREN * INCREMENTS);
+  { int i;
+    for(i = 1; i <= NUM_CHILDREN; i++) {
+      putsArgs("SharedMemory:   child %d wrote %d times.\n", i, shared->writers[i]);
+    }
+  }
+
+  // Segment is still attached, so it cannot be reclaimed.
+  if( ERROR != Reclaim(shm) ) {
+    puts("SharedMemory: WARNING: Reclaim() of attached segment succeeded.\n");
+  }
+
+  // Last one out destroys the segment.
+  ShmDetach();
+  if( ERROR != ShmAttach(shm, SHM_ADDR) ) {
+    puts("SharedMemory: WARNING: segment survived its last detach.\n");
+  }
+
+  Reclaim(lock);
+  puts("SharedMemory is exiting...\n");
+  Exit(0);
+}
+
+// End of SharedMemory.c
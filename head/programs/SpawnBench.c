@@ -0,0 +1,81 @@
+// SpawnBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Process creation benchmark. With a HEAP_PAGES page heap standing in for a real
+// supervisor's memory, launches ROUNDS children with Fork() then Exec(), then ROUNDS
+// with Spawn(), waiting for each; reports the average ticks and frames touched
+// (allocated plus copied) per launch. Also checks that a failed Spawn() leaves no child.
+
+#include "programs/UserUtility.h"
+
+#define ROUNDS     10
+#define HEAP_PAGES 32
+
+#define FORK_EXEC 0
+#define SPAWN     1
+
+char* names[] = { "Fork+Exec", "Spawn" };
+
+void launch(int how, char** args) {
+  if( how == SPAWN ) {
+    if( ERROR == Spawn(args[0], args) ) {
+      panic("SpawnBench: Spawn() failed.\n");
+    }
+  } else if( 0 == Fork() ) {
+    Exec(args[0], args);
+    panic("SpawnBench-c: Exec() failed.\n");
+  }
+  int status;
+  if( ERROR == Wait(&status) || status != 3 ) {
+    panic("SpawnBench: child did not exit with 3.\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  if( argc > 1 ) {
+    Exit(3);
+  }
+  puts("SpawnBench is running...\n");
+
+  // Touch every heap page, so that Fork() has them to copy.
+  char* heap = (char*) malloc(HEAP_PAGES * PAGESIZE);
+  if( heap == NULL ) {
+    panic("SpawnBench: malloc() failed.\n");
+  }
+  int i;
+  for(i = 0; i < HEAP_PAGES; i++) {
+    heap[i * PAGESIZE] = i;
+  }
+
+  char* args[] = { "programs/SpawnBench", "child", NULL };
+  int how;
+  for(how = FORK_EXEC; how <= SPAWN; how++) {
+    frame_stats_t before, after;
+    FrameStats(&before);
+    int start = GetTicks();
+    for(i = 0; i < ROUNDS; i++) {
+      launch(how, args);
+    }
+    int ticks100 = (GetTicks() - start) * 100 / ROUNDS;
+    FrameStats(&after);
+    int touched = (after.allocated - before.allocated) + (after.copied - before.copied);
+    putsArgs("SpawnBench: %-9s %d.%02d ticks, %d frames touched (%d copied) per launch.\n",
+	     names[how], ticks100 / 100, ticks100 % 100, touched / ROUNDS,
+	     (after.copied - before.copied) / ROUNDS);
+    if( after.free != before.free ) {
+      putsArgs("SpawnBench: %d frames free before, %d after.\n", before.free, after.free);
+    }
+  }
+
+  char* missing[] = { "programs/NoSuchProgram", NULL };
+  putsArgs("SpawnBench: Spawn(\"%s\") returned %d (expected ERROR).\n", missing[0],
+	   Spawn(missing[0], missing));
+  putsArgs("SpawnBench: Wait() then returned %d (expected ERROR).\n", Wait(&i));
+
+  free(heap);
+  puts("SpawnBench is exiting...\n");
+  Exit(0);
+}
+
+// End of SpawnBench.c
@@ -0,0 +1,86 @@
+// SyscallStats.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Prints p50/p90/p99 of each system call made so far, in ticks and in work units
+// (see syscall_hist_t in Counters.h):
+//
+//   programs/SyscallStats                  what every process has called since boot.
+//   programs/SyscallStats program args...  runs program first, and waits for it.
+//
+// Histograms are log-scale, so each percentile is shown as the upper bound of its
+// bucket: "<=7" means between 4 and 7.
+
+#include "programs/UserUtility.h"
+
+code_name_t syscall_names[] = { SYSCALL_NAMES, { 0, NULL } };
+code_name_t custom_names[]  = { CUSTOM_NAMES,  { 0, NULL } };
+
+char* work_names[NUM_WORK] = { "pages", "bytes", "nodes", "switches" };
+
+syscall_hist_t hist;
+
+char* lookup(code_name_t* names, int code) {
+  for(; names->name != NULL; names++) {
+    if( names->code == code ) {
+      return names->name;
+    }
+  }
+  return NULL;
+}
+
+// Upper bound of the bucket holding the pct-th percentile of buckets, out of calls.
+int percentile(int* buckets, int calls, int pct) {
+  int rank = (calls * pct + 99) / 100;
+  int seen = 0;
+  int b;
+  for(b = 0; b < HIST_BUCKETS - 1; b++) {
+    seen += buckets[b];
+    if( seen >= rank ) {
+      break;
+    }
+  }
+  return b == 0 ? 0 : (1 << b) - 1;
+}
+
+void report(char* name, char* unit, int* buckets, int calls) {
+  putsArgs("SyscallStats: %-14s %-8s p50 <=%-8d p90 <=%-8d p99 <=%d\n", name, unit,
+	   percentile(buckets, calls, 50), percentile(buckets, calls, 90),
+	   percentile(buckets, calls, 99));
+}
+
+int main(int argc, char** argv) {
+  if( argc > 1 ) {
+    int pid = Fork();
+    if( pid == 0 ) {
+      Exec(argv[1], argv + 1);
+      panic("SyscallStats: Exec() failed.\n");
+    }
+    int status;
+    Wait(&status);
+  }
+
+  int call;
+  for(call = 0; call < HIST_CALLS; call++) {
+    if( SUCCESS != SyscallHist(call, &hist) ) {
+      panic("SyscallStats: SyscallHist() failed.\n");
+    }
+    if( hist.calls == 0 ) {
+      continue;
+    }
+    char* name = call >= HIST_CUSTOM_BASE ? lookup(custom_names, call - HIST_CUSTOM_BASE)
+                                          : lookup(syscall_names, call | YALNIX_PREFIX);
+    if( name == NULL ) {
+      name = "?";
+    }
+    putsArgs("SyscallStats: %-14s %d calls (histogram 0x%x)\n", name, hist.calls, call);
+    report(name, "ticks", hist.ticks, hist.calls);
+    int i;
+    for(i = 0; i < NUM_WORK; i++) {
+      report(name, work_names[i], hist.work[i], hist.calls);
+    }
+  }
+  Exit(0);
+}
+
+// End of SyscallStats.c
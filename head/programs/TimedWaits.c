@@ -0,0 +1,66 @@
+// TimedWaits.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests AcquireTimed(), CvarWaitTimed() and PipeReadTimed(): each one gives up
+// with TIMEOUT when nobody shows up, and succeeds when somebody does in time.
+
+#include "programs/UserUtility.h"
+
+int main(void) {
+  puts("TimedWaits is running...\n");
+
+  int lock, cvar, pipe;
+  if( SUCCESS != LockInit(&lock) || SUCCESS != CvarInit(&cvar) || SUCCESS != PipeInit(&pipe) ) {
+    panic("TimedWaits: I failed to create my interps.\n");
+  }
+
+  // 1. Lock held by a child for a long time.
+  Acquire(lock);
+  if( 0 == Fork() ) {
+    int result = AcquireTimed(lock, 3);
+    putsArgs("TimedWaits-c1: AcquireTimed() returned %d (expected TIMEOUT==%d).\n", result, TIMEOUT);
+    result = AcquireTimed(lock, 20);
+    putsArgs("TimedWaits-c1: AcquireTimed() returned %d (expected SUCCESS).\n", result);
+    Release(lock);
+    Exit(0);
+  }
+  Delay(8);
+  Release(lock);
+  WaitAll();
+
+  // 2. Nobody signals the cvar.
+  Acquire(lock);
+  int result = CvarWaitTimed(cvar, lock, 3);
+  putsArgs("TimedWaits: CvarWaitTimed() returned %d (expected TIMEOUT==%d).\n", result, TIMEOUT);
+  // The lock must have been reacquired; Release() errs otherwise.
+  if( SUCCESS != Release(lock) ) {
+    puts("TimedWaits: WARNING: lock was not reacquired after timeout.\n");
+  }
+
+  // 3. Empty pipe, then a writer that comes in time.
+  char buffer[16];
+  result = PipeReadTimed(pipe, buffer, sizeof(buffer), 0);
+  putsArgs("TimedWaits: PipeReadTimed(0) returned %d (expected TIMEOUT==%d).\n", result, TIMEOUT);
+  if( 0 == Fork() ) {
+    Delay(2);
+    PipeWrite(pipe, "hello", 6);
+    Exit(0);
+  }
+  result = PipeReadTimed(pipe, buffer, sizeof(buffer), 20);
+  putsArgs("TimedWaits: PipeReadTimed(20) returned %d (expected 6).\n", result);
+  WaitAll();
+
+  // Negative timeouts are invalid.
+  if( ERROR != AcquireTimed(lock, -5) ) {
+    puts("TimedWaits: WARNING: negative timeout accepted.\n");
+  }
+
+  Reclaim(pipe);
+  Reclaim(cvar);
+  Reclaim(lock);
+  puts("TimedWaits is exiting...\n");
+  Exit(0);
+}
+
+// End of TimedWaits.c
@@ -0,0 +1,38 @@
+// TtyLines.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests TTY input buffering: lines typed on terminal 1 while no one reads are kept
+// by the kernel, and a small TtyRead() leaves the rest of its line for the next one.
+//
+// Type a few lines into terminal 1 during the delay.
+
+#include "programs/UserUtility.h"
+
+#define TTY 1
+
+int main(void) {
+  puts("TtyLines is running...\n");
+  TtyPrintf(TTY, "TtyLines: type a few lines here within 10 ticks.\n");
+
+  Delay(10);
+
+  tty_stats_t stats;
+  TtyStats(TTY, &stats);
+  putsArgs("TtyLines: %d lines (%d bytes) waiting, %d bytes received, %d overruns.\n",
+	   stats.input_lines, stats.input_buffered, stats.bytes_buffered, stats.overruns);
+
+  // Read in 4-byte pieces without blocking until the buffer is empty.
+  char piece[5];
+  int  length;
+  while( (length = TtyReadFlags(TTY, piece, 4, IO_NONBLOCK)) > 0 ) {
+    piece[length] = '\0';
+    putsArgs("TtyLines: read %d bytes: \"%s\"\n", length, piece);
+  }
+  putsArgs("TtyLines: buffer empty, TtyRead() returned %d (expected WOULDBLOCK==%d).\n", length, WOULDBLOCK);
+
+  puts("TtyLines is exiting...\n");
+  Exit(0);
+}
+
+// End of TtyLines.c
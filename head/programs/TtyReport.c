@@ -0,0 +1,61 @@
+// TtyReport.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests buffered TtyWrite(): a 10 KB report is more than the kernel buffers for one
+// process, so its writer blocks for room a few times. A second process's short lines
+// show up between report lines (never inside one), and each stays whole.
+
+#include "programs/UserUtility.h"
+
+#define REPORT_LINES 200
+#define LINE_LENGTH  50
+
+int main(void) {
+  puts("TtyReport is running...\n");
+
+  char* report = (char*)malloc(REPORT_LINES * LINE_LENGTH);
+  if( report == NULL ) {
+    panic("TtyReport: I failed to malloc() my report.\n");
+  }
+  { int i;
+    for(i = 0; i < REPORT_LINES; i++) {
+      char* line = report + i * LINE_LENGTH;
+      memset(line, '.', LINE_LENGTH);
+      line[0] = '0' + (i / 100) % 10;
+      line[1] = '0' + (i / 10) % 10;
+      line[2] = '0' + i % 10;
+      line[LINE_LENGTH - 1] = '\n';
+    }
+  }
+
+  if( 0 == Fork() ) {
+    Pause(); // Let the report start first.
+    int i;
+    for(i = 0; i < 3; i++) {
+      puts("TtyReport-c: a short line, after the report.\n");
+    }
+    Exit(0);
+  }
+
+  int written = TtyWrite(TTY_CONSOLE, report, REPORT_LINES * LINE_LENGTH);
+  putsArgs("TtyReport: TtyWrite() returned %d (expected %d).\n", written, REPORT_LINES * LINE_LENGTH);
+
+  // 1 if there is room, WOULDBLOCK otherwise. Never waits.
+  int result = TtyWriteFlags(TTY_CONSOLE, "x", 1, IO_NONBLOCK);
+  putsArgs("TtyReport: non-blocking TtyWrite() returned %d.\n", result);
+
+  WaitAll();
+
+  tty_stats_t stats;
+  TtyStats(TTY_CONSOLE, &stats);
+  if( stats.output_transmits > 0 ) {
+    putsArgs("TtyReport: %d bytes in %d transmits (%d bytes per transmit).\n",
+	     stats.bytes_sent, stats.output_transmits, stats.bytes_sent / stats.output_transmits);
+  }
+  free(report);
+  puts("TtyReport is exiting...\n");
+  Exit(0); // Everything buffered still reaches the console before the OS halts.
+}
+
+// End of TtyReport.c
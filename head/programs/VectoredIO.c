@@ -0,0 +1,62 @@
+// VectoredIO.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Tests the I/O calls with flags: IO_NONBLOCK returns WOULDBLOCK instead of
+// blocking, and IO_VECTOR gathers and scatters over iovec_t arrays.
+
+#include "programs/UserUtility.h"
+
+int main(void) {
+  puts("VectoredIO is running...\n");
+
+  // 1. Header and body reach the terminal as one write.
+  char header[] = "VectoredIO: [header] ";
+  char body[]   = "body, in the same write.\n";
+  iovec_t out[2] = { { header, sizeof(header) - 1 }, { body, sizeof(body) - 1 } };
+  int written = TtyWritev(TTY_CONSOLE, out, 2);
+  putsArgs("VectoredIO: TtyWritev() returned %d (expected %d).\n", written, out[0].len + out[1].len);
+
+  // 2. Nothing to read yet.
+  int pipe;
+  if( SUCCESS != PipeInit(&pipe) ) {
+    panic("VectoredIO: I failed to create a pipe.\n");
+  }
+  char buffer[32];
+  int result = PipeReadFlags(pipe, buffer, sizeof(buffer), IO_NONBLOCK);
+  putsArgs("VectoredIO: non-blocking PipeRead() returned %d (expected WOULDBLOCK==%d).\n", result, WOULDBLOCK);
+  result = TtyReadFlags(TTY_CONSOLE, buffer, sizeof(buffer), IO_NONBLOCK);
+  putsArgs("VectoredIO: non-blocking TtyRead() returned %d (expected WOULDBLOCK==%d).\n", result, WOULDBLOCK);
+
+  // 3. Gather into a pipe, scatter out of it.
+  char a[] = "abc";
+  char b[] = "defgh";
+  iovec_t in[2] = { { a, 3 }, { b, 5 } };
+  result = PipeWritev(pipe, in, 2);
+  putsArgs("VectoredIO: PipeWritev() returned %d (expected 8).\n", result);
+
+  char first[4]  = { 0 };
+  char second[8] = { 0 };
+  iovec_t scatter[2] = { { first, 3 }, { second, 7 } };
+  result = PipeReadv(pipe, scatter, 2);
+  putsArgs("VectoredIO: PipeReadv() returned %d: \"%s\" + \"%s\" (expected 8: \"abc\" + \"defgh\").\n",
+	   result, first, second);
+
+  // 4. Errors are caught before anything is written.
+  iovec_t bad[2] = { { a, 3 }, { NULL, 5 } };
+  if( ERROR != PipeWritev(pipe, bad, 2) ) {
+    puts("VectoredIO: WARNING: PipeWritev() accepted a NULL entry.\n");
+  }
+  if( ERROR != PipeWritev(pipe, in, YALNIX_IOV_MAX + 1) ) {
+    puts("VectoredIO: WARNING: PipeWritev() accepted too many entries.\n");
+  }
+  if( ERROR != Custom0(CUSTOM_SHM_DETACH | IO_NONBLOCK, 0, 0, 0) ) {
+    puts("VectoredIO: WARNING: flags accepted by a call which takes none.\n");
+  }
+
+  Reclaim(pipe);
+  puts("VectoredIO is exiting...\n");
+  Exit(0);
+}
+
+// End of VectoredIO.c
@@ -0,0 +1,42 @@
+// Bench.h
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Helpers for the microbenchmarks in programs/bench/. Run them all with ./bench, which
+// collects their results.
+//
+// Each result is one line of the trace,
+//
+//   BENCH metric value unit
+//
+// where metric has no spaces and value has two decimals, so that runs can be diffed
+// and sorted. Times are in clock ticks, which are coarse: each benchmark repeats what
+// it measures enough to get the hundredths. Counts that do not depend on timing
+// (pages copied, context switches) are reported alongside.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "programs/UserUtility.h"
+
+// Prints total / count as BENCH metric value unit. metric is a format for the
+// arguments that follow.
+#define BENCH(total, count, unit, metric, ...) do {			\
+    int _h = BenchHundredths((total), (count));			\
+    TracePrintf(TRACE_USERLAND, "BENCH " metric " %s%d.%02d %s\n", ##__VA_ARGS__, \
+		_h < 0 ? "-" : "", (_h < 0 ? -_h : _h) / 100, (_h < 0 ? -_h : _h) % 100, unit); \
+  } while(0)
+
+int BenchHundredths(int total, int count) {
+  return count == 0 ? 0 : (int) ((long long) total * 100 / count);
+}
+
+// Context switches so far, from GetCounters().
+int BenchSwitches(void) {
+  counters_t counters;
+  GetCounters(&counters);
+  return counters.counters[COUNTER_CONTEXT_SWITCHES];
+}
+
+#endif
+// End of Bench.h
@@ -0,0 +1,70 @@
+// ExecBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Exec() latency, alone and after Fork():
+//
+//   fork_exec_latency  ticks per Fork() + Exec() + Exit() + Wait()
+//   exec_latency       ticks per Exec(), from a chain of CHAIN Exec()s of this program
+//                      less a chain of none
+//
+// Modes (argv[1]): none runs the benchmark; "exit" exits; "chain" with argv[2] of n
+// characters Exec()s itself with n - 1 of them, and exits at 0.
+
+#include "programs/bench/Bench.h"
+
+#define ROUNDS 50
+#define CHAIN  "##################################################" // 50.
+#define PROGRAM "programs/bench/ExecBench"
+
+// Ticks for a child to run a chain of strlen(links) Exec()s, and for the caller to
+// Wait() for it.
+int chain(char* links) {
+  int start = GetTicks();
+  int pid = Fork();
+  if( pid == 0 ) {
+    char* args[] = { PROGRAM, "chain", links, NULL };
+    Exec(args[0], args);
+    panic("ExecBench-c: Exec() failed.\n");
+  }
+  int status;
+  Wait(&status);
+  return GetTicks() - start;
+}
+
+int main(int argc, char** argv) {
+  if( argc > 1 && strcmp(argv[1], "exit") == 0 ) {
+    Exit(0);
+  }
+  if( argc > 2 && strcmp(argv[1], "chain") == 0 ) {
+    if( argv[2][0] == '\0' ) {
+      Exit(0);
+    }
+    char* args[] = { argv[0], "chain", argv[2] + 1, NULL };
+    Exec(args[0], args);
+    panic("ExecBench-chain: Exec() failed.\n");
+  }
+
+  char* args[] = { PROGRAM, "exit", NULL };
+  int start = GetTicks();
+  int i;
+  for(i = 0; i < ROUNDS; i++) {
+    int pid = Fork();
+    if( pid == 0 ) {
+      Exec(args[0], args);
+      panic("ExecBench-c: Exec() failed.\n");
+    }
+    if( pid == ERROR ) {
+      panic("ExecBench: Fork() failed.\n");
+    }
+    int status;
+    Wait(&status);
+  }
+  BENCH(GetTicks() - start, ROUNDS, "ticks", "fork_exec_latency");
+
+  int ticks = chain(CHAIN) - chain("");
+  BENCH(ticks, strlen(CHAIN), "ticks", "exec_latency");
+  Exit(0);
+}
+
+// End of ExecBench.c
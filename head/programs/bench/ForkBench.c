@@ -0,0 +1,55 @@
+// ForkBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Fork() latency against the size of the caller's address space: for heaps of 0 to 64
+// touched pages, ROUNDS times Fork() a child that exits at once, and Wait() for it.
+//
+//   fork_latency_<n>pages  ticks per Fork() + Exit() + Wait()
+//   fork_copied_<n>pages   pages Fork() copied, per Fork()
+
+#include "programs/bench/Bench.h"
+
+#define ROUNDS 100
+
+int sizes[] = { 0, 16, 32, 64 };
+
+int main(void) {
+  int heap_pages = 0;
+  int s;
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    // Grow the heap to sizes[s] pages, and touch them so that Fork() has them to copy.
+    char* more = (char*) malloc((sizes[s] - heap_pages) * PAGESIZE + 1);
+    if( more == NULL ) {
+      panic("ForkBench: malloc() failed.\n");
+    }
+    int i;
+    for(i = 0; i < sizes[s] - heap_pages; i++) {
+      more[i * PAGESIZE] = i;
+    }
+    heap_pages = sizes[s];
+
+    frame_stats_t before, after;
+    FrameStats(&before);
+    int start = GetTicks();
+    for(i = 0; i < ROUNDS; i++) {
+      int pid = Fork();
+      if( pid == 0 ) {
+	Exit(0);
+      }
+      if( pid == ERROR ) {
+	panic("ForkBench: Fork() failed.\n");
+      }
+      int status;
+      Wait(&status);
+    }
+    int ticks = GetTicks() - start;
+    FrameStats(&after);
+
+    BENCH(ticks, ROUNDS, "ticks", "fork_latency_%dpages", sizes[s]);
+    BENCH(after.copied - before.copied, ROUNDS, "pages", "fork_copied_%dpages", sizes[s]);
+  }
+  Exit(0);
+}
+
+// End of ForkBench.c
@@ -0,0 +1,77 @@
+// MemBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Cost of growing a process's memory, a page at a time, through Brk() and through
+// stack-growth faults (TRAP_MEMORY). Neither shrinks, so each is measured in CHILDREN
+// fresh children that grow PAGES pages each, less CHILDREN children that do not.
+//
+//   brk_growth    ticks per page, one Brk() per page
+//   stack_growth  ticks per page, one fault per page
+
+#include "programs/bench/Bench.h"
+
+#define CHILDREN 20
+#define PAGES    32
+
+#define NOTHING 0
+#define BRK     1
+#define STACK   2
+
+// This program never calls malloc(), so the heap is all Brk()'s. It grows from a few
+// pages past this, which leaves room for whatever the library keeps after it.
+char bss_end;
+#define HEAP_BASE ((char*) UP_TO_PAGE(&bss_end) + 8 * PAGESIZE)
+
+void GrowHeap(int pages) {
+  char* base = HEAP_BASE;
+  Brk(base);
+  int i;
+  for(i = 1; i <= pages; i++) {
+    if( SUCCESS != Brk(base + i * PAGESIZE) ) {
+      panic("MemBench-c: Brk() failed.\n");
+    }
+  }
+}
+
+// Each call takes a page of stack, and touches its far end first.
+void GrowStack(int pages) {
+  char frame[PAGESIZE];
+  frame[0] = pages;
+  if( pages > 1 ) {
+    GrowStack(pages - 1);
+  }
+  frame[PAGESIZE - 1] = frame[0];
+}
+
+// Ticks for CHILDREN children, one at a time, to do what.
+int Children(int what) {
+  int start = GetTicks();
+  int i;
+  for(i = 0; i < CHILDREN; i++) {
+    int pid = Fork();
+    if( pid == 0 ) {
+      if( what == BRK ) {
+	GrowHeap(PAGES);
+      } else if( what == STACK ) {
+	GrowStack(PAGES);
+      }
+      Exit(0);
+    }
+    if( pid == ERROR ) {
+      panic("MemBench: Fork() failed.\n");
+    }
+    int status;
+    Wait(&status);
+  }
+  return GetTicks() - start;
+}
+
+int main(void) {
+  int base = Children(NOTHING);
+  BENCH(Children(BRK)   - base, CHILDREN * PAGES, "ticks", "brk_growth");
+  BENCH(Children(STACK) - base, CHILDREN * PAGES, "ticks", "stack_growth");
+  Exit(0);
+}
+
+// End of MemBench.c
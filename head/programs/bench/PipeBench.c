@@ -0,0 +1,42 @@
+// PipeBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Pipe throughput against message size. A PipeWrite() replaces what the pipe holds and
+// a PipeRead() leaves it there (see HandlePipeWrite()), so a message is one PipeWrite()
+// and one PipeRead() of it; messages are sent for at least MIN_TICKS ticks.
+//
+//   pipe_throughput_<n>B  bytes per tick, in messages of n bytes
+
+#include "programs/bench/Bench.h"
+
+#define MIN_TICKS 20
+#define MAX_SIZE  4096
+
+int sizes[] = { 1, 16, 256, 1024, MAX_SIZE };
+
+char out[MAX_SIZE], in[MAX_SIZE];
+
+int main(void) {
+  int pipe;
+  if( SUCCESS != PipeInit(&pipe) ) {
+    panic("PipeBench: PipeInit() failed.\n");
+  }
+  int s;
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    int messages = 0;
+    int start    = GetTicks();
+    int ticks;
+    while( (ticks = GetTicks() - start) < MIN_TICKS ) {
+      if( PipeWrite(pipe, out, sizes[s]) != sizes[s] || PipeRead(pipe, in, sizes[s]) != sizes[s] ) {
+	panic("PipeBench: PipeWrite() or PipeRead() failed.\n");
+      }
+      messages++;
+    }
+    BENCH(messages * sizes[s], ticks, "bytes/tick", "pipe_throughput_%dB", sizes[s]);
+  }
+  Reclaim(pipe);
+  Exit(0);
+}
+
+// End of PipeBench.c
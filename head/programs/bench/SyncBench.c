@@ -0,0 +1,92 @@
+// SyncBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Context-switch round trips between two processes, through a lock and through a
+// condition variable:
+//
+//   lock_roundtrip     ticks per round trip: each process in turn Release()s the lock,
+//                      which hands it to the other, and blocks in Acquire()
+//   lock_switches      context switches per round trip
+//   cvar_wake_latency  ticks from CvarSignal() until the waiter runs: each process in
+//                      turn signals the other and waits
+//   cvar_switches      context switches per signal
+
+#include "programs/bench/Bench.h"
+
+#define ROUNDS 500
+
+int LockPingPong(int lock) {
+  Acquire(lock);
+  int pid = Fork();
+  if( pid == 0 ) {
+    int i;
+    for(i = 0; i < ROUNDS; i++) {
+      Acquire(lock);
+      Release(lock);
+    }
+    Exit(0);
+  }
+  Delay(1); // The child blocks in Acquire().
+
+  int start = GetTicks();
+  int i;
+  for(i = 0; i < ROUNDS; i++) {
+    Release(lock);
+    Acquire(lock);
+  }
+  int ticks = GetTicks() - start;
+  Release(lock);
+  int status;
+  Wait(&status);
+  return ticks;
+}
+
+int CvarPingPong(int lock, int cvar) {
+  Acquire(lock);
+  int pid = Fork();
+  if( pid == 0 ) {
+    Acquire(lock);
+    int i;
+    for(i = 0; i < ROUNDS; i++) {
+      CvarSignal(cvar);
+      CvarWait(cvar, lock);
+    }
+    Release(lock);
+    Exit(0);
+  }
+  Delay(1); // The child blocks in Acquire().
+
+  int start = GetTicks();
+  int i;
+  for(i = 0; i < ROUNDS; i++) {
+    CvarWait(cvar, lock);
+    CvarSignal(cvar);
+  }
+  int ticks = GetTicks() - start;
+  Release(lock);
+  int status;
+  Wait(&status);
+  return ticks;
+}
+
+int main(void) {
+  int lock, cvar;
+  if( SUCCESS != LockInit(&lock) || SUCCESS != CvarInit(&cvar) ) {
+    panic("SyncBench: LockInit() or CvarInit() failed.\n");
+  }
+
+  int switches = BenchSwitches();
+  int ticks    = LockPingPong(lock);
+  BENCH(ticks, ROUNDS, "ticks", "lock_roundtrip");
+  BENCH(BenchSwitches() - switches, ROUNDS, "switches", "lock_switches");
+
+  // A round trip is two signals.
+  switches = BenchSwitches();
+  ticks    = CvarPingPong(lock, cvar);
+  BENCH(ticks, 2 * ROUNDS, "ticks", "cvar_wake_latency");
+  BENCH(BenchSwitches() - switches, 2 * ROUNDS, "switches", "cvar_switches");
+  Exit(0);
+}
+
+// End of SyncBench.c
@@ -0,0 +1,53 @@
+// TtyBench.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Terminal write throughput against write size: TOTAL bytes to terminal TTY, timed
+// until the last of them is sent.
+//
+//   tty_write_throughput_<n>B    bytes per tick, in writes of n bytes
+//   tty_bytes_per_transmit_<n>B  bytes per TtyTransmit()
+
+#include "programs/bench/Bench.h"
+
+#define TTY      1
+#define TOTAL    16384
+#define MAX_SIZE 1024
+
+int sizes[] = { 16, 256, MAX_SIZE };
+
+char line[MAX_SIZE];
+
+int main(void) {
+  int i;
+  for(i = 0; i < MAX_SIZE; i++) {
+    line[i] = i % 64 == 63 ? '\n' : 'a' + i % 26;
+  }
+
+  int s;
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    tty_stats_t before, after;
+    TtyStats(TTY, &before);
+    int start = GetTicks();
+    for(i = 0; i < TOTAL; i += sizes[s]) {
+      if( TtyWrite(TTY, line, sizes[s]) != sizes[s] ) {
+	panic("TtyBench: TtyWrite() failed.\n");
+      }
+    }
+    // TtyWrite() returns once the kernel has the bytes.
+    do {
+      TtyStats(TTY, &after);
+      if( after.output_buffered > 0 ) {
+	Delay(1);
+      }
+    } while( after.output_buffered > 0 );
+    int ticks = GetTicks() - start;
+
+    BENCH(TOTAL, ticks, "bytes/tick", "tty_write_throughput_%dB", sizes[s]);
+    BENCH(after.bytes_sent - before.bytes_sent, after.output_transmits - before.output_transmits,
+	  "bytes", "tty_bytes_per_transmit_%dB", sizes[s]);
+  }
+  Exit(0);
+}
+
+// End of TtyBench.c
@@ -0,0 +1,203 @@
+// EventDecode.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Decodes the kernel's event log (see Events.h). Runs on the host, not in Yalnix:
+//
+//   tools/EventDecode [EVENTS]           prints a timeline, one event per line.
+//   tools/EventDecode -chrome [EVENTS]   prints Chrome trace-event JSON.
+//
+// In the JSON, track 0 ("cpu") shows which process runs when, and each process has a
+// track of its own with its system calls (from entry until they return to it, blocked
+// time included) and its other events. Ticks are shown as milliseconds; events within
+// a tick are spread over it, in order.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/hardware.h"
+#include "CustomCalls.h"
+#include "Events.h"
+#include "Counters.h"
+
+#define MAX_PIDS 1024
+
+code_name_t syscall_names[] = { SYSCALL_NAMES, { 0, NULL } };
+code_name_t custom_names[]  = { CUSTOM_NAMES,  { 0, NULL } };
+
+char* type_names[EV_NUM_TYPES] = {
+  "?", "switch", "syscall", "return", "fault", "ready", "tty-rx", "tty-tx", "disk", "exit"
+};
+
+char* lookup(code_name_t* names, int code) {
+  for(; names->name != NULL; names++) {
+    if( names->code == code ) {
+      return names->name;
+    }
+  }
+  return "?";
+}
+
+// Name of the system call of an EV_SYSCALL or EV_SYSCALL_DONE event.
+char* syscall_name(event_t* e) {
+  if( e->args[0] == (int) YALNIX_CUSTOM_0 ) {
+    return lookup(custom_names, e->args[1]);
+  }
+  return lookup(syscall_names, e->args[0]);
+}
+
+void describe(event_t* e, char* text, int size) {
+  switch( e->type ) {
+  case EV_SWITCH:
+    snprintf(text, size, "to %d%s", e->args[0], e->args[1] ? " (preempted)" : "");
+    break;
+  case EV_SYSCALL:
+    snprintf(text, size, "%s", syscall_name(e));
+    break;
+  case EV_SYSCALL_DONE:
+    snprintf(text, size, "%s = %d", syscall_name(e), e->args[2]);
+    break;
+  case EV_FAULT:
+    snprintf(text, size, "address 0x%08x (%s)", (unsigned int) e->args[0],
+	     e->args[1] == YALNIX_MAPERR ? "MAPERR" : "ACCERR");
+    break;
+  case EV_READY:
+    snprintf(text, size, "process %d", e->args[0]);
+    break;
+  case EV_TTY_RECEIVE:
+  case EV_TTY_TRANSMIT:
+    snprintf(text, size, "tty %d, %d bytes", e->args[0], e->args[1]);
+    break;
+  case EV_DISK:
+    snprintf(text, size, "%s sector %d", e->args[1] == DISK_READ ? "read" : "write", e->args[0]);
+    break;
+  case EV_EXIT:
+    snprintf(text, size, "process %d, status %d", e->args[0], e->args[1]);
+    break;
+  default:
+    snprintf(text, size, "%d %d %d", e->args[0], e->args[1], e->args[2]);
+  }
+}
+
+void timeline(event_t* events, int count) {
+  printf("%8s %5s  %-8s\n", "tick", "pid", "event");
+  int i;
+  for(i = 0; i < count; i++) {
+    char text[128];
+    describe(&events[i], text, sizeof(text));
+    int type = events[i].type >= 0 && events[i].type < EV_NUM_TYPES ? events[i].type : 0;
+    printf("%8d %5d  %-8s %s\n", events[i].tick, events[i].pid, type_names[type], text);
+  }
+}
+
+// Helper method for chrome(): microseconds of events[i], spread within its tick.
+long timestamp(event_t* events, int count, int i) {
+  int first = i, last = i;
+  while( first > 0 && events[first - 1].tick == events[i].tick ) {
+    first--;
+  }
+  while( last < count - 1 && events[last + 1].tick == events[i].tick ) {
+    last++;
+  }
+  return events[i].tick * 1000L + (i - first) * 1000L / (last - first + 1);
+}
+
+void chrome(event_t* events, int count) {
+  long syscall_start[MAX_PIDS];
+  int  seen[MAX_PIDS];
+  memset(seen, 0, sizeof(seen));
+  int i;
+  for(i = 0; i < MAX_PIDS; i++) {
+    syscall_start[i] = -1; // Entered before the log starts, if at all.
+  }
+  int  running = -1;
+  long running_since = 0;
+  char* sep = "";
+
+  printf("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  printf("{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"cpu\"}}");
+  sep = ",\n";
+
+  for(i = 0; i < count; i++) {
+    event_t* e   = &events[i];
+    long     ts  = timestamp(events, count, i);
+    int      tid = e->pid >= 0 && e->pid < MAX_PIDS ? e->pid : 0;
+    char     text[128];
+    describe(e, text, sizeof(text));
+
+    if( tid != 0 && !seen[tid] ) {
+      seen[tid] = 1;
+      printf("%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 0, \"tid\": %d, "
+	     "\"args\": {\"name\": \"process %d\"}}", sep, tid, tid);
+    }
+    if( running < 0 && e->pid >= 0 ) {
+      running       = e->pid;
+      running_since = ts;
+    }
+
+    switch( e->type ) {
+    case EV_SWITCH:
+      if( running >= 0 ) {
+	printf("%s{\"ph\": \"X\", \"name\": \"process %d\", \"pid\": 0, \"tid\": 0, "
+	       "\"ts\": %ld, \"dur\": %ld}", sep, running, running_since, ts - running_since);
+      }
+      running       = e->args[0];
+      running_since = ts;
+      break;
+    case EV_SYSCALL:
+      syscall_start[tid] = ts;
+      break;
+    case EV_SYSCALL_DONE:
+      if( syscall_start[tid] < 0 ) {
+	break;
+      }
+      printf("%s{\"ph\": \"X\", \"name\": \"%s\", \"pid\": 0, \"tid\": %d, \"ts\": %ld, "
+	     "\"dur\": %ld, \"args\": {\"result\": %d}}", sep, syscall_name(e), tid,
+	     syscall_start[tid], ts - syscall_start[tid], e->args[2]);
+      syscall_start[tid] = -1;
+      break;
+    default:
+      printf("%s{\"ph\": \"i\", \"s\": \"t\", \"name\": \"%s\", \"pid\": 0, \"tid\": %d, "
+	     "\"ts\": %ld, \"args\": {\"what\": \"%s\"}}", sep,
+	     type_names[e->type > 0 && e->type < EV_NUM_TYPES ? e->type : 0], tid, ts, text);
+    }
+  }
+  printf("\n]}\n");
+}
+
+int main(int argc, char** argv) {
+  int   json = argc > 1 && strcmp(argv[1], "-chrome") == 0;
+  char* name = argc > 1 + json ? argv[1 + json] : EVENT_FILE;
+
+  FILE* file = fopen(name, "rb");
+  if( file == NULL ) {
+    fprintf(stderr, "EventDecode: cannot open %s.\n", name);
+    return 1;
+  }
+  events_header_t header;
+  if( fread(&header, sizeof(header), 1, file) != 1 || header.magic != EVENT_MAGIC ||
+      header.count < 0 || header.count > EVENT_RING_SIZE ) {
+    fprintf(stderr, "EventDecode: %s is no event log.\n", name);
+    return 1;
+  }
+  event_t* events = (event_t*) malloc(header.count * sizeof(event_t) + 1);
+  int count = fread(events, sizeof(event_t), header.count, file);
+  fclose(file);
+  if( count != header.count ) {
+    fprintf(stderr, "EventDecode: %s is cut short (%d of %d events).\n", name, count, header.count);
+  }
+  if( header.dropped > 0 ) {
+    fprintf(stderr, "EventDecode: %d older events were overwritten.\n", header.dropped);
+  }
+
+  if( json ) {
+    chrome(events, count);
+  } else {
+    timeline(events, count);
+  }
+  free(events);
+  return 0;
+}
+
+// End of EventDecode.c
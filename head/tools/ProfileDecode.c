@@ -0,0 +1,205 @@
+// ProfileDecode.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Decodes the profiler's samples (see Profile.h). Runs on the host, not in Yalnix:
+//
+//   tools/ProfileDecode [PROFILE]   prints, for each program, the samples per function.
+//
+// Samples of every process that ran a program are added up. Functions come from
+// `nm -n program`, run from the current directory, so run this where yalnix ran;
+// programs nm cannot read (e.g., ones Exec()ed from the Yalnix file system) are shown
+// by pc.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Profile.h"
+
+#define MAX_PROGRAMS 64
+#define MAX_SYMBOLS  4096
+#define MAX_PCS      (16 * PROFILE_SLOTS)
+
+typedef struct {
+  unsigned int addr;
+  char         name[64];
+  int          samples;
+} symbol_t;
+
+typedef struct {
+  char             name[PROFILE_NAME];
+  int              processes;
+  int              samples;
+  int              dropped;
+  int              count;
+  profile_sample_t pcs[MAX_PCS]; // Summed over processes.
+} program_t;
+
+program_t* programs[MAX_PROGRAMS];
+int        num_programs = 0;
+
+symbol_t symbols[MAX_SYMBOLS];
+int      num_symbols;
+
+program_t* find_program(char* name) {
+  int i;
+  for(i = 0; i < num_programs; i++) {
+    if( strncmp(programs[i]->name, name, PROFILE_NAME) == 0 ) {
+      return programs[i];
+    }
+  }
+  if( num_programs == MAX_PROGRAMS ) {
+    return NULL;
+  }
+  program_t* program = (program_t*) calloc(1, sizeof(program_t));
+  strncpy(program->name, name, PROFILE_NAME - 1);
+  programs[num_programs++] = program;
+  return program;
+}
+
+void add_sample(program_t* program, profile_sample_t* sample) {
+  int i;
+  for(i = 0; i < program->count; i++) {
+    if( program->pcs[i].pc == sample->pc ) {
+      program->pcs[i].samples += sample->samples;
+      return;
+    }
+  }
+  if( program->count == MAX_PCS ) {
+    program->dropped += sample->samples;
+    return;
+  }
+  program->pcs[program->count++] = *sample;
+}
+
+// Reads program's text symbols, in address order. Returns 0 if there are none.
+int load_symbols(char* program) {
+  char command[PROFILE_NAME + 32];
+  snprintf(command, sizeof(command), "nm -n '%s' 2>/dev/null", program);
+  FILE* nm = popen(command, "r");
+  num_symbols = 0;
+  if( nm == NULL ) {
+    return 0;
+  }
+  char line[256];
+  while( fgets(line, sizeof(line), nm) != NULL && num_symbols < MAX_SYMBOLS ) {
+    unsigned int addr;
+    char type;
+    char name[64];
+    if( sscanf(line, "%x %c %63s", &addr, &type, name) == 3 && (type == 'T' || type == 't') ) {
+      symbols[num_symbols].addr    = addr;
+      symbols[num_symbols].samples = 0;
+      strcpy(symbols[num_symbols].name, name);
+      num_symbols++;
+    }
+  }
+  pclose(nm);
+  return num_symbols;
+}
+
+// Last symbol at or below pc (binary search), or NULL.
+symbol_t* symbol_at(unsigned int pc) {
+  int low = 0, high = num_symbols - 1;
+  symbol_t* found = NULL;
+  while( low <= high ) {
+    int mid = (low + high) / 2;
+    if( symbols[mid].addr <= pc ) {
+      found = &symbols[mid];
+      low   = mid + 1;
+    } else {
+      high  = mid - 1;
+    }
+  }
+  return found;
+}
+
+int by_samples(const void* a, const void* b) {
+  return ((symbol_t*) b)->samples - ((symbol_t*) a)->samples;
+}
+
+int by_pc_samples(const void* a, const void* b) {
+  return ((profile_sample_t*) b)->samples - ((profile_sample_t*) a)->samples;
+}
+
+void report(program_t* program) {
+  printf("%s: %d samples in %d process%s", program->name, program->samples,
+	 program->processes, program->processes == 1 ? "" : "es");
+  if( program->dropped > 0 ) {
+    printf(", %d of them at pcs not kept", program->dropped);
+  }
+  printf("\n%8s %6s  %s\n", "samples", "%", "function");
+
+  int i;
+  if( load_symbols(program->name) ) {
+    int unknown = 0;
+    for(i = 0; i < program->count; i++) {
+      symbol_t* symbol = symbol_at(program->pcs[i].pc);
+      if( symbol == NULL ) {
+	unknown += program->pcs[i].samples;
+      } else {
+	symbol->samples += program->pcs[i].samples;
+      }
+    }
+    qsort(symbols, num_symbols, sizeof(symbol_t), by_samples);
+    for(i = 0; i < num_symbols && symbols[i].samples > 0; i++) {
+      printf("%8d %6.2f  %s\n", symbols[i].samples,
+	     100.0 * symbols[i].samples / program->samples, symbols[i].name);
+    }
+    if( unknown > 0 ) {
+      printf("%8d %6.2f  ?\n", unknown, 100.0 * unknown / program->samples);
+    }
+  } else {
+    qsort(program->pcs, program->count, sizeof(profile_sample_t), by_pc_samples);
+    for(i = 0; i < program->count; i++) {
+      printf("%8d %6.2f  0x%08x\n", program->pcs[i].samples,
+	     100.0 * program->pcs[i].samples / program->samples, (unsigned int) program->pcs[i].pc);
+    }
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  char* name = argc > 1 ? argv[1] : PROFILE_FILE;
+
+  FILE* file = fopen(name, "rb");
+  if( file == NULL ) {
+    fprintf(stderr, "ProfileDecode: cannot open %s.\n", name);
+    return 1;
+  }
+  profile_header_t header;
+  while( fread(&header, sizeof(header), 1, file) == 1 ) {
+    if( header.magic != PROFILE_MAGIC || header.count < 0 || header.count > PROFILE_SLOTS ) {
+      fprintf(stderr, "ProfileDecode: %s is no profile.\n", name);
+      return 1;
+    }
+    header.name[PROFILE_NAME - 1] = '\0';
+    program_t* program = find_program(header.name);
+    if( program == NULL ) {
+      fprintf(stderr, "ProfileDecode: more than %d programs; skipping %s.\n", MAX_PROGRAMS, header.name);
+      fseek(file, header.count * sizeof(profile_sample_t), SEEK_CUR);
+      continue;
+    }
+    program->processes++;
+    program->samples += header.samples;
+    program->dropped += header.dropped;
+    int i;
+    for(i = 0; i < header.count; i++) {
+      profile_sample_t sample;
+      if( fread(&sample, sizeof(sample), 1, file) != 1 ) {
+	fprintf(stderr, "ProfileDecode: %s is cut short.\n", name);
+	break;
+      }
+      add_sample(program, &sample);
+    }
+  }
+  fclose(file);
+
+  int i;
+  for(i = 0; i < num_programs; i++) {
+    report(programs[i]);
+  }
+  return 0;
+}
+
+// End of ProfileDecode.c
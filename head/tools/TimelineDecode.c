@@ -0,0 +1,108 @@
+// TimelineDecode.c
+//
+// Julien Blanchet and Jae Heon Lee.
+//
+// Decodes the kernel's scheduler timeline (see Timeline.h). Runs on the host, not in
+// Yalnix:
+//
+//   tools/TimelineDecode [TIMELINE]          prints CSV: a header row, then one row
+//                                            per tick (tick, running pid, queue sizes).
+//   tools/TimelineDecode -peaks [TIMELINE]   prints each queue's largest size, and the
+//                                            first tick it was reached.
+//
+// The CSV loads into a spreadsheet, or plots with, e.g., gnuplot:
+//
+//   set datafile separator ","; plot for [c=3:8] "timeline.csv" using 1:c with steps title columnhead
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Timeline.h"
+
+#define X(id, name) name,
+char* column_names[TIMELINE_COLUMNS] = { TIMELINE_LIST };
+#undef X
+
+void csv(timeline_sample_t* samples, int count) {
+  printf("tick,pid");
+  int c;
+  for(c = 0; c < TIMELINE_COLUMNS; c++) {
+    printf(",%s", column_names[c]);
+  }
+  printf("\n");
+  int i;
+  for(i = 0; i < count; i++) {
+    printf("%d,%d", samples[i].tick, samples[i].pid);
+    for(c = 0; c < TIMELINE_COLUMNS; c++) {
+      printf(",%d", samples[i].sizes[c]);
+    }
+    printf("\n");
+  }
+}
+
+void peaks(timeline_sample_t* samples, int count) {
+  printf("%-16s %8s %8s\n", "queue", "peak", "at tick");
+  int c;
+  for(c = 0; c < TIMELINE_COLUMNS; c++) {
+    if( c == TL_INTERP_ID ) {
+      continue; // Shown with TL_INTERP_MAX.
+    }
+    int peak = 0, at = -1, i;
+    for(i = 0; i < count; i++) {
+      if( samples[i].sizes[c] > peak ) {
+	peak = samples[i].sizes[c];
+	at   = i;
+      }
+    }
+    if( at < 0 ) {
+      continue;
+    }
+    printf("%-16s %8d %8d", column_names[c], peak, samples[at].tick);
+    if( c == TL_INTERP_MAX ) {
+      printf("  (interp %d)", samples[at].sizes[TL_INTERP_ID]);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  int   show_peaks = argc > 1 && strcmp(argv[1], "-peaks") == 0;
+  char* name       = argc > 1 + show_peaks ? argv[1 + show_peaks] : TIMELINE_FILE;
+
+  FILE* file = fopen(name, "rb");
+  if( file == NULL ) {
+    fprintf(stderr, "TimelineDecode: cannot open %s.\n", name);
+    return 1;
+  }
+  timeline_header_t header;
+  if( fread(&header, sizeof(header), 1, file) != 1 || header.magic != TIMELINE_MAGIC ||
+      header.count < 0 || header.count > TIMELINE_RING_SIZE ) {
+    fprintf(stderr, "TimelineDecode: %s is no timeline.\n", name);
+    return 1;
+  }
+  if( header.columns != TIMELINE_COLUMNS ) {
+    fprintf(stderr, "TimelineDecode: %s has %d columns, not %d; rebuild the tools.\n", name,
+	    header.columns, TIMELINE_COLUMNS);
+    return 1;
+  }
+  timeline_sample_t* samples = (timeline_sample_t*) malloc(header.count * sizeof(timeline_sample_t) + 1);
+  int count = fread(samples, sizeof(timeline_sample_t), header.count, file);
+  fclose(file);
+  if( count != header.count ) {
+    fprintf(stderr, "TimelineDecode: %s is cut short (%d of %d ticks).\n", name, count, header.count);
+  }
+  if( header.dropped > 0 ) {
+    fprintf(stderr, "TimelineDecode: %d older ticks were overwritten.\n", header.dropped);
+  }
+
+  if( show_peaks ) {
+    peaks(samples, count);
+  } else {
+    csv(samples, count);
+  }
+  free(samples);
+  return 0;
+}
+
+// End of TimelineDecode.c